@@ -0,0 +1,347 @@
+// Micro-benchmarks for the hot gmath routines.
+//
+// usage: arena_bench_math [--batch N[,N...]] [--min-time SECONDS] [--json]
+//
+// Every routine runs over batches of pre-generated inputs so the loop body
+// is the math and not the setup. Results are ns/op and millions of ops per
+// second, printed as a table or as one JSON document.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gmath.hpp"
+#include "gmath_soa.hpp"
+
+struct BenchResult {
+    std::string name;
+    size_t batch;
+    double nsPerOp;
+    double mopsPerSec;
+};
+
+struct BenchInputs {
+    std::vector<Vector3> vec3s;
+    std::vector<Vector4> vec4s;
+    std::vector<Quaternion> quats;
+    std::vector<Matrix4> mats;
+    std::vector<Matrix4> affineMats;
+    std::vector<float> points;
+    Vector3SoA soaA, soaB;
+    QuaternionSoA soaQA, soaQB;
+};
+
+// Written after each run so the compiler cannot drop the work.
+static volatile float benchSink = 0.0F;
+
+static uint32_t benchRandState = 0x12345678U;
+
+static float benchRandom()
+{
+    benchRandState ^= benchRandState << 13;
+    benchRandState ^= benchRandState >> 17;
+    benchRandState ^= benchRandState << 5;
+    return (float)(benchRandState & 0xFFFFFF) / (float)0xFFFFFF * 2.0F - 1.0F;
+}
+
+static Vector3 benchRandomVec3()
+{
+    return vec3(benchRandom(), benchRandom(), benchRandom());
+}
+
+static Quaternion benchRandomQuat()
+{
+    return quatNormalize({benchRandom(), benchRandom(), benchRandom(), benchRandom() + 2.0F});
+}
+
+static void benchFillInputs(BenchInputs& in, size_t n)
+{
+    in.vec3s.resize(n);
+    in.vec4s.resize(n);
+    in.quats.resize(n);
+    in.mats.resize(n);
+    in.affineMats.resize(n);
+    in.points.resize(n * 3);
+    in.soaA.resize(n);
+    in.soaB.resize(n);
+    in.soaQA.resize(n);
+    in.soaQB.resize(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        in.vec3s[i] = benchRandomVec3();
+        in.vec4s[i] = {benchRandom(), benchRandom(), benchRandom(), 1.0F};
+        in.quats[i] = benchRandomQuat();
+        in.affineMats[i] = mat34ToMat4(mat34CreateTransform(benchRandomVec3(), in.quats[i], vec3(1.5F, 2.0F, 0.5F)));
+        in.mats[i] = in.affineMats[i];
+        in.mats[i].m14 = 0.1F * benchRandom();
+        in.mats[i].m24 = 0.1F * benchRandom();
+        in.points[i * 3 + 0] = benchRandom();
+        in.points[i * 3 + 1] = benchRandom();
+        in.points[i * 3 + 2] = benchRandom();
+        in.soaA.set(i, benchRandomVec3());
+        in.soaB.set(i, benchRandomVec3());
+        in.soaQA.set(i, benchRandomQuat());
+        in.soaQB.set(i, benchRandomQuat());
+    }
+}
+
+// Runs `pass` (one sweep over the batch) until minTime has elapsed, after
+// one warm-up sweep, and reports the per-element cost.
+template<typename F>
+static BenchResult benchRun(const char* name, size_t batch, double minTime, F pass)
+{
+    using Clock = std::chrono::steady_clock;
+
+    benchSink = benchSink + pass();
+
+    size_t passes = 0;
+    double elapsed = 0.0;
+    size_t step = 1;
+    Clock::time_point start = Clock::now();
+    while (elapsed < minTime)
+    {
+        float acc = 0.0F;
+        for (size_t i = 0; i < step; ++i)
+        {
+            acc += pass();
+        }
+        benchSink = benchSink + acc;
+        passes += step;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (step < 1024)
+        {
+            step *= 2;
+        }
+    }
+
+    double ops = (double)passes * (double)batch;
+    BenchResult r;
+    r.name = name;
+    r.batch = batch;
+    r.nsPerOp = elapsed * 1e9 / ops;
+    r.mopsPerSec = ops / elapsed / 1e6;
+    return r;
+}
+
+static void benchBatch(std::vector<BenchResult>& results, size_t n, double minTime)
+{
+    BenchInputs in;
+    benchFillInputs(in, n);
+
+    std::vector<Matrix4> outMats(n);
+    std::vector<Vector3> outVec3s(n);
+    std::vector<Vector4> outVec4s(n);
+    std::vector<Quaternion> outQuats(n);
+    std::vector<float> outPoints(n * 3);
+    Vector3SoA outSoa;
+    outSoa.resize(n);
+    QuaternionSoA outSoaQ;
+    outSoaQ.resize(n);
+    std::vector<float> outDots(n);
+
+    results.push_back(benchRun("mat4Multiply", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outMats[i] = mat4Multiply(in.mats[i], in.mats[n - 1 - i]);
+        }
+        return outMats[n / 2].m11;
+    }));
+
+    results.push_back(benchRun("mat4Inverse", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outMats[i] = mat4Inverse(in.mats[i]);
+        }
+        return outMats[n / 2].m11;
+    }));
+
+    results.push_back(benchRun("mat4AffineInverse", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outMats[i] = mat4AffineInverse(in.affineMats[i]);
+        }
+        return outMats[n / 2].m11;
+    }));
+
+    results.push_back(benchRun("mat4RigidInverse", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outMats[i] = mat4RigidInverse(in.affineMats[i]);
+        }
+        return outMats[n / 2].m11;
+    }));
+
+    results.push_back(benchRun("mat4InverseTranspose", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outMats[i] = mat4InverseTranspose(in.affineMats[i]);
+        }
+        return outMats[n / 2].m11;
+    }));
+
+    results.push_back(benchRun("mat4LookAt", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outMats[i] = mat4LookAt(in.vec3s[i], vec3Zero(), vec3(0.0F, 1.0F, 0.0F));
+        }
+        return outMats[n / 2].m11;
+    }));
+
+    results.push_back(benchRun("vec4Transform", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outVec4s[i] = vec4Transform(in.vec4s[i], in.mats[0]);
+        }
+        return outVec4s[n / 2].x;
+    }));
+
+    results.push_back(benchRun("mat4TransformPoints", n, minTime, [&]() {
+        mat4TransformPoints(in.points.data(), outPoints.data(), n, in.mats[0]);
+        return outPoints[n / 2];
+    }));
+
+    results.push_back(benchRun("vec3Transform", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outVec3s[i] = vec3Transform(in.vec3s[i], in.quats[i]);
+        }
+        return outVec3s[n / 2].x;
+    }));
+
+    results.push_back(benchRun("quatRotateN", n, minTime, [&]() {
+        quatRotateN(in.soaA, in.soaQA, outSoa);
+        return outSoa.x()[n / 2];
+    }));
+
+    results.push_back(benchRun("vec3Normalize", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outVec3s[i] = vec3Normalize(in.vec3s[i]);
+        }
+        return outVec3s[n / 2].x;
+    }));
+
+    results.push_back(benchRun("vec3NormalizeN", n, minTime, [&]() {
+        vec3NormalizeN(in.soaA, outSoa);
+        return outSoa.x()[n / 2];
+    }));
+
+    results.push_back(benchRun("vec3DotN", n, minTime, [&]() {
+        vec3DotN(in.soaA, in.soaB, outDots.data());
+        return outDots[n / 2];
+    }));
+
+    results.push_back(benchRun("quatMultiply", n, minTime, [&]() {
+        for (size_t i = 0; i < n; ++i)
+        {
+            outQuats[i] = quatMultiply(in.quats[i], in.quats[n - 1 - i]);
+        }
+        return outQuats[n / 2].x;
+    }));
+
+    results.push_back(benchRun("quatNlerpN", n, minTime, [&]() {
+        quatNlerpN(in.soaQA, in.soaQB, 0.3F, outSoaQ);
+        return outSoaQ.x()[n / 2];
+    }));
+}
+
+static const char* benchBackendName()
+{
+#if defined(GMATH_AVX2)
+    return "avx2";
+#elif defined(GMATH_SSE4)
+    return "sse4";
+#else
+    return "scalar";
+#endif
+}
+
+static void benchPrintText(const std::vector<BenchResult>& results)
+{
+    printf("gmath backend: %s\n", benchBackendName());
+    printf("%-22s %8s %12s %12s\n", "routine", "batch", "ns/op", "Mops/s");
+    for (const BenchResult& r : results)
+    {
+        printf("%-22s %8zu %12.3f %12.2f\n", r.name.c_str(), r.batch, r.nsPerOp, r.mopsPerSec);
+    }
+}
+
+static void benchPrintJson(const std::vector<BenchResult>& results)
+{
+    printf("{\n  \"backend\": \"%s\",\n  \"results\": [\n", benchBackendName());
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& r = results[i];
+        printf("    {\"name\": \"%s\", \"batch\": %zu, \"ns_per_op\": %.4f, \"mops_per_sec\": %.4f}%s\n",
+               r.name.c_str(), r.batch, r.nsPerOp, r.mopsPerSec, i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+static void benchUsage(const char* argv0)
+{
+    fprintf(stderr, "usage: %s [--batch N[,N...]] [--min-time SECONDS] [--json]\n", argv0);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<size_t> batches = {16, 256, 4096};
+    double minTime = 0.2;
+    bool json = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--json") == 0)
+        {
+            json = true;
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+        {
+            batches.clear();
+            const char* s = argv[++i];
+            while (*s)
+            {
+                char* end = nullptr;
+                unsigned long n = strtoul(s, &end, 10);
+                if (end == s || n == 0)
+                {
+                    benchUsage(argv[0]);
+                    return 1;
+                }
+                batches.push_back((size_t)n);
+                s = *end == ',' ? end + 1 : end;
+            }
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+        {
+            minTime = atof(argv[++i]);
+        }
+        else
+        {
+            benchUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    for (size_t n : batches)
+    {
+        benchBatch(results, n, minTime);
+    }
+
+    if (json)
+    {
+        benchPrintJson(results);
+    }
+    else
+    {
+        benchPrintText(results);
+    }
+
+    return 0;
+}
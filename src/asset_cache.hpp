@@ -0,0 +1,656 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "async_io.hpp"
+#include "baked_model.hpp"
+#include "baked_texture.hpp"
+#include "texture.hpp"
+#include "texture_compress.hpp"
+#include "worker_pool.hpp"
+
+enum class AssetType {
+    Model,
+    Texture,
+    Count,
+};
+
+struct AssetCacheEntry {
+    AssetType type;
+    uint64_t contentHash;
+    size_t bytes;
+    std::shared_ptr<const void> asset;
+    std::vector<std::string> paths;
+};
+
+// What a worker hands back: the loaded model, or nullptr on failure.
+struct ModelLoadResult {
+    std::shared_ptr<ModelAsset> model;
+    uint64_t contentHash = 0;
+};
+
+using ModelHandle = std::shared_ptr<const ModelAsset>;
+using ModelLoadCallback = std::function<void(ModelHandle)>;
+
+// A cache hit has no result to wait for, only the model it found; it is
+// still published by update() like any other load.
+struct PendingModelLoad {
+    std::future<ModelLoadResult> result;
+    ModelHandle cached;
+    std::promise<ModelHandle> published;
+    std::shared_future<ModelHandle> handle;
+    std::vector<ModelLoadCallback> callbacks;
+    uint64_t ioRequest = 0;
+};
+
+// A decoded image waiting for its GL upload, or nullptr on failure.
+struct TextureLoadResult {
+    std::shared_ptr<TextureImage> image;
+    uint64_t contentHash = 0;
+};
+
+using TextureHandle = std::shared_ptr<const Texture>;
+using TextureLoadCallback = std::function<void(TextureHandle)>;
+
+struct PendingTextureLoad {
+    std::future<TextureLoadResult> result;
+    TextureHandle cached;
+    std::promise<TextureHandle> published;
+    std::shared_future<TextureHandle> handle;
+    std::vector<TextureLoadCallback> callbacks;
+    uint64_t ioRequest = 0;
+};
+
+// Loads each asset once and hands out shared handles to it.
+//
+// Lookups go by canonical path first, then by content hash, so the same
+// file reached through another path or copied under another name is shared
+// too. Entries nobody else holds a handle to are evicted least recently used
+// first whenever the resident total exceeds the budget. A path hit does not
+// look at the file again; edits on disk need invalidate().
+//
+// The cache itself belongs to the main thread. loadModelAsync reads and
+// imports on the worker pool, and update() publishes finished loads into
+// the cache, resolving their futures and running their callbacks there.
+// With an AsyncFileReader set, baked files are read through it and only
+// decoded on the workers; source files still go through Assimp's own I/O.
+// Decoding a baked file spreads its chunks over idle workers too.
+//
+// Textures work the same way: loadTextureAsync reads the file, decodes it
+// and builds its mips off the main thread, and update() uploads the decoded
+// images that are ready, up to uploadBudgetBytes per call so a burst of
+// finished textures is spread over several frames. Baked .arenatex files
+// skip the decode: their block-compressed mips are copied out as stored.
+struct AssetCache {
+    std::list<AssetCacheEntry> entries;
+    std::unordered_map<std::string, std::list<AssetCacheEntry>::iterator> byPath;
+    std::unordered_map<uint64_t, std::list<AssetCacheEntry>::iterator> byHash;
+    std::unordered_map<std::string, PendingModelLoad> pendingModels;
+    std::unordered_map<std::string, PendingTextureLoad> pendingTextures;
+    WorkerPool* workers = nullptr;
+    AsyncFileReader* io = nullptr;
+    size_t budgetBytes;
+    size_t uploadBudgetBytes = 32 * 1024 * 1024;
+    size_t residentBytesByType[(size_t)AssetType::Count] = {};
+
+    explicit AssetCache(size_t budget = 256 * 1024 * 1024)
+    {
+        budgetBytes = budget;
+    }
+
+    // .arenamesh files load baked, anything else through Assimp. Returns
+    // nullptr when the file cannot be loaded.
+    ModelHandle loadModel(const char* path)
+    {
+        assert(path);
+
+        std::string key = canonicalPath(path);
+        auto hit = byPath.find(key);
+        if (hit != byPath.end())
+        {
+            return std::static_pointer_cast<const ModelAsset>(touch(hit->second)->asset);
+        }
+        auto pending = pendingModels.find(key);
+        if (pending != pendingModels.end())
+        {
+            return finishModelLoad(pending);
+        }
+
+        bool baked = isBakedModel(key);
+        uint64_t hash = 0;
+        if (!contentHash(key.c_str(), baked, hash))
+        {
+            printf("ERROR::ASSET => cannot read %s\n", path);
+            return nullptr;
+        }
+        ModelHandle existing = findModelByHash(key, hash);
+        if (existing)
+        {
+            return existing;
+        }
+
+        ModelLoadResult result;
+        result.contentHash = hash;
+        result.model = std::make_shared<ModelAsset>();
+        if (!(baked ? result.model->loadBaked(key.c_str(), workers) : result.model->loadSource(key.c_str())))
+        {
+            return nullptr;
+        }
+        return publishModel(key, result);
+    }
+
+    // Starts loading on the worker pool. The returned future is resolved,
+    // and onLoaded called, from update() once the model is in the cache,
+    // even if it already was; both get nullptr if it failed to load.
+    // Requests for a path already in flight share that load.
+    std::shared_future<ModelHandle> loadModelAsync(const char* path, ModelLoadCallback onLoaded = nullptr, IoPriority priority = IoPriority::Normal)
+    {
+        assert(path);
+        assert(workers);
+
+        std::string key = canonicalPath(path);
+        auto pending = pendingModels.find(key);
+        if (pending == pendingModels.end())
+        {
+            PendingModelLoad load;
+            auto hit = byPath.find(key);
+            if (hit != byPath.end())
+            {
+                load.cached = std::static_pointer_cast<const ModelAsset>(touch(hit->second)->asset);
+            }
+            else if (io && isBakedModel(key))
+            {
+                auto decoded = std::make_shared<std::promise<ModelLoadResult>>();
+                load.result = decoded->get_future();
+                WorkerPool* pool = workers;
+                load.ioRequest = io->read(key, priority, [decoded, pool](IoResult& read) {
+                    if (!read.ok)
+                    {
+                        if (!read.cancelled)
+                        {
+                            printf("ERROR::ASSET => cannot read %s\n", read.path.c_str());
+                        }
+                        decoded->set_value(ModelLoadResult());
+                        return;
+                    }
+                    auto bytes = std::make_shared<IoResult>(std::move(read));
+                    pool->submit([decoded, bytes, pool]() { decoded->set_value(decodeBakedModel(bytes->path, bytes->data, pool)); });
+                });
+            }
+            else
+            {
+                WorkerPool* pool = workers;
+                load.result = workers->submit([key, pool]() { return loadModelFile(key, pool); });
+            }
+            load.handle = load.published.get_future().share();
+            pending = pendingModels.emplace(key, std::move(load)).first;
+        }
+        if (onLoaded)
+        {
+            pending->second.callbacks.push_back(std::move(onLoaded));
+        }
+        return pending->second.handle;
+    }
+
+    // Publishes every async load that has finished. Call once per frame.
+    void update()
+    {
+        // Collected first: callbacks may start new loads.
+        std::vector<std::string> ready;
+        for (auto& it : pendingModels)
+        {
+            if (it.second.cached || it.second.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                ready.push_back(it.first);
+            }
+        }
+        for (const std::string& key : ready)
+        {
+            auto it = pendingModels.find(key);
+            if (it != pendingModels.end())
+            {
+                finishModelLoad(it);
+            }
+        }
+
+        // Uploads stop once over budget; the rest stay staged for the next
+        // call. At least one goes up each time so a large image cannot stall.
+        // Cache hits upload nothing and always go out.
+        ready.clear();
+        for (auto& it : pendingTextures)
+        {
+            if (it.second.cached || it.second.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+            {
+                ready.push_back(it.first);
+            }
+        }
+        size_t uploaded = 0;
+        for (const std::string& key : ready)
+        {
+            auto it = pendingTextures.find(key);
+            if (it == pendingTextures.end())
+            {
+                continue;
+            }
+            bool upload = !it->second.cached;
+            if (upload && uploaded >= uploadBudgetBytes)
+            {
+                continue;
+            }
+            TextureHandle texture = finishTextureLoad(it);
+            uploaded += upload && texture ? texture->bytes : 0;
+        }
+    }
+
+    size_t pendingCount() const
+    {
+        return pendingModels.size() + pendingTextures.size();
+    }
+
+    // Stops a load that is still waiting on its file read; it then resolves
+    // to nullptr on the next update(). Imports already running finish anyway.
+    bool cancelModelLoad(const char* path)
+    {
+        auto it = pendingModels.find(canonicalPath(path));
+        if (it == pendingModels.end() || !io || it->second.ioRequest == 0)
+        {
+            return false;
+        }
+        return io->cancel(it->second.ioRequest);
+    }
+
+    // Reads, decodes and uploads on the calling thread, which must own the
+    // GL context. Returns nullptr when the file cannot be loaded.
+    TextureHandle loadTexture(const char* path)
+    {
+        assert(path);
+
+        std::string key = canonicalPath(path);
+        auto hit = byPath.find(key);
+        if (hit != byPath.end())
+        {
+            return std::static_pointer_cast<const Texture>(touch(hit->second)->asset);
+        }
+        auto pending = pendingTextures.find(key);
+        if (pending != pendingTextures.end())
+        {
+            return finishTextureLoad(pending);
+        }
+
+        std::vector<uint8_t> bytes;
+        if (!readFile(key.c_str(), bytes))
+        {
+            printf("ERROR::ASSET => cannot read %s\n", path);
+            return nullptr;
+        }
+        uint64_t hash = textureContentHash(bytes);
+        TextureHandle existing = std::static_pointer_cast<const Texture>(findByHash(AssetType::Texture, key, hash));
+        if (existing)
+        {
+            return existing;
+        }
+        return publishTexture(key, decodeTexture(key, bytes));
+    }
+
+    // Like loadModelAsync: the file is read and decoded, mips included, off
+    // the main thread, and update() uploads it and resolves the future.
+    std::shared_future<TextureHandle> loadTextureAsync(const char* path, TextureLoadCallback onLoaded = nullptr, IoPriority priority = IoPriority::Normal)
+    {
+        assert(path);
+        assert(workers);
+
+        std::string key = canonicalPath(path);
+        auto pending = pendingTextures.find(key);
+        if (pending == pendingTextures.end())
+        {
+            PendingTextureLoad load;
+            auto hit = byPath.find(key);
+            if (hit != byPath.end())
+            {
+                load.cached = std::static_pointer_cast<const Texture>(touch(hit->second)->asset);
+            }
+            else if (io)
+            {
+                auto decoded = std::make_shared<std::promise<TextureLoadResult>>();
+                load.result = decoded->get_future();
+                WorkerPool* pool = workers;
+                load.ioRequest = io->read(key, priority, [decoded, pool](IoResult& read) {
+                    if (!read.ok)
+                    {
+                        if (!read.cancelled)
+                        {
+                            printf("ERROR::ASSET => cannot read %s\n", read.path.c_str());
+                        }
+                        decoded->set_value(TextureLoadResult());
+                        return;
+                    }
+                    auto bytes = std::make_shared<IoResult>(std::move(read));
+                    pool->submit([decoded, bytes]() { decoded->set_value(decodeTexture(bytes->path, bytes->data)); });
+                });
+            }
+            else
+            {
+                load.result = workers->submit([key]() {
+                    std::vector<uint8_t> bytes;
+                    if (!readFile(key.c_str(), bytes))
+                    {
+                        printf("ERROR::ASSET => cannot read %s\n", key.c_str());
+                        return TextureLoadResult();
+                    }
+                    return decodeTexture(key, bytes);
+                });
+            }
+            load.handle = load.published.get_future().share();
+            pending = pendingTextures.emplace(key, std::move(load)).first;
+        }
+        if (onLoaded)
+        {
+            pending->second.callbacks.push_back(std::move(onLoaded));
+        }
+        return pending->second.handle;
+    }
+
+    bool cancelTextureLoad(const char* path)
+    {
+        auto it = pendingTextures.find(canonicalPath(path));
+        if (it == pendingTextures.end() || !io || it->second.ioRequest == 0)
+        {
+            return false;
+        }
+        return io->cancel(it->second.ioRequest);
+    }
+
+    // Drops the cache's reference to whatever was loaded from path; handles
+    // already given out stay valid.
+    void invalidate(const char* path)
+    {
+        auto it = byPath.find(canonicalPath(path));
+        if (it != byPath.end())
+        {
+            erase(it->second);
+        }
+    }
+
+    void setBudget(size_t budget)
+    {
+        budgetBytes = budget;
+        trim();
+    }
+
+    // Evicts unreferenced entries, oldest first, until under budget.
+    void trim()
+    {
+        auto it = entries.end();
+        while (residentBytes() > budgetBytes && it != entries.begin())
+        {
+            --it;
+            if (it->asset.use_count() == 1)
+            {
+                it = erase(it);
+            }
+        }
+    }
+
+    size_t residentBytes(AssetType type) const
+    {
+        return residentBytesByType[(size_t)type];
+    }
+
+    size_t residentBytes() const
+    {
+        size_t total = 0;
+        for (size_t bytes : residentBytesByType)
+        {
+            total += bytes;
+        }
+        return total;
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    static bool isBakedModel(const std::string& path)
+    {
+        return std::filesystem::path(path).extension() == ".arenamesh";
+    }
+
+    static bool isBakedTexture(const std::string& path)
+    {
+        return std::filesystem::path(path).extension() == ".arenatex";
+    }
+
+    // Safe to run on any thread; touches nothing but the file and its result.
+    // Baked files are decompressed with the help of pool.
+    static ModelLoadResult loadModelFile(const std::string& path, WorkerPool* pool)
+    {
+        ModelLoadResult result;
+        bool baked = isBakedModel(path);
+        if (!contentHash(path.c_str(), baked, result.contentHash))
+        {
+            printf("ERROR::ASSET => cannot read %s\n", path.c_str());
+            return result;
+        }
+        std::shared_ptr<ModelAsset> model = std::make_shared<ModelAsset>();
+        if (baked ? model->loadBaked(path.c_str(), pool) : model->loadSource(path.c_str()))
+        {
+            result.model = std::move(model);
+        }
+        return result;
+    }
+
+    static ModelLoadResult decodeBakedModel(const std::string& path, const std::vector<uint8_t>& bytes, WorkerPool* pool)
+    {
+        ModelLoadResult result;
+        result.contentHash = bakedContentHash(bytes.data(), bytes.size());
+        std::shared_ptr<ModelAsset> model = std::make_shared<ModelAsset>();
+        if (model->loadBakedFromMemory(bytes.data(), bytes.size(), path.c_str(), pool))
+        {
+            result.model = std::move(model);
+        }
+        return result;
+    }
+
+    static TextureLoadResult decodeTexture(const std::string& path, const std::vector<uint8_t>& bytes)
+    {
+        TextureLoadResult result;
+        result.contentHash = textureContentHash(bytes);
+        std::shared_ptr<TextureImage> image = std::make_shared<TextureImage>();
+        bool ok = isBakedTexture(path) ? textureLoadBakedFromMemory(bytes.data(), bytes.size(), path.c_str(), *image)
+                                       : textureDecode(bytes.data(), bytes.size(), path.c_str(), *image);
+        // The support table is filled in before the first load, so reading
+        // it here on a worker is safe.
+        if (ok && !textureGLSupports(image->format))
+        {
+            TextureImage blocks = std::move(*image);
+            ok = textureDecompress(blocks, path.c_str(), *image);
+        }
+        if (ok)
+        {
+            result.image = std::move(image);
+        }
+        return result;
+    }
+
+    static uint64_t textureContentHash(const std::vector<uint8_t>& bytes)
+    {
+        return textureBakedContentHash(bytes.data(), bytes.size());
+    }
+
+    static bool readFile(const char* path, std::vector<uint8_t>& bytes)
+    {
+        FILE* f = fopen(path, "rb");
+        if (!f)
+        {
+            return false;
+        }
+        bytes.clear();
+        uint8_t buffer[64 * 1024];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        {
+            bytes.insert(bytes.end(), buffer, buffer + n);
+        }
+        bool ok = !ferror(f);
+        fclose(f);
+        return ok;
+    }
+
+    static std::string canonicalPath(const char* path)
+    {
+        std::error_code ec;
+        std::filesystem::path p = std::filesystem::weakly_canonical(path, ec);
+        return ec ? std::string(path) : p.string();
+    }
+
+    // Baked files carry the hash of their source; other files are hashed.
+    static bool contentHash(const char* path, bool baked, uint64_t& hash)
+    {
+        ArenaMeshHeader header;
+        if (baked && bakedReadHeader(path, header) && header.sourceHash != 0)
+        {
+            hash = header.sourceHash;
+            return true;
+        }
+        FILE* f = fopen(path, "rb");
+        if (!f)
+        {
+            return false;
+        }
+        // Same seeds as bakedContentHash for baked files.
+        hash = bakedHash(baked ? "baked" : "source", baked ? 5 : 6);
+        uint8_t buffer[64 * 1024];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        {
+            hash = bakedHash(buffer, n, hash);
+        }
+        fclose(f);
+        return true;
+    }
+
+private:
+    std::shared_ptr<const void> findByHash(AssetType type, const std::string& key, uint64_t hash)
+    {
+        auto same = byHash.find(hash);
+        if (same == byHash.end() || same->second->type != type)
+        {
+            return nullptr;
+        }
+        std::list<AssetCacheEntry>::iterator entry = touch(same->second);
+        entry->paths.push_back(key);
+        byPath[key] = entry;
+        return entry->asset;
+    }
+
+    ModelHandle findModelByHash(const std::string& key, uint64_t hash)
+    {
+        return std::static_pointer_cast<const ModelAsset>(findByHash(AssetType::Model, key, hash));
+    }
+
+    ModelHandle publishModel(const std::string& key, const ModelLoadResult& result)
+    {
+        if (!result.model)
+        {
+            return nullptr;
+        }
+        ModelHandle existing = findModelByHash(key, result.contentHash);
+        if (existing)
+        {
+            return existing;
+        }
+        insert(AssetType::Model, key, result.contentHash, result.model->memoryBytes(), result.model);
+        return result.model;
+    }
+
+    // Waits for the worker if needed, then publishes on this thread.
+    ModelHandle finishModelLoad(std::unordered_map<std::string, PendingModelLoad>::iterator it)
+    {
+        std::string key = it->first;
+        PendingModelLoad load = std::move(it->second);
+        pendingModels.erase(it);
+
+        ModelHandle model = load.cached ? load.cached : publishModel(key, load.result.get());
+        load.published.set_value(model);
+        for (const ModelLoadCallback& callback : load.callbacks)
+        {
+            callback(model);
+        }
+        return model;
+    }
+
+    TextureHandle publishTexture(const std::string& key, const TextureLoadResult& result)
+    {
+        if (!result.image)
+        {
+            return nullptr;
+        }
+        TextureHandle existing = std::static_pointer_cast<const Texture>(findByHash(AssetType::Texture, key, result.contentHash));
+        if (existing)
+        {
+            return existing;
+        }
+        std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+        if (!texture->upload(*result.image, key.c_str()))
+        {
+            return nullptr;
+        }
+        insert(AssetType::Texture, key, result.contentHash, texture->bytes, texture);
+        return texture;
+    }
+
+    TextureHandle finishTextureLoad(std::unordered_map<std::string, PendingTextureLoad>::iterator it)
+    {
+        std::string key = it->first;
+        PendingTextureLoad load = std::move(it->second);
+        pendingTextures.erase(it);
+
+        TextureHandle texture = load.cached ? load.cached : publishTexture(key, load.result.get());
+        load.published.set_value(texture);
+        for (const TextureLoadCallback& callback : load.callbacks)
+        {
+            callback(texture);
+        }
+        return texture;
+    }
+
+    std::list<AssetCacheEntry>::iterator touch(std::list<AssetCacheEntry>::iterator it)
+    {
+        entries.splice(entries.begin(), entries, it);
+        return entries.begin();
+    }
+
+    void insert(AssetType type, const std::string& key, uint64_t hash, size_t bytes, std::shared_ptr<const void> asset)
+    {
+        entries.push_front({type, hash, bytes, std::move(asset), {key}});
+        byPath[key] = entries.begin();
+        byHash[hash] = entries.begin();
+        residentBytesByType[(size_t)type] += bytes;
+        trim();
+    }
+
+    std::list<AssetCacheEntry>::iterator erase(std::list<AssetCacheEntry>::iterator it)
+    {
+        for (const std::string& path : it->paths)
+        {
+            byPath.erase(path);
+        }
+        auto h = byHash.find(it->contentHash);
+        if (h != byHash.end() && h->second == it)
+        {
+            byHash.erase(h);
+        }
+        residentBytesByType[(size_t)it->type] -= it->bytes;
+        return entries.erase(it);
+    }
+};
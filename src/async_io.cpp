@@ -0,0 +1,528 @@
+#include "async_io.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define ARENA_IO_URING
+#endif
+
+struct IoRequest {
+    uint64_t id;
+    uint64_t sequence;
+    IoPriority priority;
+    std::string path;
+    IoCallback onComplete;
+    int fd = -1;
+    size_t done = 0;
+    std::vector<uint8_t> data;
+#if defined(ARENA_IO_URING)
+    struct iovec iov;
+#endif
+};
+
+// Heap order: higher priority first, then older first.
+static bool ioRequestLess(const std::unique_ptr<IoRequest>& a, const std::unique_ptr<IoRequest>& b)
+{
+    if (a->priority != b->priority)
+    {
+        return a->priority < b->priority;
+    }
+    return a->sequence > b->sequence;
+}
+
+static void ioComplete(std::unique_ptr<IoRequest> req, bool ok, bool cancelled)
+{
+    IoResult result;
+    result.id = req->id;
+    result.path = std::move(req->path);
+    result.ok = ok && !cancelled;
+    result.cancelled = cancelled;
+    if (result.ok)
+    {
+        result.data = std::move(req->data);
+    }
+    if (req->onComplete)
+    {
+        req->onComplete(result);
+    }
+}
+
+// Opens the file and sizes the buffer; the read itself is left to the caller.
+static bool ioOpen(IoRequest& req)
+{
+#if defined(_WIN32)
+    (void)req;
+    return true;
+#else
+    req.fd = open(req.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (req.fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(req.fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return false;
+    }
+    req.data.resize((size_t)st.st_size);
+    return true;
+#endif
+}
+
+static void ioClose(IoRequest& req)
+{
+#if !defined(_WIN32)
+    if (req.fd >= 0)
+    {
+        close(req.fd);
+    }
+#endif
+    req.fd = -1;
+}
+
+static bool ioReadBlocking(IoRequest& req)
+{
+#if defined(_WIN32)
+    FILE* f = fopen(req.path.c_str(), "rb");
+    if (!f)
+    {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    req.data.resize(size > 0 ? (size_t)size : 0);
+    bool ok = size >= 0 && fread(req.data.data(), 1, req.data.size(), f) == req.data.size();
+    fclose(f);
+    return ok;
+#else
+    while (req.done < req.data.size())
+    {
+        ssize_t n = pread(req.fd, req.data.data() + req.done, req.data.size() - req.done, (off_t)req.done);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            // The file shrank under us; keep what was there.
+            req.data.resize(req.done);
+            return n == 0;
+        }
+        req.done += (size_t)n;
+    }
+    return true;
+#endif
+}
+
+struct AsyncFileReaderImpl {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::unique_ptr<IoRequest>> queue;
+    // Started requests; true once cancelled.
+    std::unordered_map<uint64_t, bool> inFlight;
+    uint64_t nextId = 1;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+
+#if defined(ARENA_IO_URING)
+    int ringFd = -1;
+    int eventFd = -1;
+    unsigned depth = 0;
+    unsigned ringReads = 0;
+    unsigned toSubmit = 0;
+    uint8_t* ringMap = nullptr;
+    size_t ringMapSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    uint64_t eventValue = 0;
+    struct iovec eventIov;
+#endif
+
+    bool usingRing() const
+    {
+#if defined(ARENA_IO_URING)
+        return ringFd >= 0;
+#else
+        return false;
+#endif
+    }
+
+    void notify()
+    {
+#if defined(ARENA_IO_URING)
+        if (ringFd >= 0)
+        {
+            uint64_t one = 1;
+            ssize_t n = write(eventFd, &one, sizeof(one));
+            (void)n;
+            return;
+        }
+#endif
+        wake.notify_all();
+    }
+
+    // Caller holds the lock and the queue is not empty.
+    std::unique_ptr<IoRequest> startNextLocked()
+    {
+        std::pop_heap(queue.begin(), queue.end(), ioRequestLess);
+        std::unique_ptr<IoRequest> req = std::move(queue.back());
+        queue.pop_back();
+        inFlight[req->id] = false;
+        return req;
+    }
+
+    bool isCancelled(uint64_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return inFlight[id];
+    }
+
+    void finish(std::unique_ptr<IoRequest> req, bool ok)
+    {
+        ioClose(*req);
+        bool cancelled = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = inFlight[req->id];
+            inFlight.erase(req->id);
+        }
+        ioComplete(std::move(req), ok, cancelled);
+    }
+
+    void fallbackLoop()
+    {
+        for (;;)
+        {
+            std::unique_ptr<IoRequest> req;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+                if (queue.empty())
+                {
+                    return;
+                }
+                req = startNextLocked();
+            }
+            bool ok = ioOpen(*req) && ioReadBlocking(*req);
+            finish(std::move(req), ok);
+        }
+    }
+
+#if defined(ARENA_IO_URING)
+    bool setupRing(unsigned entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (fd < 0)
+        {
+            return false;
+        }
+        // Older kernels map the two rings separately; not worth supporting.
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+        {
+            close(fd);
+            return false;
+        }
+
+        size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ringMapSize = std::max(sqSize, cqSize);
+        void* map = mmap(nullptr, ringMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (map == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqeMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqeMap == MAP_FAILED)
+        {
+            munmap(map, ringMapSize);
+            close(fd);
+            return false;
+        }
+        eventFd = eventfd(0, EFD_CLOEXEC);
+        if (eventFd < 0)
+        {
+            munmap(sqeMap, sqesSize);
+            munmap(map, ringMapSize);
+            close(fd);
+            return false;
+        }
+
+        ringFd = fd;
+        depth = params.sq_entries;
+        ringMap = (uint8_t*)map;
+        sqes = (io_uring_sqe*)sqeMap;
+        sqTail = (unsigned*)(ringMap + params.sq_off.tail);
+        sqMask = (unsigned*)(ringMap + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(ringMap + params.sq_off.array);
+        cqHead = (unsigned*)(ringMap + params.cq_off.head);
+        cqTail = (unsigned*)(ringMap + params.cq_off.tail);
+        cqMask = (unsigned*)(ringMap + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(ringMap + params.cq_off.cqes);
+        return true;
+    }
+
+    void teardownRing()
+    {
+        if (ringFd < 0)
+        {
+            return;
+        }
+        munmap(sqes, sqesSize);
+        munmap(ringMap, ringMapSize);
+        close(ringFd);
+        close(eventFd);
+        ringFd = -1;
+        eventFd = -1;
+    }
+
+    // Only the ring thread produces, so the tail needs no atomic read.
+    void pushReadv(int fd, struct iovec* iov, uint64_t offset, uint64_t userData)
+    {
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->addr = (uint64_t)(uintptr_t)iov;
+        sqe->len = 1;
+        sqe->off = offset;
+        sqe->user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        ++toSubmit;
+    }
+
+    void submitRead(IoRequest* req)
+    {
+        req->iov.iov_base = req->data.data() + req->done;
+        req->iov.iov_len = req->data.size() - req->done;
+        pushReadv(req->fd, &req->iov, req->done, (uint64_t)(uintptr_t)req);
+    }
+
+    // A pending read on the eventfd: new requests or shutdown complete it,
+    // waking the ring thread out of io_uring_enter. user_data 0 marks it.
+    void armWakeup()
+    {
+        eventIov.iov_base = &eventValue;
+        eventIov.iov_len = sizeof(eventValue);
+        pushReadv(eventFd, &eventIov, 0, 0);
+    }
+
+    void ringLoop()
+    {
+        armWakeup();
+        for (;;)
+        {
+            std::vector<std::unique_ptr<IoRequest>> started;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (stopping && queue.empty() && inFlight.empty())
+                {
+                    break;
+                }
+                // One slot stays free for the wakeup read.
+                while (ringReads + started.size() + 1 < depth && !queue.empty())
+                {
+                    started.push_back(startNextLocked());
+                }
+            }
+            for (std::unique_ptr<IoRequest>& req : started)
+            {
+                if (!ioOpen(*req))
+                {
+                    finish(std::move(req), false);
+                }
+                else if (req->data.empty())
+                {
+                    finish(std::move(req), true);
+                }
+                else
+                {
+                    submitRead(req.release());
+                    ++ringReads;
+                }
+            }
+
+            int submitted = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (submitted < 0)
+            {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                {
+                    continue;
+                }
+                printf("ERROR::IO => io_uring_enter failed: %s\n", strerror(errno));
+                abort();
+            }
+            toSubmit -= (unsigned)submitted;
+
+            bool rearm = false;
+            unsigned head = __atomic_load_n(cqHead, __ATOMIC_RELAXED);
+            unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            while (head != tail)
+            {
+                const io_uring_cqe* cqe = &cqes[head & *cqMask];
+                uint64_t userData = cqe->user_data;
+                int res = cqe->res;
+                ++head;
+                if (userData == 0)
+                {
+                    rearm = true;
+                    continue;
+                }
+                IoRequest* req = (IoRequest*)(uintptr_t)userData;
+                if (res == -EINTR || res == -EAGAIN)
+                {
+                    submitRead(req);
+                    continue;
+                }
+                if (res > 0)
+                {
+                    req->done += (size_t)res;
+                    if (req->done < req->data.size() && !isCancelled(req->id))
+                    {
+                        submitRead(req);
+                        continue;
+                    }
+                }
+                else if (res == 0)
+                {
+                    req->data.resize(req->done);
+                }
+                --ringReads;
+                finish(std::unique_ptr<IoRequest>(req), res >= 0);
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            if (rearm)
+            {
+                armWakeup();
+            }
+        }
+    }
+#endif
+};
+
+AsyncFileReader::AsyncFileReader(unsigned fallbackThreads, unsigned queueDepth)
+    : impl(new AsyncFileReaderImpl())
+{
+    AsyncFileReaderImpl* io = impl.get();
+#if defined(ARENA_IO_URING)
+    if (!getenv("ARENA_NO_IO_URING") && io->setupRing(std::max(4U, queueDepth)))
+    {
+        io->threads.emplace_back([io]() { io->ringLoop(); });
+        return;
+    }
+#else
+    (void)queueDepth;
+#endif
+    for (unsigned i = 0; i < std::max(1U, fallbackThreads); ++i)
+    {
+        io->threads.emplace_back([io]() { io->fallbackLoop(); });
+    }
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    std::vector<std::unique_ptr<IoRequest>> dropped;
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->stopping = true;
+        dropped.swap(impl->queue);
+        for (auto& it : impl->inFlight)
+        {
+            it.second = true;
+        }
+    }
+    for (std::unique_ptr<IoRequest>& req : dropped)
+    {
+        ioComplete(std::move(req), false, true);
+    }
+    impl->notify();
+    for (std::thread& t : impl->threads)
+    {
+        t.join();
+    }
+#if defined(ARENA_IO_URING)
+    impl->teardownRing();
+#endif
+}
+
+uint64_t AsyncFileReader::read(const std::string& path, IoPriority priority, IoCallback onComplete)
+{
+    std::unique_ptr<IoRequest> req(new IoRequest());
+    req->path = path;
+    req->priority = priority;
+    req->onComplete = std::move(onComplete);
+    uint64_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        assert(!impl->stopping);
+        id = impl->nextId++;
+        req->id = id;
+        req->sequence = id;
+        impl->queue.push_back(std::move(req));
+        std::push_heap(impl->queue.begin(), impl->queue.end(), ioRequestLess);
+    }
+    impl->notify();
+    return id;
+}
+
+bool AsyncFileReader::cancel(uint64_t id)
+{
+    std::unique_ptr<IoRequest> req;
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        auto it = std::find_if(impl->queue.begin(), impl->queue.end(), [id](const std::unique_ptr<IoRequest>& r) { return r->id == id; });
+        if (it == impl->queue.end())
+        {
+            auto running = impl->inFlight.find(id);
+            if (running == impl->inFlight.end())
+            {
+                return false;
+            }
+            running->second = true;
+            return true;
+        }
+        req = std::move(*it);
+        impl->queue.erase(it);
+        std::make_heap(impl->queue.begin(), impl->queue.end(), ioRequestLess);
+    }
+    ioComplete(std::move(req), false, true);
+    return true;
+}
+
+bool AsyncFileReader::usingIoUring() const
+{
+    return impl->usingRing();
+}
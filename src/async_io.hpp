@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+enum class IoPriority {
+    Low,
+    Normal,
+    High,
+};
+
+struct IoResult {
+    uint64_t id = 0;
+    std::string path;
+    std::vector<uint8_t> data;
+    bool ok = false;
+    bool cancelled = false;
+};
+
+using IoCallback = std::function<void(IoResult&)>;
+
+struct AsyncFileReaderImpl;
+
+// Reads whole files in the background, highest priority first and in
+// submission order within a priority.
+//
+// On Linux the reads are batched through one io_uring driven by a single I/O
+// thread; elsewhere, or when the kernel refuses a ring, a few threads read
+// with pread. Callbacks run on those I/O threads, so they should only hand
+// the bytes on (e.g. to a WorkerPool) and return. A request cancelled before
+// it starts calls back on the cancelling thread with cancelled set; one
+// cancelled mid-read calls back when the read ends, with no data.
+struct AsyncFileReader {
+    std::unique_ptr<AsyncFileReaderImpl> impl;
+
+    explicit AsyncFileReader(unsigned fallbackThreads = 2, unsigned queueDepth = 32);
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    uint64_t read(const std::string& path, IoPriority priority, IoCallback onComplete);
+    // false if the request already finished or never existed.
+    bool cancel(uint64_t id);
+    bool usingIoUring() const;
+};
@@ -0,0 +1,699 @@
+#include "baked_model.hpp"
+#include "lz4_block.hpp"
+#include "mapped_file.hpp"
+#include "worker_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// Loads fill arrays after the Mesh that owns them has moved into place.
+static_assert(std::is_nothrow_move_constructible<Mesh>::value, "Mesh buffers must survive a move");
+
+static uint64_t bakedAlign(uint64_t offset)
+{
+    return (offset + ARENA_MESH_ALIGNMENT - 1) & ~(uint64_t)(ARENA_MESH_ALIGNMENT - 1);
+}
+
+struct BakedWriter {
+    std::vector<uint8_t> bytes;
+    std::vector<ArenaMeshSection> sections;
+    // Image ranges of the runtime arrays, in order.
+    std::vector<std::pair<uint64_t, uint64_t>> arrays;
+
+    void align()
+    {
+        bytes.resize((size_t)bakedAlign(bytes.size()), 0);
+    }
+
+    uint64_t write(const void* src, size_t size)
+    {
+        align();
+        uint64_t offset = bytes.size();
+        bytes.resize(bytes.size() + size);
+        if (size)
+        {
+            memcpy(bytes.data() + offset, src, size);
+        }
+        return offset;
+    }
+
+    uint64_t writeArray(const void* src, size_t size)
+    {
+        uint64_t offset = write(src, size);
+        arrays.push_back({offset, offset + size});
+        return offset;
+    }
+
+    void beginSection(uint32_t type)
+    {
+        align();
+        sections.push_back({type, 0, bytes.size(), 0});
+    }
+
+    void endSection()
+    {
+        sections.back().size = bytes.size() - sections.back().offset;
+    }
+};
+
+// Reads the image of a file through its chunks. Structure is read while
+// parsing, decompressing the chunks it lies in; arrays are only sized and
+// recorded, then filled by finish() in one parallel pass over the chunks.
+struct BakedReader {
+    const uint8_t* file = nullptr;
+    size_t fileSize = 0;
+    uint64_t size = 0;
+    std::vector<ArenaMeshChunk> chunks;
+    std::vector<std::vector<uint8_t>> decoded;
+
+    struct PendingArray {
+        uint64_t offset;
+        uint64_t size;
+        uint8_t* dst;
+    };
+    std::vector<PendingArray> pending;
+
+    // Checks the chunk table covers the image in order. An LZ4 block
+    // expands at most 255 times, which also bounds what a corrupt file can
+    // make a load allocate.
+    bool open(const ArenaMeshHeader& header)
+    {
+        uint64_t tableSize = (uint64_t)header.chunkCount * sizeof(ArenaMeshChunk);
+        if (tableSize > fileSize - sizeof(header))
+        {
+            return false;
+        }
+        chunks.resize(header.chunkCount);
+        memcpy(chunks.data(), file + sizeof(header), (size_t)tableSize);
+        for (const ArenaMeshChunk& c : chunks)
+        {
+            bool lz4 = (c.flags & ARENA_MESH_CHUNK_LZ4) != 0;
+            if (c.imageOffset != size || c.imageSize == 0 || c.imageSize > ARENA_MESH_CHUNK_SIZE || c.fileOffset > fileSize || c.storedSize > fileSize - c.fileOffset ||
+                (lz4 ? c.imageSize > (uint64_t)c.storedSize * 256 : c.storedSize != c.imageSize))
+            {
+                return false;
+            }
+            size += c.imageSize;
+        }
+        decoded.resize(chunks.size());
+        return size == header.imageSize;
+    }
+
+    bool inRange(uint64_t offset, uint64_t length) const
+    {
+        return offset <= size && length <= size - offset;
+    }
+
+    // The chunk holding image byte offset, which must be below size.
+    size_t chunkAt(uint64_t offset) const
+    {
+        auto it = std::upper_bound(chunks.begin(), chunks.end(), offset, [](uint64_t o, const ArenaMeshChunk& c) { return o < c.imageOffset; });
+        return (size_t)(it - chunks.begin()) - 1;
+    }
+
+    bool decompress(size_t i, uint8_t* dst) const
+    {
+        const ArenaMeshChunk& c = chunks[i];
+        if (!(c.flags & ARENA_MESH_CHUNK_LZ4))
+        {
+            memcpy(dst, file + c.fileOffset, c.imageSize);
+            return true;
+        }
+        return lz4Decompress(file + c.fileOffset, c.storedSize, dst, c.imageSize);
+    }
+
+    // Copies image bytes right away, decompressing each chunk involved once.
+    bool read(void* dst, uint64_t offset, uint64_t length)
+    {
+        if (!inRange(offset, length))
+        {
+            return false;
+        }
+        uint8_t* out = (uint8_t*)dst;
+        while (length)
+        {
+            size_t i = chunkAt(offset);
+            const ArenaMeshChunk& c = chunks[i];
+            if (decoded[i].empty())
+            {
+                decoded[i].resize(c.imageSize);
+                if (!decompress(i, decoded[i].data()))
+                {
+                    decoded[i].clear();
+                    return false;
+                }
+            }
+            uint64_t start = offset - c.imageOffset;
+            uint64_t n = std::min<uint64_t>(length, c.imageSize - start);
+            memcpy(out, decoded[i].data() + start, (size_t)n);
+            out += n;
+            offset += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool readNow(std::vector<T>& out, uint64_t offset, uint64_t count)
+    {
+        if (count > size / sizeof(T) || !inRange(offset, count * sizeof(T)))
+        {
+            return false;
+        }
+        out.resize(count);
+        return read(out.data(), offset, count * sizeof(T));
+    }
+
+    // Sizes out and leaves filling it to finish(). Its buffer must stay put
+    // until then: moving the vector is fine, but nothing may resize, assign
+    // over or destroy it.
+    template<typename T>
+    bool readArray(std::vector<T>& out, uint64_t offset, uint64_t count)
+    {
+        if (count > size / sizeof(T) || !inRange(offset, count * sizeof(T)))
+        {
+            return false;
+        }
+        out.resize(count);
+        if (count)
+        {
+            pending.push_back({offset, count * sizeof(T), (uint8_t*)out.data()});
+        }
+        return true;
+    }
+
+    // The index values themselves can only be checked after finish().
+    bool readIndices(IndexBuffer& out, uint64_t offset, uint64_t count, uint32_t indexSize)
+    {
+        if ((indexSize != 1 && indexSize != 2 && indexSize != 4) || count > size / indexSize)
+        {
+            return false;
+        }
+        out.stride = indexSize;
+        return readArray(out.data, offset, count * indexSize);
+    }
+
+    // Fills every array readArray recorded. A chunk inside a single array is
+    // decompressed straight into it; any other chunk is decompressed once
+    // and copied to each array it overlaps.
+    bool finish(WorkerPool* pool)
+    {
+        std::vector<std::vector<uint32_t>> arraysOfChunk(chunks.size());
+        for (uint32_t a = 0; a < pending.size(); ++a)
+        {
+            const PendingArray& p = pending[a];
+            for (size_t i = chunkAt(p.offset); i < chunks.size() && chunks[i].imageOffset < p.offset + p.size; ++i)
+            {
+                arraysOfChunk[i].push_back(a);
+            }
+        }
+
+        std::atomic<bool> ok(true);
+        parallelFor(pool, chunks.size(), [&](size_t i) {
+            const std::vector<uint32_t>& arrays = arraysOfChunk[i];
+            if (arrays.empty() || !ok)
+            {
+                return;
+            }
+            const ArenaMeshChunk& c = chunks[i];
+            const PendingArray& only = pending[arrays[0]];
+            if (arrays.size() == 1 && decoded[i].empty() && only.offset <= c.imageOffset && c.imageOffset + c.imageSize <= only.offset + only.size)
+            {
+                ok = ok && decompress(i, only.dst + (c.imageOffset - only.offset));
+                return;
+            }
+            std::vector<uint8_t> scratch;
+            const uint8_t* bytes = decoded[i].data();
+            if (decoded[i].empty())
+            {
+                scratch.resize(c.imageSize);
+                if (!decompress(i, scratch.data()))
+                {
+                    ok = false;
+                    return;
+                }
+                bytes = scratch.data();
+            }
+            for (uint32_t a : arrays)
+            {
+                const PendingArray& p = pending[a];
+                uint64_t begin = std::max(p.offset, c.imageOffset);
+                uint64_t end = std::min(p.offset + p.size, c.imageOffset + c.imageSize);
+                memcpy(p.dst + (begin - p.offset), bytes + (begin - c.imageOffset), (size_t)(end - begin));
+            }
+        });
+        pending.clear();
+        return ok;
+    }
+};
+
+static bool bakedIndicesInBounds(const IndexBuffer& indices, size_t vertexCount)
+{
+    bool inBounds = true;
+    indices.forEach([&inBounds, vertexCount](uint32_t idx) { inBounds = inBounds && idx < vertexCount; });
+    return inBounds;
+}
+
+bool bakedReadHeader(const char* path, ArenaMeshHeader& header)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    bool ok = fread(&header, sizeof(header), 1, f) == 1;
+    fclose(f);
+    return ok && memcmp(header.magic, ARENA_MESH_MAGIC, sizeof(header.magic)) == 0 && header.version == ARENA_MESH_VERSION;
+}
+
+uint64_t bakedContentHash(const uint8_t* data, size_t size)
+{
+    ArenaMeshHeader header;
+    if (size >= sizeof(header))
+    {
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, ARENA_MESH_MAGIC, sizeof(header.magic)) == 0 && header.version == ARENA_MESH_VERSION && header.sourceHash != 0)
+        {
+            return header.sourceHash;
+        }
+    }
+    return bakedHash(data, size, bakedHash("baked", 5));
+}
+
+bool ModelAsset::saveBaked(const char* path, uint64_t sourceHash) const
+{
+    assert(path);
+
+    BakedWriter w;
+
+    for (const Mesh& mesh : baseMeshes)
+    {
+        // Info first so its offset is the section start; patched below.
+        w.beginSection(ARENA_MESH_SECTION_MESH);
+        ArenaMeshMeshInfo info = {};
+        uint64_t infoOffset = w.write(&info, sizeof(info));
+        info.vertexCount = (uint32_t)mesh.vertexCount();
+        info.indexCount = (uint32_t)mesh.indices.size();
+        info.indexSize = mesh.indices.stride;
+        if (mesh.quantized())
+        {
+            info.flags = ARENA_MESH_FLAG_QUANTIZED;
+            memcpy(info.quantizeMin, &mesh.quantizeMin, sizeof(info.quantizeMin));
+            memcpy(info.quantizeScale, &mesh.quantizeScale, sizeof(info.quantizeScale));
+            info.weightCount = (uint32_t)mesh.packedWeights.size();
+            info.positionsOffset = w.writeArray(mesh.packedPositions.data(), mesh.packedPositions.size() * sizeof(uint16_t));
+            info.weightsOffset = w.writeArray(mesh.packedWeights.data(), mesh.packedWeights.size() * sizeof(PackedVertexWeight));
+        }
+        else
+        {
+            info.weightCount = (uint32_t)mesh.weights.size();
+            info.positionsOffset = w.writeArray(mesh.positions.data(), mesh.positions.size() * sizeof(float));
+            info.weightsOffset = w.writeArray(mesh.weights.data(), mesh.weights.size() * sizeof(VertexWeight));
+        }
+        info.indicesOffset = w.writeArray(mesh.indices.data.data(), mesh.indices.data.size());
+        std::vector<ArenaMeshLod> lods;
+        for (const MeshLod& lod : mesh.lods)
+        {
+            ArenaMeshLod entry = {};
+            entry.indexCount = (uint32_t)lod.indices.size();
+            entry.indexSize = lod.indices.stride;
+            entry.vertexCount = lod.vertexCount;
+            entry.error = lod.error;
+            entry.indicesOffset = w.writeArray(lod.indices.data.data(), lod.indices.data.size());
+            lods.push_back(entry);
+        }
+        info.lodCount = (uint32_t)lods.size();
+        info.lodsOffset = w.write(lods.data(), lods.size() * sizeof(ArenaMeshLod));
+        memcpy(w.bytes.data() + infoOffset, &info, sizeof(info));
+        w.endSection();
+    }
+
+    // Field by field, so the padding in Bone is written as zeros and the
+    // same asset always bakes to the same bytes.
+    std::vector<uint8_t> bones(boneHierarchy.size() * sizeof(Bone), 0);
+    for (size_t i = 0; i < boneHierarchy.size(); ++i)
+    {
+        uint8_t* dst = bones.data() + i * sizeof(Bone);
+        memcpy(dst + offsetof(Bone, parent), &boneHierarchy[i].parent, sizeof(Bone::parent));
+        memcpy(dst + offsetof(Bone, offsetMatrix), &boneHierarchy[i].offsetMatrix, sizeof(Bone::offsetMatrix));
+    }
+    w.beginSection(ARENA_MESH_SECTION_BONES);
+    w.writeArray(bones.data(), bones.size());
+    w.endSection();
+
+    // Names and actions sorted, since unordered_map order can differ
+    // between runs.
+    std::vector<std::pair<std::string, uint8_t>> boneNames(boneIndexMap.begin(), boneIndexMap.end());
+    std::sort(boneNames.begin(), boneNames.end());
+    w.beginSection(ARENA_MESH_SECTION_BONE_NAMES);
+    for (const auto& it : boneNames)
+    {
+        ArenaMeshBoneName entry = {(uint32_t)it.first.size(), it.second};
+        w.bytes.insert(w.bytes.end(), (const uint8_t*)&entry, (const uint8_t*)&entry + sizeof(entry));
+        w.bytes.insert(w.bytes.end(), it.first.begin(), it.first.end());
+        w.bytes.resize((w.bytes.size() + 3) & ~(size_t)3, 0);
+    }
+    w.endSection();
+
+    std::vector<const std::pair<const std::string, AnimAction>*> sortedActions;
+    for (const auto& it : actions)
+    {
+        sortedActions.push_back(&it);
+    }
+    std::sort(sortedActions.begin(), sortedActions.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+    for (const auto* it : sortedActions)
+    {
+        const std::string& name = it->first;
+        const AnimAction& action = it->second;
+        w.beginSection(ARENA_MESH_SECTION_ACTION);
+        ArenaMeshActionInfo info = {};
+        info.nameLength = (uint32_t)name.size();
+        info.keyframeCount = (uint32_t)action.keyframes.size();
+        info.boneCount = action.keyframes.empty() ? 0 : (uint32_t)action.keyframes[0].locations.size();
+        info.duration = action.duration;
+        w.write(&info, sizeof(info));
+        w.write(name.data(), name.size());
+        std::vector<double> timeStamps;
+        for (const AnimKeyFrame& frame : action.keyframes)
+        {
+            timeStamps.push_back(frame.timeStamp);
+        }
+        w.write(timeStamps.data(), timeStamps.size() * sizeof(double));
+        for (const AnimKeyFrame& frame : action.keyframes)
+        {
+            assert(frame.locations.size() == info.boneCount && frame.rotations.size() == info.boneCount && frame.scales.size() == info.boneCount);
+            w.writeArray(frame.locations.data.data(), frame.locations.data.size() * sizeof(float));
+            w.writeArray(frame.rotations.data.data(), frame.rotations.data.size() * sizeof(float));
+            w.writeArray(frame.scales.data.data(), frame.scales.data.size() * sizeof(float));
+        }
+        w.endSection();
+    }
+
+    w.write(w.sections.data(), w.sections.size() * sizeof(ArenaMeshSection));
+
+    // Arrays big enough to matter get chunks of their own, so loads can
+    // decompress straight into them; what lies between is chunked as is.
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    auto split = [&ranges](uint64_t begin, uint64_t end) {
+        for (; begin < end; begin += ARENA_MESH_CHUNK_SIZE)
+        {
+            ranges.push_back({begin, std::min<uint64_t>(end, begin + ARENA_MESH_CHUNK_SIZE)});
+        }
+    };
+    uint64_t cursor = 0;
+    for (const auto& array : w.arrays)
+    {
+        if (array.second - array.first >= ARENA_MESH_CHUNK_SIZE / 16)
+        {
+            split(cursor, array.first);
+            split(array.first, array.second);
+            cursor = array.second;
+        }
+    }
+    split(cursor, w.bytes.size());
+
+    std::vector<ArenaMeshChunk> chunks(ranges.size());
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> packed(lz4CompressBound(ARENA_MESH_CHUNK_SIZE));
+    uint64_t dataOffset = sizeof(ArenaMeshHeader) + chunks.size() * sizeof(ArenaMeshChunk);
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        ArenaMeshChunk& chunk = chunks[i];
+        const uint8_t* src = w.bytes.data() + ranges[i].first;
+        chunk.imageOffset = ranges[i].first;
+        chunk.imageSize = (uint32_t)(ranges[i].second - ranges[i].first);
+        chunk.fileOffset = dataOffset + payload.size();
+        size_t packedSize = lz4Compress(src, chunk.imageSize, packed.data(), packed.size());
+        if (packedSize && packedSize < chunk.imageSize)
+        {
+            chunk.storedSize = (uint32_t)packedSize;
+            chunk.flags = ARENA_MESH_CHUNK_LZ4;
+            payload.insert(payload.end(), packed.begin(), packed.begin() + packedSize);
+        }
+        else
+        {
+            chunk.storedSize = chunk.imageSize;
+            payload.insert(payload.end(), src, src + chunk.imageSize);
+        }
+    }
+
+    ArenaMeshHeader header = {};
+    memcpy(header.magic, ARENA_MESH_MAGIC, sizeof(header.magic));
+    header.version = ARENA_MESH_VERSION;
+    header.sectionCount = (uint32_t)w.sections.size();
+    header.fileSize = dataOffset + payload.size();
+    header.sourceHash = sourceHash;
+    header.imageSize = w.bytes.size();
+    header.chunkCount = (uint32_t)chunks.size();
+
+    FILE* f = fopen(path, "wb");
+    if (!f)
+    {
+        printf("ERROR::BAKED => cannot write %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(chunks.data(), sizeof(ArenaMeshChunk), chunks.size(), f) == chunks.size();
+    ok = ok && fwrite(payload.data(), 1, payload.size(), f) == payload.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok)
+    {
+        printf("ERROR::BAKED => short write to %s\n", path);
+    }
+    return ok;
+}
+
+bool ModelAsset::loadBaked(const char* path, WorkerPool* pool)
+{
+    assert(path);
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        printf("ERROR::BAKED => cannot open %s\n", path);
+        return false;
+    }
+    return loadBakedFromMemory(file.data(), file.size(), path, pool);
+}
+
+bool ModelAsset::loadBakedFromMemory(const uint8_t* data, size_t size, const char* path, WorkerPool* pool)
+{
+    assert(data || size == 0);
+    assert(path);
+
+    BakedReader r;
+    r.file = data;
+    r.fileSize = size;
+    ArenaMeshHeader header;
+    if (size < sizeof(header))
+    {
+        printf("ERROR::BAKED => %s is truncated\n", path);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, ARENA_MESH_MAGIC, sizeof(header.magic)) != 0 || header.fileSize != size)
+    {
+        printf("ERROR::BAKED => %s is not an .arenamesh file\n", path);
+        return false;
+    }
+    if (header.version != ARENA_MESH_VERSION)
+    {
+        printf("ERROR::BAKED => %s has version %u, expected %u\n", path, header.version, ARENA_MESH_VERSION);
+        return false;
+    }
+
+    if (!r.open(header))
+    {
+        printf("ERROR::BAKED => %s has a corrupt chunk table\n", path);
+        return false;
+    }
+
+    // The section table is the last thing in the image.
+    uint64_t tableSize = (uint64_t)header.sectionCount * sizeof(ArenaMeshSection);
+    std::vector<ArenaMeshSection> sections;
+    if (tableSize > r.size || !r.readNow(sections, r.size - tableSize, header.sectionCount))
+    {
+        printf("ERROR::BAKED => %s has a corrupt section table\n", path);
+        return false;
+    }
+
+    baseMeshes.clear();
+    boneHierarchy.clear();
+    boneIndexMap.clear();
+    actions.clear();
+
+    // Each of these may only appear once; a second read into the same
+    // vector would free the buffer a pending read still points at.
+    bool seenBones = false;
+    bool seenBoneNames = false;
+    bool ok = true;
+    for (const ArenaMeshSection& section : sections)
+    {
+        if (!r.inRange(section.offset, section.size))
+        {
+            ok = false;
+            break;
+        }
+        if (section.type == ARENA_MESH_SECTION_MESH)
+        {
+            ArenaMeshMeshInfo info;
+            if (section.size < sizeof(info) || !r.read(&info, section.offset, sizeof(info)))
+            {
+                ok = false;
+                break;
+            }
+            Mesh mesh;
+            if (info.flags & ARENA_MESH_FLAG_QUANTIZED)
+            {
+                memcpy(&mesh.quantizeMin, info.quantizeMin, sizeof(info.quantizeMin));
+                memcpy(&mesh.quantizeScale, info.quantizeScale, sizeof(info.quantizeScale));
+                ok = r.readArray(mesh.packedPositions, info.positionsOffset, (uint64_t)info.vertexCount * 3) &&
+                     r.readArray(mesh.packedWeights, info.weightsOffset, info.weightCount);
+            }
+            else
+            {
+                ok = r.readArray(mesh.positions, info.positionsOffset, (uint64_t)info.vertexCount * 3) &&
+                     r.readArray(mesh.weights, info.weightsOffset, info.weightCount);
+            }
+            ok = ok && r.readIndices(mesh.indices, info.indicesOffset, info.indexCount, info.indexSize);
+            std::vector<ArenaMeshLod> lods;
+            ok = ok && r.readNow(lods, info.lodsOffset, info.lodCount);
+            mesh.lods.resize(ok ? lods.size() : 0);
+            for (size_t l = 0; ok && l < lods.size(); ++l)
+            {
+                MeshLod& lod = mesh.lods[l];
+                lod.vertexCount = lods[l].vertexCount;
+                lod.error = lods[l].error;
+                ok = lod.vertexCount <= info.vertexCount && r.readIndices(lod.indices, lods[l].indicesOffset, lods[l].indexCount, lods[l].indexSize);
+            }
+            baseMeshes.push_back(std::move(mesh));
+        }
+        else if (section.type == ARENA_MESH_SECTION_BONES)
+        {
+            ok = !seenBones && r.readArray(boneHierarchy, section.offset, section.size / sizeof(Bone));
+            seenBones = true;
+        }
+        else if (section.type == ARENA_MESH_SECTION_BONE_NAMES)
+        {
+            std::vector<uint8_t> names;
+            ok = !seenBoneNames && r.readNow(names, section.offset, section.size);
+            seenBoneNames = true;
+            const uint8_t* p = names.data();
+            const uint8_t* end = p + names.size();
+            while (ok && p < end)
+            {
+                ArenaMeshBoneName entry;
+                ok = (size_t)(end - p) >= sizeof(entry);
+                if (!ok)
+                {
+                    break;
+                }
+                memcpy(&entry, p, sizeof(entry));
+                p += sizeof(entry);
+                ok = entry.nameLength <= (size_t)(end - p) && entry.boneIndex <= UINT8_MAX;
+                if (ok)
+                {
+                    boneIndexMap[std::string((const char*)p, entry.nameLength)] = (uint8_t)entry.boneIndex;
+                    p += (entry.nameLength + 3) & ~3U;
+                }
+            }
+        }
+        else if (section.type == ARENA_MESH_SECTION_ACTION)
+        {
+            ArenaMeshActionInfo info;
+            if (section.size < sizeof(info) || !r.read(&info, section.offset, sizeof(info)))
+            {
+                ok = false;
+                break;
+            }
+            uint64_t offset = bakedAlign(section.offset + sizeof(info));
+            std::string name(r.inRange(offset, info.nameLength) ? info.nameLength : 0, '\0');
+            ok = name.size() == info.nameLength && r.read(&name[0], offset, info.nameLength) && actions.count(name) == 0;
+            if (!ok)
+            {
+                break;
+            }
+            offset = bakedAlign(offset + info.nameLength);
+
+            std::vector<double> timeStamps;
+            ok = r.readNow(timeStamps, offset, info.keyframeCount);
+            offset += (uint64_t)info.keyframeCount * sizeof(double);
+
+            AnimAction action;
+            action.duration = info.duration;
+            action.keyframes.resize(ok ? info.keyframeCount : 0);
+            for (uint32_t k = 0; ok && k < info.keyframeCount; ++k)
+            {
+                AnimKeyFrame& frame = action.keyframes[k];
+                frame.timeStamp = timeStamps[k];
+                offset = bakedAlign(offset);
+                ok = r.readArray(frame.locations.data, offset, (uint64_t)info.boneCount * 3);
+                offset = bakedAlign(offset + (uint64_t)info.boneCount * 3 * sizeof(float));
+                ok = ok && r.readArray(frame.rotations.data, offset, (uint64_t)info.boneCount * 4);
+                offset = bakedAlign(offset + (uint64_t)info.boneCount * 4 * sizeof(float));
+                ok = ok && r.readArray(frame.scales.data, offset, (uint64_t)info.boneCount * 3);
+                offset += (uint64_t)info.boneCount * 3 * sizeof(float);
+                frame.locations.count = info.boneCount;
+                frame.rotations.count = info.boneCount;
+                frame.scales.count = info.boneCount;
+            }
+            actions[name] = std::move(action);
+        }
+        if (!ok)
+        {
+            break;
+        }
+    }
+
+    ok = ok && r.finish(pool);
+
+    for (size_t i = 0; ok && i < boneHierarchy.size(); ++i)
+    {
+        ok = boneHierarchy[i].parent < boneHierarchy.size();
+    }
+    // Sampling indexes the keys by bone.
+    for (auto it = actions.begin(); ok && it != actions.end(); ++it)
+    {
+        for (size_t k = 0; ok && k < it->second.keyframes.size(); ++k)
+        {
+            ok = it->second.keyframes[k].locations.size() == boneHierarchy.size();
+        }
+    }
+    for (size_t m = 0; ok && m < baseMeshes.size(); ++m)
+    {
+        const Mesh& mesh = baseMeshes[m];
+        ok = (mesh.weights.empty() || mesh.weights.size() == mesh.vertexCount()) && (mesh.packedWeights.empty() || mesh.packedWeights.size() == mesh.vertexCount()) &&
+             bakedIndicesInBounds(mesh.indices, mesh.vertexCount());
+        for (size_t l = 0; ok && l < mesh.lods.size(); ++l)
+        {
+            ok = bakedIndicesInBounds(mesh.lods[l].indices, mesh.lods[l].vertexCount);
+        }
+        for (size_t i = 0; ok && i < mesh.weights.size(); ++i)
+        {
+            for (int k = 0; ok && k < MODEL_BONE_INFLUENCE_MAX; ++k)
+            {
+                ok = mesh.weights[i].boneIndices[k] < boneHierarchy.size();
+            }
+        }
+        for (size_t i = 0; ok && i < mesh.packedWeights.size(); ++i)
+        {
+            for (int k = 0; ok && k < MODEL_BONE_INFLUENCE_MAX; ++k)
+            {
+                ok = mesh.packedWeights[i].boneIndices[k] < boneHierarchy.size();
+            }
+        }
+    }
+    if (!ok)
+    {
+        printf("ERROR::BAKED => %s is corrupt\n", path);
+        baseMeshes.clear();
+        boneHierarchy.clear();
+        boneIndexMap.clear();
+        actions.clear();
+        return false;
+    }
+
+    return true;
+}
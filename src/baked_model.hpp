@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include "model.hpp"
+
+// .arenamesh: the baked form of a ModelAsset, read back by
+// ModelAsset::loadBaked.
+//
+// The file is a header, the chunk table, then the chunks. Decompressed and
+// laid end to end, the chunks form the image: the section payloads followed
+// by the section table. Every array in the image is stored exactly as the
+// runtime holds it (float or quantized xyz positions, VertexWeight or
+// PackedVertexWeight, 1, 2 or 4 byte indices, Bone, SoA keyframe blocks) at
+// a 16-byte aligned image offset, and all offsets other than the chunks'
+// fileOffset are image offsets.
+//
+// Each chunk is compressed on its own in the LZ4 block format (see
+// lz4_block.hpp) and covers at most ARENA_MESH_CHUNK_SIZE image bytes.
+// Large arrays start a fresh chunk, so a loader can decompress chunks in
+// parallel straight into the arrays they belong to. Files are little-endian.
+
+#define ARENA_MESH_MAGIC "ARNAMESH"
+#define ARENA_MESH_VERSION 6
+#define ARENA_MESH_ALIGNMENT 16
+#define ARENA_MESH_CHUNK_SIZE (256 * 1024)
+
+#define ARENA_MESH_FLAG_QUANTIZED 1U
+
+// Chunks without this flag are stored raw.
+#define ARENA_MESH_CHUNK_LZ4 1U
+
+enum ArenaMeshSectionType : uint32_t {
+    ARENA_MESH_SECTION_MESH = 1,
+    ARENA_MESH_SECTION_BONES = 2,
+    ARENA_MESH_SECTION_BONE_NAMES = 3,
+    ARENA_MESH_SECTION_ACTION = 4,
+};
+
+struct ArenaMeshHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sectionCount;
+    uint64_t fileSize;
+    uint64_t sourceHash;
+    uint64_t imageSize;
+    uint32_t chunkCount;
+    uint32_t reserved;
+};
+
+// ArenaMeshChunk[chunkCount] follows the header, in image order with no
+// gaps.
+struct ArenaMeshChunk {
+    uint64_t imageOffset;
+    uint64_t fileOffset;
+    uint32_t imageSize;
+    uint32_t storedSize;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+struct ArenaMeshSection {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// ARENA_MESH_SECTION_MESH payload; the arrays follow at the given offsets.
+// lodsOffset points at ArenaMeshLod[lodCount], coarser levels in order.
+// indexSize is the bytes per index of that index list. With
+// ARENA_MESH_FLAG_QUANTIZED, positions are uint16_t[3] decoded through
+// quantizeMin/quantizeScale and weights are PackedVertexWeight.
+struct ArenaMeshMeshInfo {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t weightCount;
+    uint32_t lodCount;
+    uint64_t positionsOffset;
+    uint64_t weightsOffset;
+    uint64_t indicesOffset;
+    uint64_t lodsOffset;
+    uint32_t indexSize;
+    uint32_t flags;
+    float quantizeMin[3];
+    float quantizeScale[3];
+};
+
+struct ArenaMeshLod {
+    uint32_t indexCount;
+    uint32_t vertexCount;
+    float error;
+    uint32_t indexSize;
+    uint64_t indicesOffset;
+};
+
+// ARENA_MESH_SECTION_BONES payload is Bone[boneCount]; BONE_NAMES is a list
+// of these, each followed by the name bytes padded to 4.
+struct ArenaMeshBoneName {
+    uint32_t nameLength;
+    uint32_t boneIndex;
+};
+
+// ARENA_MESH_SECTION_ACTION payload: this, the name, double
+// timeStamps[keyframeCount], then for each keyframe the locations, rotations
+// and scales blocks of boneCount keys each; every part starts aligned.
+// boneCount is the size of the bone hierarchy unless there are no keyframes.
+// Actions are stored sorted by name and bone names by name as well.
+struct ArenaMeshActionInfo {
+    uint32_t nameLength;
+    uint32_t keyframeCount;
+    uint32_t boneCount;
+    uint32_t reserved;
+    double duration;
+};
+
+static_assert(sizeof(ArenaMeshHeader) == 48, "ArenaMeshHeader layout");
+static_assert(sizeof(ArenaMeshChunk) == 32, "ArenaMeshChunk layout");
+static_assert(sizeof(ArenaMeshSection) == 24, "ArenaMeshSection layout");
+static_assert(sizeof(ArenaMeshLod) == 24, "ArenaMeshLod layout");
+static_assert(std::is_trivially_copyable<Bone>::value, "Bone is stored verbatim");
+static_assert(std::is_trivially_copyable<VertexWeight>::value, "VertexWeight is stored verbatim");
+static_assert(sizeof(VertexWeight) == MODEL_BONE_INFLUENCE_MAX * 5, "VertexWeight layout");
+static_assert(sizeof(PackedVertexWeight) == MODEL_BONE_INFLUENCE_MAX * 2, "PackedVertexWeight layout");
+static_assert(sizeof(ArenaMeshMeshInfo) == 80, "ArenaMeshMeshInfo layout");
+
+// FNV-1a, used to key baked files to the bytes they were cooked from.
+inline uint64_t bakedHash(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Reads just the header of a baked file; false if it is missing or not an
+// .arenamesh of the current version.
+bool bakedReadHeader(const char* path, ArenaMeshHeader& header);
+
+// Identity of a baked file's contents: the source hash it was cooked with,
+// or a hash of the bytes for files baked without one.
+uint64_t bakedContentHash(const uint8_t* data, size_t size);
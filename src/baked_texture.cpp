@@ -0,0 +1,153 @@
+#include "baked_texture.hpp"
+#include "baked_model.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static uint64_t textureBakedAlign(uint64_t offset)
+{
+    return (offset + ARENA_TEX_ALIGNMENT - 1) & ~(uint64_t)(ARENA_TEX_ALIGNMENT - 1);
+}
+
+bool textureSaveBaked(const char* path, const TextureImage& image, uint64_t sourceHash)
+{
+    assert(path);
+    assert(!image.mips.empty() && image.mips.size() <= ARENA_TEX_MAX_MIPS);
+
+    ArenaTexHeader header = {};
+    memcpy(header.magic, ARENA_TEX_MAGIC, sizeof(header.magic));
+    header.version = ARENA_TEX_VERSION;
+    header.format = (uint32_t)image.format;
+    header.width = image.mips[0].width;
+    header.height = image.mips[0].height;
+    header.mipCount = (uint32_t)image.mips.size();
+    header.sourceHash = sourceHash;
+
+    std::vector<ArenaTexMip> table;
+    uint64_t offset = sizeof(ArenaTexHeader) + image.mips.size() * sizeof(ArenaTexMip);
+    for (const TextureMip& mip : image.mips)
+    {
+        assert(mip.data.size() == textureLevelBytes(image.format, mip.width, mip.height));
+        offset = textureBakedAlign(offset);
+        table.push_back({mip.width, mip.height, offset, mip.data.size()});
+        offset += mip.data.size();
+    }
+    header.fileSize = offset;
+
+    std::vector<uint8_t> bytes((size_t)offset, 0);
+    memcpy(bytes.data(), &header, sizeof(header));
+    memcpy(bytes.data() + sizeof(header), table.data(), table.size() * sizeof(ArenaTexMip));
+    for (size_t level = 0; level < image.mips.size(); ++level)
+    {
+        memcpy(bytes.data() + table[level].offset, image.mips[level].data.data(), image.mips[level].data.size());
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f)
+    {
+        printf("ERROR::BAKED => cannot write %s\n", path);
+        return false;
+    }
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok)
+    {
+        printf("ERROR::BAKED => short write to %s\n", path);
+    }
+    return ok;
+}
+
+bool textureLoadBaked(const char* path, TextureImage& out)
+{
+    assert(path);
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        printf("ERROR::BAKED => cannot open %s\n", path);
+        return false;
+    }
+    return textureLoadBakedFromMemory(file.data(), file.size(), path, out);
+}
+
+bool textureLoadBakedFromMemory(const uint8_t* data, size_t size, const char* path, TextureImage& out)
+{
+    assert(data || size == 0);
+    assert(path);
+
+    ArenaTexHeader header;
+    if (size < sizeof(header))
+    {
+        printf("ERROR::BAKED => %s is truncated\n", path);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, ARENA_TEX_MAGIC, sizeof(header.magic)) != 0 || header.fileSize != size)
+    {
+        printf("ERROR::BAKED => %s is not an .arenatex file\n", path);
+        return false;
+    }
+    if (header.version != ARENA_TEX_VERSION)
+    {
+        printf("ERROR::BAKED => %s has version %u, expected %u\n", path, header.version, ARENA_TEX_VERSION);
+        return false;
+    }
+    TextureFormat format = (TextureFormat)header.format;
+    if (format >= TextureFormat::Count || header.mipCount == 0 || header.mipCount > ARENA_TEX_MAX_MIPS ||
+        sizeof(header) + (size_t)header.mipCount * sizeof(ArenaTexMip) > size)
+    {
+        printf("ERROR::BAKED => %s has a corrupt header\n", path);
+        return false;
+    }
+
+    std::vector<ArenaTexMip> table(header.mipCount);
+    memcpy(table.data(), data + sizeof(header), table.size() * sizeof(ArenaTexMip));
+    out.format = format;
+    out.mips.clear();
+    out.mips.resize(table.size());
+    for (size_t level = 0; level < table.size(); ++level)
+    {
+        const ArenaTexMip& mip = table[level];
+        // Each level is half the one before, rounded down, and at least 1.
+        uint32_t width = level == 0 ? header.width : std::max(table[level - 1].width / 2, 1U);
+        uint32_t height = level == 0 ? header.height : std::max(table[level - 1].height / 2, 1U);
+        if (mip.width != width || mip.height != height || width == 0 || height == 0 || mip.size != textureLevelBytes(format, width, height) ||
+            mip.offset > size || mip.size > size - mip.offset)
+        {
+            printf("ERROR::BAKED => %s has a corrupt mip table\n", path);
+            out.mips.clear();
+            return false;
+        }
+        out.mips[level].width = width;
+        out.mips[level].height = height;
+        out.mips[level].data.assign(data + mip.offset, data + mip.offset + mip.size);
+    }
+    return true;
+}
+
+bool textureReadBakedHeader(const char* path, ArenaTexHeader& header)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        return false;
+    }
+    bool ok = fread(&header, sizeof(header), 1, f) == 1;
+    fclose(f);
+    return ok && memcmp(header.magic, ARENA_TEX_MAGIC, sizeof(header.magic)) == 0 && header.version == ARENA_TEX_VERSION;
+}
+
+uint64_t textureBakedContentHash(const uint8_t* data, size_t size)
+{
+    ArenaTexHeader header;
+    if (size >= sizeof(header))
+    {
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, ARENA_TEX_MAGIC, sizeof(header.magic)) == 0 && header.version == ARENA_TEX_VERSION && header.sourceHash != 0)
+        {
+            return header.sourceHash;
+        }
+    }
+    return bakedHash(data, size, bakedHash("texture", 7));
+}
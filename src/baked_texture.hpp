@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include "texture.hpp"
+
+// .arenatex: the baked form of a TextureImage, usually block compressed by
+// arena-bake, read back by textureLoadBaked.
+//
+// A header, the mip table, then each level's data exactly as GL takes it at
+// a 16-byte aligned offset, so loading is a bounds check and one copy per
+// level. Files are little-endian; offsets are absolute.
+
+#define ARENA_TEX_MAGIC "ARNATEX\0"
+#define ARENA_TEX_VERSION 1
+#define ARENA_TEX_ALIGNMENT 16
+#define ARENA_TEX_MAX_MIPS 32
+
+struct ArenaTexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+    uint32_t reserved;
+    uint64_t fileSize;
+    uint64_t sourceHash;
+};
+
+// ArenaTexMip[mipCount] follows the header, largest level first. size is
+// always textureLevelBytes(format, width, height).
+struct ArenaTexMip {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+static_assert(sizeof(ArenaTexHeader) == 48, "ArenaTexHeader layout");
+static_assert(sizeof(ArenaTexMip) == 24, "ArenaTexMip layout");
+
+bool textureSaveBaked(const char* path, const TextureImage& image, uint64_t sourceHash);
+
+bool textureLoadBaked(const char* path, TextureImage& out);
+
+// Copies the levels out of an .arenatex already in memory. path is only
+// used in error messages.
+bool textureLoadBakedFromMemory(const uint8_t* data, size_t size, const char* path, TextureImage& out);
+
+// Reads just the header; false if the file is missing or not an .arenatex
+// of the current version.
+bool textureReadBakedHeader(const char* path, ArenaTexHeader& header);
+
+// Same contract as bakedContentHash, for .arenatex files.
+uint64_t textureBakedContentHash(const uint8_t* data, size_t size);
@@ -29,6 +29,14 @@ struct Camera {
         aspect = aspectRatio;
     }
 
+    // Height in pixels of something worldSize across at point, seen in a
+    // view viewportHeight pixels tall.
+    float projectedSize(const Vector3& point, float worldSize, float viewportHeight) const
+    {
+        float distance = fmaxf(vec3Length(vec3Subtract(point, position)), nearClip);
+        return worldSize * viewportHeight / (2.0F * distance * gmathTan(fov * 0.5F));
+    }
+
     void updateMVP()
     {
         Matrix4 view = mat4LookAt(position, target, up);
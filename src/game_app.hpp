@@ -1,6 +1,7 @@
 #pragma once
 
 #include "glad.h"
+#include "texture.hpp"
 #include <SDL.h>
 #include <cassert>
 #include <cstdio>
@@ -48,6 +49,8 @@ void runGameApp(GameApp app, GameAppConfig appConfig)
     int version = gladLoadGL((GLADloadfunc)SDL_GL_GetProcAddress);
     assert(version != 0);
     printf("OpenGL: %d.%d\n", GLAD_VERSION_MAJOR(version), GLAD_VERSION_MINOR(version));
+    // Before onInit, which may start texture loads.
+    textureQueryGLSupport();
 
     app.onInit();
 
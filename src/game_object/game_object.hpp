@@ -11,23 +11,12 @@ private:
     Vector3 position = vec3Zero();
     Quaternion rotation = quatIdentity();
     Vector3 scale = vec3One();
-    Matrix4 localMatrix = mat4Identity();
-    Matrix4 worldMatrix = mat4Identity();
+    Matrix3x4 localMatrix = mat34Identity();
+    Matrix3x4 worldMatrix = mat34Identity();
 
     void updateLocalMatrix()
     {
-        Vector3 x = vec3Transform(vec3(1.0F, 0.0F, 0.0F), rotation);
-        Vector3 y = vec3Transform(vec3(0.0F, 1.0F, 0.0F), rotation);
-        Vector3 z = vec3Transform(vec3(0.0F, 0.0F, 1.0F), rotation);
-        x = vec3Multiply(x, scale.x);
-        y = vec3Multiply(y, scale.y);
-        z = vec3Multiply(z, scale.z);
-        Matrix4 newMatrix = {
-            x.x, x.y, x.z, 0.0F,
-            y.x, y.y, y.z, 0.0F,
-            z.x, z.y, z.z, 0.0F,
-            position.x, position.y, position.z, 1.0F};
-        localMatrix = newMatrix;
+        localMatrix = mat34CreateTransform(position, rotation, scale);
     }
 
 public:
@@ -64,17 +53,17 @@ public:
         updateLocalMatrix();
     }
 
-    const Matrix4& getLocalMatrix()
+    const Matrix3x4& getLocalMatrix()
     {
         return localMatrix;
     }
 
-    const Matrix4& getWorldMatrix()
+    const Matrix3x4& getWorldMatrix()
     {
         return worldMatrix;
     }
 
-    void setWorldMatrix(const Matrix4& m)
+    void setWorldMatrix(const Matrix3x4& m)
     {
         worldMatrix = m;
     }
@@ -142,7 +131,7 @@ struct SceneTree {
             nodeStack.pop();
             for (GameObject* child : parent->getObjects())
             {
-                Matrix4 m = mat4Multiply(parent->getWorldMatrix(), child->getLocalMatrix());
+                Matrix3x4 m = mat34Multiply(parent->getWorldMatrix(), child->getLocalMatrix());
                 child->setWorldMatrix(m);
                 nodeStack.push(child);
             }
@@ -1,6 +1,45 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// SIMD backend selection. The widest instruction set enabled for the
+// translation unit is used; define GMATH_NO_SIMD to force the scalar path
+// or GMATH_SSE4 on compilers that do not advertise __SSE4_1__ (MSVC).
+// Every SIMD routine performs the same multiplies and adds in the same order
+// as its scalar fallback, so results are bit-identical across backends as
+// long as the compiler does not contract them into FMAs (-ffp-contract=off).
+#if !defined(GMATH_NO_SIMD) && defined(__AVX2__)
+#define GMATH_AVX2 1
+#endif
+
+#if !defined(GMATH_NO_SIMD) && !defined(GMATH_SSE4) && (defined(GMATH_AVX2) || defined(__SSE4_1__))
+#define GMATH_SSE4 1
+#endif
+
+#if defined(GMATH_SSE4)
+#include <immintrin.h>
+#endif
+
+// Everything that does not need a pointer or a loop over caller memory is
+// constexpr. SIMD routines and the libm wrappers below switch to their scalar
+// branch during constant evaluation, which needs the compiler builtin.
+// GCC 9 has the builtin but not __has_builtin.
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define GMATH_HAS_CONSTEXPR_MATH 1
+#endif
+#elif (defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#define GMATH_HAS_CONSTEXPR_MATH 1
+#endif
+
+#if defined(GMATH_HAS_CONSTEXPR_MATH)
+#define GMATH_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#else
+#define GMATH_IS_CONSTANT_EVALUATED() false
+#endif
 
 struct Vector3 {
     float x, y, z;
@@ -17,86 +56,176 @@ struct Matrix4 {
         m41, m42, m43, m44;
 };
 
+// Affine transform in the same row-vector convention as Matrix4, with the
+// fourth column implied to be (0, 0, 0, 1). The three remaining columns are
+// stored one after another so that each one fills a 4-wide register.
+struct Matrix3x4 {
+    float m11, m21, m31, m41,
+        m12, m22, m32, m42,
+        m13, m23, m33, m43;
+};
+
 struct Quaternion {
     float x, y, z, w;
 };
 
-inline float deg2Rad(float degree)
+// Rigid transform p -> vec3Transform(p, real) + t, with dual = real * t / 2
+// (t taken as a pure quaternion). Scale cannot be represented.
+struct DualQuaternion {
+    Quaternion real;
+    Quaternion dual;
+};
+
+constexpr float gmathAbs(float x)
+{
+    return x < 0.0F ? -x : x;
+}
+
+// The wrappers call libm at run time. Constant-evaluated results come from a
+// series evaluated in double and may differ from libm in the last bit.
+constexpr float gmathSqrt(float x)
+{
+    if (GMATH_IS_CONSTANT_EVALUATED())
+    {
+        // NaN, zeros and infinity come back unchanged and negatives give NaN,
+        // as from sqrtf, so a bad input still shows in a constant table.
+        if (x != x || x == 0.0F || x > 3.402823466e+38F)
+        {
+            return x;
+        }
+        if (x < 0.0F)
+        {
+            return std::numeric_limits<float>::quiet_NaN();
+        }
+        // Seeding from the exponent puts r within a factor of 2 of the root,
+        // so a few Newton steps reach double precision for any finite x.
+        double v = double(x);
+        double r = 1.0;
+        while (r * r * 4.0 <= v)
+        {
+            r *= 2.0;
+        }
+        while (r * r > v)
+        {
+            r *= 0.5;
+        }
+        for (int i = 0; i < 6; ++i)
+        {
+            r = 0.5 * (r + v / r);
+        }
+        return float(r);
+    }
+    return sqrtf(x);
+}
+
+constexpr double gmathWrapPi(double x)
+{
+    const double twoPi = 6.283185307179586476925;
+    double k = double((long long)(x / twoPi + (x < 0.0 ? -0.5 : 0.5)));
+    return x - k * twoPi;
+}
+
+constexpr float gmathSin(float x)
+{
+    if (GMATH_IS_CONSTANT_EVALUATED())
+    {
+        double r = gmathWrapPi(x);
+        double term = r;
+        double sum = r;
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -r * r / double((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return float(sum);
+    }
+    return sinf(x);
+}
+
+constexpr float gmathCos(float x)
+{
+    if (GMATH_IS_CONSTANT_EVALUATED())
+    {
+        double r = gmathWrapPi(x);
+        double term = 1.0;
+        double sum = 1.0;
+        for (int n = 1; n < 12; ++n)
+        {
+            term *= -r * r / double((2 * n - 1) * (2 * n));
+            sum += term;
+        }
+        return float(sum);
+    }
+    return cosf(x);
+}
+
+constexpr float gmathTan(float x)
+{
+    if (GMATH_IS_CONSTANT_EVALUATED())
+    {
+        return gmathSin(x) / gmathCos(x);
+    }
+    return tanf(x);
+}
+
+constexpr float deg2Rad(float degree)
 {
     float radian = degree * (3.14159265358979323846F / 180.0F);
     return radian;
 }
 
-inline Vector3 vec3Zero()
+constexpr Vector3 vec3Zero()
 {
     return {0.0F, 0.0F, 0.0F};
 }
 
-inline Vector3 vec3One()
+constexpr Vector3 vec3One()
 {
     return {1.0F, 1.0F, 1.0F};
 }
 
-inline Vector3 vec3(float x, float y, float z)
+constexpr Vector3 vec3(float x, float y, float z)
 {
     return {x, y, z};
 }
 
-inline Vector3 vec3Add(const Vector3& a, const Vector3& b)
+constexpr Vector3 vec3Add(const Vector3& a, const Vector3& b)
 {
     return {a.x + b.x, a.y + b.y, a.z + b.z};
 }
 
-inline Vector3 vec3Subtract(const Vector3& a, const Vector3& b)
+constexpr Vector3 vec3Subtract(const Vector3& a, const Vector3& b)
 {
     return {a.x - b.x, a.y - b.y, a.z - b.z};
 }
 
-inline Vector3 vec3Multiply(const Vector3& v, float scalar)
+constexpr Vector3 vec3Multiply(const Vector3& v, float scalar)
 {
     return {v.x * scalar, v.y * scalar, v.z * scalar};
 }
 
-inline float vec3Dot(const Vector3& a, const Vector3& b)
+constexpr float vec3Dot(const Vector3& a, const Vector3& b)
 {
-    const float* A = (const float*)&a;
-    const float* B = (const float*)&b;
-
-    float dot = 0.0F;
-    for (int i = 0; i < 3; ++i)
-    {
-        dot += A[i] * B[i];
-    }
-
-    return dot;
+    return a.x * b.x + a.y * b.y + a.z * b.z;
 }
 
-inline float vec3LengthSquared(const Vector3& v)
+constexpr float vec3LengthSquared(const Vector3& v)
 {
     return vec3Dot(v, v);
 }
 
-inline float vec3Length(const Vector3& v)
+constexpr float vec3Length(const Vector3& v)
 {
-    return sqrtf(vec3LengthSquared(v));
+    return gmathSqrt(vec3LengthSquared(v));
 }
 
-inline Vector3 vec3Normalize(const Vector3& v)
+constexpr Vector3 vec3Normalize(const Vector3& v)
 {
-    const float* V = (const float*)&v;
-
-    Vector3 n = vec3Zero();
-    float* N = (float*)&n;
     float len = 1.0F / vec3Length(v);
-    for (int i = 0; i < 3; ++i)
-    {
-        N[i] = V[i] * len;
-    }
-
-    return n;
+    return {v.x * len, v.y * len, v.z * len};
 }
 
-inline Vector3 vec3Cross(const Vector3& a, const Vector3& b)
+constexpr Vector3 vec3Cross(const Vector3& a, const Vector3& b)
 {
     return {
         a.y * b.z - a.z * b.y,
@@ -104,46 +233,56 @@ inline Vector3 vec3Cross(const Vector3& a, const Vector3& b)
         a.x * b.y - a.y * b.x};
 }
 
-inline Vector3 vec3Negate(const Vector3& v)
+constexpr Vector3 vec3Negate(const Vector3& v)
 {
     return {-v.x, -v.y, -v.z};
 }
 
-inline Vector3 vec3Transform(const Vector3& v, const Quaternion& q)
+constexpr Vector3 vec3Lerp(const Vector3& a, const Vector3& b, float t)
+{
+    return vec3Add(a, vec3Multiply(vec3Subtract(b, a), t));
+}
+
+constexpr Vector3 vec3Transform(const Vector3& v, const Quaternion& q)
 {
     Vector3 qv = vec3(q.x, q.y, q.z);
     return vec3Add(vec3Multiply(vec3Cross(v, qv), 2.0F * q.w), vec3Add(vec3Multiply(v, q.w * q.w - vec3Dot(qv, qv)), vec3Multiply(qv, 2.0F * vec3Dot(qv, v))));
 }
 
-inline Vector4 vec4Zero()
+constexpr Vector4 vec4Zero()
 {
     return {0.0F, 0.0F, 0.0F, 0.0F};
 }
 
-inline Vector4 vec4One()
+constexpr Vector4 vec4One()
 {
     return {1.0F, 1.0F, 1.0F, 1.0F};
 }
 
-inline Vector4 vec4Transform(const Vector4& v, const Matrix4& m)
+constexpr Vector4 vec4Transform(const Vector4& v, const Matrix4& m)
 {
-    Vector4 result = vec4Zero();
-    const float* A = (const float*)&v;
-    const float* B = (const float*)&m;
-    float* out = (float*)&result;
-
-    for (int j = 0; j < 4; ++j)
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
     {
-        for (int k = 0; k < 4; ++k)
-        {
-            out[j] += A[k] * B[4 * k + j];
-        }
+        Vector4 result = vec4Zero();
+        const float* B = &m.m11;
+        __m128 r = _mm_mul_ps(_mm_set1_ps(v.x), _mm_loadu_ps(B + 0));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.y), _mm_loadu_ps(B + 4)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.z), _mm_loadu_ps(B + 8)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v.w), _mm_loadu_ps(B + 12)));
+        _mm_storeu_ps(&result.x, r);
+        return result;
     }
+#endif
 
-    return result;
+    return {
+        v.x * m.m11 + v.y * m.m21 + v.z * m.m31 + v.w * m.m41,
+        v.x * m.m12 + v.y * m.m22 + v.z * m.m32 + v.w * m.m42,
+        v.x * m.m13 + v.y * m.m23 + v.z * m.m33 + v.w * m.m43,
+        v.x * m.m14 + v.y * m.m24 + v.z * m.m34 + v.w * m.m44};
 }
 
-inline Matrix4 mat4Zero()
+constexpr Matrix4 mat4Zero()
 {
     return {
         0.0F, 0.0F, 0.0F, 0.0F,
@@ -152,7 +291,7 @@ inline Matrix4 mat4Zero()
         0.0F, 0.0F, 0.0F, 0.0F};
 }
 
-inline Matrix4 mat4Identity()
+constexpr Matrix4 mat4Identity()
 {
     return {
         1.0F, 0.0F, 0.0F, 0.0F,
@@ -166,26 +305,169 @@ inline const float* mat4Ptr(const Matrix4& m)
     return (const float*)&m;
 }
 
-inline Matrix4 mat4Multiply(const Matrix4& a, const Matrix4& b)
+constexpr Matrix4 mat4Multiply(const Matrix4& a, const Matrix4& b)
 {
-    Matrix4 m = mat4Zero();
-    const float* A = (const float*)&a;
-    const float* B = (const float*)&b;
-    float* M = (float*)&m;
-    for (int i = 0; i < 4; ++i)
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
     {
-        for (int j = 0; j < 4; ++j)
+        Matrix4 m = mat4Zero();
+        const float* A = &a.m11;
+        const float* B = &b.m11;
+        float* M = &m.m11;
+#if defined(GMATH_AVX2)
+        // Two rows of the result per iteration: each 128-bit lane broadcasts
+        // the coefficients of its own row of A.
+        __m256 b0 = _mm256_broadcast_ps((const __m128*)(B + 0));
+        __m256 b1 = _mm256_broadcast_ps((const __m128*)(B + 4));
+        __m256 b2 = _mm256_broadcast_ps((const __m128*)(B + 8));
+        __m256 b3 = _mm256_broadcast_ps((const __m128*)(B + 12));
+        for (int i = 0; i < 4; i += 2)
+        {
+            __m256 rows = _mm256_loadu_ps(A + 4 * i);
+            __m256 r = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x00), b0);
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0x55), b1));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xAA), b2));
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, 0xFF), b3));
+            _mm256_storeu_ps(M + 4 * i, r);
+        }
+#else
+        __m128 b0 = _mm_loadu_ps(B + 0);
+        __m128 b1 = _mm_loadu_ps(B + 4);
+        __m128 b2 = _mm_loadu_ps(B + 8);
+        __m128 b3 = _mm_loadu_ps(B + 12);
+        for (int i = 0; i < 4; ++i)
         {
-            for (int k = 0; k < 4; ++k)
-            {
-                M[4 * i + j] += A[4 * i + k] * B[4 * k + j];
-            }
+            __m128 r = _mm_mul_ps(_mm_set1_ps(A[4 * i + 0]), b0);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(A[4 * i + 1]), b1));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(A[4 * i + 2]), b2));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(A[4 * i + 3]), b3));
+            _mm_storeu_ps(M + 4 * i, r);
         }
+#endif
+        return m;
     }
-    return m;
+#endif
+
+    return {
+        a.m11 * b.m11 + a.m12 * b.m21 + a.m13 * b.m31 + a.m14 * b.m41,
+        a.m11 * b.m12 + a.m12 * b.m22 + a.m13 * b.m32 + a.m14 * b.m42,
+        a.m11 * b.m13 + a.m12 * b.m23 + a.m13 * b.m33 + a.m14 * b.m43,
+        a.m11 * b.m14 + a.m12 * b.m24 + a.m13 * b.m34 + a.m14 * b.m44,
+        a.m21 * b.m11 + a.m22 * b.m21 + a.m23 * b.m31 + a.m24 * b.m41,
+        a.m21 * b.m12 + a.m22 * b.m22 + a.m23 * b.m32 + a.m24 * b.m42,
+        a.m21 * b.m13 + a.m22 * b.m23 + a.m23 * b.m33 + a.m24 * b.m43,
+        a.m21 * b.m14 + a.m22 * b.m24 + a.m23 * b.m34 + a.m24 * b.m44,
+        a.m31 * b.m11 + a.m32 * b.m21 + a.m33 * b.m31 + a.m34 * b.m41,
+        a.m31 * b.m12 + a.m32 * b.m22 + a.m33 * b.m32 + a.m34 * b.m42,
+        a.m31 * b.m13 + a.m32 * b.m23 + a.m33 * b.m33 + a.m34 * b.m43,
+        a.m31 * b.m14 + a.m32 * b.m24 + a.m33 * b.m34 + a.m34 * b.m44,
+        a.m41 * b.m11 + a.m42 * b.m21 + a.m43 * b.m31 + a.m44 * b.m41,
+        a.m41 * b.m12 + a.m42 * b.m22 + a.m43 * b.m32 + a.m44 * b.m42,
+        a.m41 * b.m13 + a.m42 * b.m23 + a.m43 * b.m33 + a.m44 * b.m43,
+        a.m41 * b.m14 + a.m42 * b.m24 + a.m43 * b.m34 + a.m44 * b.m44};
 }
 
-inline Matrix4 mat4CreateTranslation(Vector3 v)
+#if defined(GMATH_SSE4)
+// Splits 4 packed xyz points (x0y0z0x1 y1z1x2y2 z2x3y3z3) into x, y and z
+// registers. Applied per 128-bit lane it works for AVX as well, where the
+// upper lane holds points 4..7.
+#define GMATH_AOS_TO_SOA_XYZ(shuffle, m03, m14, m25, x, y, z)          \
+    do                                                                   \
+    {                                                                    \
+        auto xy_ = shuffle(m14, m25, _MM_SHUFFLE(2, 1, 3, 2));           \
+        auto yz_ = shuffle(m03, m14, _MM_SHUFFLE(1, 0, 2, 1));           \
+        x = shuffle(m03, xy_, _MM_SHUFFLE(2, 0, 3, 0));                  \
+        y = shuffle(yz_, xy_, _MM_SHUFFLE(3, 1, 2, 0));                  \
+        z = shuffle(yz_, m25, _MM_SHUFFLE(3, 0, 3, 1));                  \
+    } while (0)
+
+#define GMATH_SOA_TO_AOS_XYZ(shuffle, x, y, z, m03, m14, m25)          \
+    do                                                                   \
+    {                                                                    \
+        auto xy_ = shuffle(x, y, _MM_SHUFFLE(2, 0, 2, 0));               \
+        auto yz_ = shuffle(y, z, _MM_SHUFFLE(3, 1, 3, 1));               \
+        auto zx_ = shuffle(z, x, _MM_SHUFFLE(3, 1, 2, 0));               \
+        m03 = shuffle(xy_, zx_, _MM_SHUFFLE(2, 0, 2, 0));                \
+        m14 = shuffle(yz_, xy_, _MM_SHUFFLE(3, 1, 2, 0));                \
+        m25 = shuffle(zx_, yz_, _MM_SHUFFLE(3, 1, 3, 1));                \
+    } while (0)
+#endif
+
+// Transforms count packed xyz points (w = 1) by m. src and dst may alias.
+inline void mat4TransformPoints(const float* src, float* dst, size_t count, const Matrix4& m)
+{
+    size_t i = 0;
+
+#if defined(GMATH_AVX2)
+    const __m256 m11 = _mm256_set1_ps(m.m11), m12 = _mm256_set1_ps(m.m12), m13 = _mm256_set1_ps(m.m13);
+    const __m256 m21 = _mm256_set1_ps(m.m21), m22 = _mm256_set1_ps(m.m22), m23 = _mm256_set1_ps(m.m23);
+    const __m256 m31 = _mm256_set1_ps(m.m31), m32 = _mm256_set1_ps(m.m32), m33 = _mm256_set1_ps(m.m33);
+    const __m256 m41 = _mm256_set1_ps(m.m41), m42 = _mm256_set1_ps(m.m42), m43 = _mm256_set1_ps(m.m43);
+    for (; i + 8 <= count; i += 8)
+    {
+        const float* p = src + 3 * i;
+        __m256 m03 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 0)), _mm_loadu_ps(p + 12), 1);
+        __m256 m14 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+        __m256 m25 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+        __m256 x, y, z;
+        GMATH_AOS_TO_SOA_XYZ(_mm256_shuffle_ps, m03, m14, m25, x, y, z);
+
+        __m256 ox = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m11), _mm256_mul_ps(y, m21)), _mm256_mul_ps(z, m31)), m41);
+        __m256 oy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m12), _mm256_mul_ps(y, m22)), _mm256_mul_ps(z, m32)), m42);
+        __m256 oz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, m13), _mm256_mul_ps(y, m23)), _mm256_mul_ps(z, m33)), m43);
+
+        GMATH_SOA_TO_AOS_XYZ(_mm256_shuffle_ps, ox, oy, oz, m03, m14, m25);
+        float* q = dst + 3 * i;
+        _mm_storeu_ps(q + 0, _mm256_castps256_ps128(m03));
+        _mm_storeu_ps(q + 4, _mm256_castps256_ps128(m14));
+        _mm_storeu_ps(q + 8, _mm256_castps256_ps128(m25));
+        _mm_storeu_ps(q + 12, _mm256_extractf128_ps(m03, 1));
+        _mm_storeu_ps(q + 16, _mm256_extractf128_ps(m14, 1));
+        _mm_storeu_ps(q + 20, _mm256_extractf128_ps(m25, 1));
+    }
+#endif
+
+#if defined(GMATH_SSE4)
+    const __m128 n11 = _mm_set1_ps(m.m11), n12 = _mm_set1_ps(m.m12), n13 = _mm_set1_ps(m.m13);
+    const __m128 n21 = _mm_set1_ps(m.m21), n22 = _mm_set1_ps(m.m22), n23 = _mm_set1_ps(m.m23);
+    const __m128 n31 = _mm_set1_ps(m.m31), n32 = _mm_set1_ps(m.m32), n33 = _mm_set1_ps(m.m33);
+    const __m128 n41 = _mm_set1_ps(m.m41), n42 = _mm_set1_ps(m.m42), n43 = _mm_set1_ps(m.m43);
+    for (; i + 4 <= count; i += 4)
+    {
+        const float* p = src + 3 * i;
+        __m128 m03 = _mm_loadu_ps(p + 0);
+        __m128 m14 = _mm_loadu_ps(p + 4);
+        __m128 m25 = _mm_loadu_ps(p + 8);
+        __m128 x, y, z;
+        GMATH_AOS_TO_SOA_XYZ(_mm_shuffle_ps, m03, m14, m25, x, y, z);
+
+        __m128 ox = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, n11), _mm_mul_ps(y, n21)), _mm_mul_ps(z, n31)), n41);
+        __m128 oy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, n12), _mm_mul_ps(y, n22)), _mm_mul_ps(z, n32)), n42);
+        __m128 oz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, n13), _mm_mul_ps(y, n23)), _mm_mul_ps(z, n33)), n43);
+
+        GMATH_SOA_TO_AOS_XYZ(_mm_shuffle_ps, ox, oy, oz, m03, m14, m25);
+        float* q = dst + 3 * i;
+        _mm_storeu_ps(q + 0, m03);
+        _mm_storeu_ps(q + 4, m14);
+        _mm_storeu_ps(q + 8, m25);
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        float x = src[3 * i + 0];
+        float y = src[3 * i + 1];
+        float z = src[3 * i + 2];
+        dst[3 * i + 0] = x * m.m11 + y * m.m21 + z * m.m31 + m.m41;
+        dst[3 * i + 1] = x * m.m12 + y * m.m22 + z * m.m32 + m.m42;
+        dst[3 * i + 2] = x * m.m13 + y * m.m23 + z * m.m33 + m.m43;
+    }
+}
+
+#undef GMATH_AOS_TO_SOA_XYZ
+#undef GMATH_SOA_TO_AOS_XYZ
+
+constexpr Matrix4 mat4CreateTranslation(Vector3 v)
 {
     return {
         1.0F, 0.0F, 0.0F, 0.0F,
@@ -194,7 +476,7 @@ inline Matrix4 mat4CreateTranslation(Vector3 v)
         v.x, v.y, v.z, 1.0F};
 }
 
-inline Matrix4 mat4CreateScale(Vector3 v)
+constexpr Matrix4 mat4CreateScale(Vector3 v)
 {
     Matrix4 m = mat4Zero();
     m.m11 = v.x;
@@ -204,13 +486,13 @@ inline Matrix4 mat4CreateScale(Vector3 v)
     return m;
 }
 
-inline Matrix4 mat4CreateFromAxisAngle(Vector3 axisUnit, float angleRadian)
+constexpr Matrix4 mat4CreateFromAxisAngle(Vector3 axisUnit, float angleRadian)
 {
     float x = axisUnit.x;
     float y = axisUnit.y;
     float z = axisUnit.z;
-    float c = cosf(angleRadian);
-    float s = sinf(angleRadian);
+    float c = gmathCos(angleRadian);
+    float s = gmathSin(angleRadian);
     float t = 1.0F - c;
 
     Matrix4 m = {
@@ -221,7 +503,7 @@ inline Matrix4 mat4CreateFromAxisAngle(Vector3 axisUnit, float angleRadian)
     return m;
 }
 
-inline Matrix4 mat4CreateFromQuaternion(const Quaternion& q)
+constexpr Matrix4 mat4CreateFromQuaternion(const Quaternion& q)
 {
     Vector3 r = vec3Transform(vec3(1.0F, 0.0F, 0.0F), q);
     Vector3 u = vec3Transform(vec3(0.0F, 1.0F, 0.0F), q);
@@ -235,7 +517,7 @@ inline Matrix4 mat4CreateFromQuaternion(const Quaternion& q)
     return m;
 }
 
-inline Matrix4 mat4CreateOrthographicOffCenter(float left, float right, float bottom, float top, float zNearPlane, float zFarPlane)
+constexpr Matrix4 mat4CreateOrthographicOffCenter(float left, float right, float bottom, float top, float zNearPlane, float zFarPlane)
 {
     float tX = -((right + left) / (right - left));
     float tY = -((top + bottom) / (top - bottom));
@@ -250,9 +532,9 @@ inline Matrix4 mat4CreateOrthographicOffCenter(float left, float right, float bo
     return m;
 }
 
-inline Matrix4 mat4CreatePerspectiveFieldOfView(float fovYRadian, float aspect, float nearPlaneDistance, float farPlaneDistance)
+constexpr Matrix4 mat4CreatePerspectiveFieldOfView(float fovYRadian, float aspect, float nearPlaneDistance, float farPlaneDistance)
 {
-    float f = 1.0F / tanf(fovYRadian / 2.0F);
+    float f = 1.0F / gmathTan(fovYRadian / 2.0F);
 
     Matrix4 m = {
         f / aspect, 0.0F, 0.0F, 0.0F,
@@ -263,7 +545,7 @@ inline Matrix4 mat4CreatePerspectiveFieldOfView(float fovYRadian, float aspect,
     return m;
 }
 
-inline Matrix4 mat4LookAt(const Vector3& eye, const Vector3& center, const Vector3& up)
+constexpr Matrix4 mat4LookAt(const Vector3& eye, const Vector3& center, const Vector3& up)
 {
     Vector3 cameraDirection = vec3Normalize(vec3Subtract(eye, center));
     Vector3 cameraRight = vec3Normalize(vec3Cross(up, cameraDirection));
@@ -284,29 +566,506 @@ inline Matrix4 mat4LookAt(const Vector3& eye, const Vector3& center, const Vecto
     return mat4Multiply(translation, rotation);
 }
 
-inline Quaternion quatIdentity()
+constexpr Matrix3x4 mat34Identity()
+{
+    return {
+        1.0F, 0.0F, 0.0F, 0.0F,
+        0.0F, 1.0F, 0.0F, 0.0F,
+        0.0F, 0.0F, 1.0F, 0.0F};
+}
+
+constexpr Matrix3x4 mat4ToMat34(const Matrix4& m)
+{
+    return {
+        m.m11, m.m21, m.m31, m.m41,
+        m.m12, m.m22, m.m32, m.m42,
+        m.m13, m.m23, m.m33, m.m43};
+}
+
+constexpr Matrix4 mat34ToMat4(const Matrix3x4& m)
+{
+    return {
+        m.m11, m.m12, m.m13, 0.0F,
+        m.m21, m.m22, m.m23, 0.0F,
+        m.m31, m.m32, m.m33, 0.0F,
+        m.m41, m.m42, m.m43, 1.0F};
+}
+
+constexpr Matrix3x4 mat34CreateTransform(const Vector3& position, const Quaternion& rotation, const Vector3& scale)
+{
+    Vector3 x = vec3Multiply(vec3Transform(vec3(1.0F, 0.0F, 0.0F), rotation), scale.x);
+    Vector3 y = vec3Multiply(vec3Transform(vec3(0.0F, 1.0F, 0.0F), rotation), scale.y);
+    Vector3 z = vec3Multiply(vec3Transform(vec3(0.0F, 0.0F, 1.0F), rotation), scale.z);
+    return {
+        x.x, y.x, z.x, position.x,
+        x.y, y.y, z.y, position.y,
+        x.z, y.z, z.z, position.z};
+}
+
+// Same semantics as mat4Multiply: the result applies a first, then b.
+constexpr Matrix3x4 mat34Multiply(const Matrix3x4& a, const Matrix3x4& b)
+{
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        Matrix3x4 m = mat34Identity();
+        const float* A = &a.m11;
+        const float* B = &b.m11;
+        float* M = &m.m11;
+        const __m128 maskW = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+        __m128 a0 = _mm_loadu_ps(A + 0);
+        __m128 a1 = _mm_loadu_ps(A + 4);
+        __m128 a2 = _mm_loadu_ps(A + 8);
+        for (int j = 0; j < 3; ++j)
+        {
+            __m128 col = _mm_loadu_ps(B + 4 * j);
+            __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(col, col, 0x00));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(col, col, 0x55)));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(col, col, 0xAA)));
+            r = _mm_add_ps(r, _mm_and_ps(col, maskW));
+            _mm_storeu_ps(M + 4 * j, r);
+        }
+        return m;
+    }
+#endif
+
+    // The + 0.0F terms mirror the masked add of the SIMD path.
+    return {
+        a.m11 * b.m11 + a.m12 * b.m21 + a.m13 * b.m31 + 0.0F,
+        a.m21 * b.m11 + a.m22 * b.m21 + a.m23 * b.m31 + 0.0F,
+        a.m31 * b.m11 + a.m32 * b.m21 + a.m33 * b.m31 + 0.0F,
+        a.m41 * b.m11 + a.m42 * b.m21 + a.m43 * b.m31 + b.m41,
+        a.m11 * b.m12 + a.m12 * b.m22 + a.m13 * b.m32 + 0.0F,
+        a.m21 * b.m12 + a.m22 * b.m22 + a.m23 * b.m32 + 0.0F,
+        a.m31 * b.m12 + a.m32 * b.m22 + a.m33 * b.m32 + 0.0F,
+        a.m41 * b.m12 + a.m42 * b.m22 + a.m43 * b.m32 + b.m42,
+        a.m11 * b.m13 + a.m12 * b.m23 + a.m13 * b.m33 + 0.0F,
+        a.m21 * b.m13 + a.m22 * b.m23 + a.m23 * b.m33 + 0.0F,
+        a.m31 * b.m13 + a.m32 * b.m23 + a.m33 * b.m33 + 0.0F,
+        a.m41 * b.m13 + a.m42 * b.m23 + a.m43 * b.m33 + b.m43};
+}
+
+#if defined(GMATH_SSE4)
+// a x b in lanes x, y, z; lane w is left over.
+inline __m128 gmathCross3SSE(__m128 a, __m128 b)
+{
+    __m128 a1 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 b1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+    __m128 a2 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+    __m128 b2 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+    return _mm_sub_ps(_mm_mul_ps(a1, b2), _mm_mul_ps(a2, b1));
+}
+#endif
+
+constexpr Matrix3x4 mat34Inverse(const Matrix3x4& m)
+{
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        // The rows of the inverse are the cross products of pairs of
+        // columns over the determinant; one transpose puts them back into
+        // columns next to the translation.
+        const __m128 sign = _mm_set1_ps(-0.0F);
+        __m128 a = _mm_loadu_ps(&m.m11);
+        __m128 b = _mm_loadu_ps(&m.m12);
+        __m128 c = _mm_loadu_ps(&m.m13);
+        __m128 x = gmathCross3SSE(b, c);
+        __m128 y = gmathCross3SSE(c, a);
+        __m128 z = gmathCross3SSE(a, b);
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(b, y)), _mm_mul_ps(c, z));
+        __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0F), _mm_shuffle_ps(det, det, _MM_SHUFFLE(0, 0, 0, 0)));
+        x = _mm_mul_ps(x, invDet);
+        y = _mm_mul_ps(y, invDet);
+        z = _mm_mul_ps(z, invDet);
+        __m128 t = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), x);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)), y));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3)), z));
+        t = _mm_xor_ps(t, sign);
+        _MM_TRANSPOSE4_PS(x, y, z, t);
+        Matrix3x4 r = mat34Identity();
+        _mm_storeu_ps(&r.m11, x);
+        _mm_storeu_ps(&r.m12, y);
+        _mm_storeu_ps(&r.m13, z);
+        return r;
+    }
+#endif
+
+    // Inverse of the linear part by cofactors, then the translation is
+    // carried through it.
+    float c11 = m.m22 * m.m33 - m.m23 * m.m32;
+    float c12 = m.m13 * m.m32 - m.m12 * m.m33;
+    float c13 = m.m12 * m.m23 - m.m13 * m.m22;
+    float c21 = m.m23 * m.m31 - m.m21 * m.m33;
+    float c22 = m.m11 * m.m33 - m.m13 * m.m31;
+    float c23 = m.m13 * m.m21 - m.m11 * m.m23;
+    float c31 = m.m21 * m.m32 - m.m22 * m.m31;
+    float c32 = m.m12 * m.m31 - m.m11 * m.m32;
+    float c33 = m.m11 * m.m22 - m.m12 * m.m21;
+    float invDet = 1.0F / (m.m11 * c11 + m.m12 * c21 + m.m13 * c31);
+
+    Matrix3x4 r = mat34Identity();
+    r.m11 = c11 * invDet;
+    r.m12 = c12 * invDet;
+    r.m13 = c13 * invDet;
+    r.m21 = c21 * invDet;
+    r.m22 = c22 * invDet;
+    r.m23 = c23 * invDet;
+    r.m31 = c31 * invDet;
+    r.m32 = c32 * invDet;
+    r.m33 = c33 * invDet;
+    r.m41 = -(m.m41 * r.m11 + m.m42 * r.m21 + m.m43 * r.m31);
+    r.m42 = -(m.m41 * r.m12 + m.m42 * r.m22 + m.m43 * r.m32);
+    r.m43 = -(m.m41 * r.m13 + m.m42 * r.m23 + m.m43 * r.m33);
+    return r;
+}
+
+constexpr Vector3 mat34TransformPoint(const Vector3& v, const Matrix3x4& m)
+{
+    return {
+        v.x * m.m11 + v.y * m.m21 + v.z * m.m31 + m.m41,
+        v.x * m.m12 + v.y * m.m22 + v.z * m.m32 + m.m42,
+        v.x * m.m13 + v.y * m.m23 + v.z * m.m33 + m.m43};
+}
+
+constexpr Vector3 mat34TransformVector(const Vector3& v, const Matrix3x4& m)
+{
+    return {
+        v.x * m.m11 + v.y * m.m21 + v.z * m.m31,
+        v.x * m.m12 + v.y * m.m22 + v.z * m.m32,
+        v.x * m.m13 + v.y * m.m23 + v.z * m.m33};
+}
+
+constexpr Matrix4 mat4Transpose(const Matrix4& m)
+{
+    return {
+        m.m11, m.m21, m.m31, m.m41,
+        m.m12, m.m22, m.m32, m.m42,
+        m.m13, m.m23, m.m33, m.m43,
+        m.m14, m.m24, m.m34, m.m44};
+}
+
+// 4-float helpers for the scalar mirror of the SIMD inverse below; each one
+// matches a single SSE instruction so both paths round identically.
+struct GmathFloat4 {
+    float v[4];
+};
+
+constexpr GmathFloat4 gmathF4Add(const GmathFloat4& a, const GmathFloat4& b)
+{
+    return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+}
+
+constexpr GmathFloat4 gmathF4Sub(const GmathFloat4& a, const GmathFloat4& b)
+{
+    return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}};
+}
+
+constexpr GmathFloat4 gmathF4Mul(const GmathFloat4& a, const GmathFloat4& b)
+{
+    return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+}
+
+// Lanes x, y from a and z, w from b, like _mm_shuffle_ps.
+constexpr GmathFloat4 gmathF4Shuffle(const GmathFloat4& a, const GmathFloat4& b, int x, int y, int z, int w)
+{
+    return {{a.v[x], a.v[y], b.v[z], b.v[w]}};
+}
+
+// 2x2 blocks stored row-major in 4 lanes: A * B, adj(A) * B and A * adj(B).
+constexpr GmathFloat4 gmathMat2Mul(const GmathFloat4& a, const GmathFloat4& b)
+{
+    return gmathF4Add(gmathF4Mul(a, gmathF4Shuffle(b, b, 0, 3, 0, 3)), gmathF4Mul(gmathF4Shuffle(a, a, 1, 0, 3, 2), gmathF4Shuffle(b, b, 2, 1, 2, 1)));
+}
+
+constexpr GmathFloat4 gmathMat2AdjMul(const GmathFloat4& a, const GmathFloat4& b)
+{
+    return gmathF4Sub(gmathF4Mul(gmathF4Shuffle(a, a, 3, 3, 0, 0), b), gmathF4Mul(gmathF4Shuffle(a, a, 1, 1, 2, 2), gmathF4Shuffle(b, b, 2, 3, 0, 1)));
+}
+
+constexpr GmathFloat4 gmathMat2MulAdj(const GmathFloat4& a, const GmathFloat4& b)
+{
+    return gmathF4Sub(gmathF4Mul(a, gmathF4Shuffle(b, b, 3, 0, 3, 0)), gmathF4Mul(gmathF4Shuffle(a, a, 1, 0, 3, 2), gmathF4Shuffle(b, b, 2, 1, 2, 1)));
+}
+
+#if defined(GMATH_SSE4)
+#define GMATH_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define GMATH_SWIZZLE(a, x, y, z, w) GMATH_SHUFFLE(a, a, x, y, z, w)
+
+inline __m128 gmathMat2MulSSE(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, GMATH_SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(GMATH_SWIZZLE(a, 1, 0, 3, 2), GMATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+inline __m128 gmathMat2AdjMulSSE(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(GMATH_SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(GMATH_SWIZZLE(a, 1, 1, 2, 2), GMATH_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+inline __m128 gmathMat2MulAdjSSE(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, GMATH_SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(GMATH_SWIZZLE(a, 1, 0, 3, 2), GMATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+#endif
+
+// General inverse by 2x2 blocks: with M = | A B |, the inverse is built from
+// | C D |
+// the adjugates of the blocks and |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C).
+// The matrix must be invertible.
+constexpr Matrix4 mat4Inverse(const Matrix4& m)
+{
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        __m128 r0 = _mm_loadu_ps(&m.m11);
+        __m128 r1 = _mm_loadu_ps(&m.m21);
+        __m128 r2 = _mm_loadu_ps(&m.m31);
+        __m128 r3 = _mm_loadu_ps(&m.m41);
+        __m128 A = GMATH_SHUFFLE(r0, r1, 0, 1, 0, 1);
+        __m128 B = GMATH_SHUFFLE(r0, r1, 2, 3, 2, 3);
+        __m128 C = GMATH_SHUFFLE(r2, r3, 0, 1, 0, 1);
+        __m128 D = GMATH_SHUFFLE(r2, r3, 2, 3, 2, 3);
+
+        __m128 detSub = _mm_sub_ps(_mm_mul_ps(GMATH_SHUFFLE(r0, r2, 0, 2, 0, 2), GMATH_SHUFFLE(r1, r3, 1, 3, 1, 3)), _mm_mul_ps(GMATH_SHUFFLE(r0, r2, 1, 3, 1, 3), GMATH_SHUFFLE(r1, r3, 0, 2, 0, 2)));
+        __m128 detA = GMATH_SWIZZLE(detSub, 0, 0, 0, 0);
+        __m128 detB = GMATH_SWIZZLE(detSub, 1, 1, 1, 1);
+        __m128 detC = GMATH_SWIZZLE(detSub, 2, 2, 2, 2);
+        __m128 detD = GMATH_SWIZZLE(detSub, 3, 3, 3, 3);
+
+        __m128 DC = gmathMat2AdjMulSSE(D, C);
+        __m128 AB = gmathMat2AdjMulSSE(A, B);
+        __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), gmathMat2MulSSE(B, DC));
+        __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), gmathMat2MulSSE(C, AB));
+        __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), gmathMat2MulAdjSSE(D, AB));
+        __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), gmathMat2MulAdjSSE(A, DC));
+
+        __m128 tr = _mm_mul_ps(AB, GMATH_SWIZZLE(DC, 0, 2, 1, 3));
+        tr = _mm_hadd_ps(tr, tr);
+        tr = _mm_hadd_ps(tr, tr);
+        __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+        __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0F, -1.0F, -1.0F, 1.0F), detM);
+
+        X = _mm_mul_ps(X, rDetM);
+        Y = _mm_mul_ps(Y, rDetM);
+        Z = _mm_mul_ps(Z, rDetM);
+        W = _mm_mul_ps(W, rDetM);
+
+        Matrix4 r = mat4Zero();
+        _mm_storeu_ps(&r.m11, GMATH_SHUFFLE(X, Y, 3, 1, 3, 1));
+        _mm_storeu_ps(&r.m21, GMATH_SHUFFLE(X, Y, 2, 0, 2, 0));
+        _mm_storeu_ps(&r.m31, GMATH_SHUFFLE(Z, W, 3, 1, 3, 1));
+        _mm_storeu_ps(&r.m41, GMATH_SHUFFLE(Z, W, 2, 0, 2, 0));
+        return r;
+    }
+#endif
+
+    GmathFloat4 r0 = {{m.m11, m.m12, m.m13, m.m14}};
+    GmathFloat4 r1 = {{m.m21, m.m22, m.m23, m.m24}};
+    GmathFloat4 r2 = {{m.m31, m.m32, m.m33, m.m34}};
+    GmathFloat4 r3 = {{m.m41, m.m42, m.m43, m.m44}};
+    GmathFloat4 A = gmathF4Shuffle(r0, r1, 0, 1, 0, 1);
+    GmathFloat4 B = gmathF4Shuffle(r0, r1, 2, 3, 2, 3);
+    GmathFloat4 C = gmathF4Shuffle(r2, r3, 0, 1, 0, 1);
+    GmathFloat4 D = gmathF4Shuffle(r2, r3, 2, 3, 2, 3);
+
+    GmathFloat4 detSub = gmathF4Sub(gmathF4Mul(gmathF4Shuffle(r0, r2, 0, 2, 0, 2), gmathF4Shuffle(r1, r3, 1, 3, 1, 3)), gmathF4Mul(gmathF4Shuffle(r0, r2, 1, 3, 1, 3), gmathF4Shuffle(r1, r3, 0, 2, 0, 2)));
+    GmathFloat4 detA = {{detSub.v[0], detSub.v[0], detSub.v[0], detSub.v[0]}};
+    GmathFloat4 detB = {{detSub.v[1], detSub.v[1], detSub.v[1], detSub.v[1]}};
+    GmathFloat4 detC = {{detSub.v[2], detSub.v[2], detSub.v[2], detSub.v[2]}};
+    GmathFloat4 detD = {{detSub.v[3], detSub.v[3], detSub.v[3], detSub.v[3]}};
+
+    GmathFloat4 DC = gmathMat2AdjMul(D, C);
+    GmathFloat4 AB = gmathMat2AdjMul(A, B);
+    GmathFloat4 X = gmathF4Sub(gmathF4Mul(detD, A), gmathMat2Mul(B, DC));
+    GmathFloat4 W = gmathF4Sub(gmathF4Mul(detA, D), gmathMat2Mul(C, AB));
+    GmathFloat4 Y = gmathF4Sub(gmathF4Mul(detB, C), gmathMat2MulAdj(D, AB));
+    GmathFloat4 Z = gmathF4Sub(gmathF4Mul(detC, B), gmathMat2MulAdj(A, DC));
+
+    GmathFloat4 tr = gmathF4Mul(AB, gmathF4Shuffle(DC, DC, 0, 2, 1, 3));
+    float trace = (tr.v[0] + tr.v[1]) + (tr.v[2] + tr.v[3]);
+    float detM = (detA.v[0] * detD.v[0] + detB.v[0] * detC.v[0]) - trace;
+    GmathFloat4 rDetM = {{1.0F / detM, -1.0F / detM, -1.0F / detM, 1.0F / detM}};
+
+    X = gmathF4Mul(X, rDetM);
+    Y = gmathF4Mul(Y, rDetM);
+    Z = gmathF4Mul(Z, rDetM);
+    W = gmathF4Mul(W, rDetM);
+
+    GmathFloat4 o0 = gmathF4Shuffle(X, Y, 3, 1, 3, 1);
+    GmathFloat4 o1 = gmathF4Shuffle(X, Y, 2, 0, 2, 0);
+    GmathFloat4 o2 = gmathF4Shuffle(Z, W, 3, 1, 3, 1);
+    GmathFloat4 o3 = gmathF4Shuffle(Z, W, 2, 0, 2, 0);
+    return {
+        o0.v[0], o0.v[1], o0.v[2], o0.v[3],
+        o1.v[0], o1.v[1], o1.v[2], o1.v[3],
+        o2.v[0], o2.v[1], o2.v[2], o2.v[3],
+        o3.v[0], o3.v[1], o3.v[2], o3.v[3]};
+}
+
+#if defined(GMATH_SSE4)
+#undef GMATH_SHUFFLE
+#undef GMATH_SWIZZLE
+#endif
+
+#if defined(GMATH_SSE4)
+// The columns of the inverse of the upper 3x3 of m: cross products of pairs
+// of rows over the determinant, in the same order as mat34Inverse.
+inline void gmathAffineInverseColumnsSSE(const Matrix4& m, __m128& x, __m128& y, __m128& z)
+{
+    __m128 r1 = _mm_loadu_ps(&m.m11);
+    __m128 r2 = _mm_loadu_ps(&m.m21);
+    __m128 r3 = _mm_loadu_ps(&m.m31);
+    x = gmathCross3SSE(r2, r3);
+    y = gmathCross3SSE(r3, r1);
+    z = gmathCross3SSE(r1, r2);
+    __m128 det = _mm_mul_ps(r1, x);
+    det = _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(det, det, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 2, 2, 2)));
+    __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0F), det);
+    x = _mm_mul_ps(x, invDet);
+    y = _mm_mul_ps(y, invDet);
+    z = _mm_mul_ps(z, invDet);
+}
+
+// Rows x, y, z of an inverse upper 3x3 and the translation carried through
+// them into row four.
+inline Matrix4 gmathAffineInverseRowsSSE(const Matrix4& m, __m128 x, __m128 y, __m128 z)
+{
+    __m128 r4 = _mm_loadu_ps(&m.m41);
+    __m128 t = _mm_mul_ps(_mm_shuffle_ps(r4, r4, _MM_SHUFFLE(0, 0, 0, 0)), x);
+    t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(r4, r4, _MM_SHUFFLE(1, 1, 1, 1)), y));
+    t = _mm_add_ps(t, _mm_mul_ps(_mm_shuffle_ps(r4, r4, _MM_SHUFFLE(2, 2, 2, 2)), z));
+    t = _mm_blend_ps(_mm_xor_ps(t, _mm_set1_ps(-0.0F)), _mm_set1_ps(1.0F), 0x8);
+    Matrix4 r = mat4Identity();
+    _mm_storeu_ps(&r.m11, x);
+    _mm_storeu_ps(&r.m21, y);
+    _mm_storeu_ps(&r.m31, z);
+    _mm_storeu_ps(&r.m41, t);
+    return r;
+}
+#endif
+
+// Inverse of a matrix whose fourth column is (0, 0, 0, 1). Same results as
+// going through mat34Inverse.
+constexpr Matrix4 mat4AffineInverse(const Matrix4& m)
+{
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        __m128 x = _mm_setzero_ps(), y = x, z = x;
+        gmathAffineInverseColumnsSSE(m, x, y, z);
+        __m128 w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        return gmathAffineInverseRowsSSE(m, x, y, z);
+    }
+#endif
+    return mat34ToMat4(mat34Inverse(mat4ToMat34(m)));
+}
+
+// Inverse of a rotation plus translation without scale: the rotation is
+// transposed and the translation carried through it.
+constexpr Matrix4 mat4RigidInverse(const Matrix4& m)
+{
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        __m128 x = _mm_loadu_ps(&m.m11);
+        __m128 y = _mm_loadu_ps(&m.m21);
+        __m128 z = _mm_loadu_ps(&m.m31);
+        __m128 w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        return gmathAffineInverseRowsSSE(m, x, y, z);
+    }
+#endif
+    return {
+        m.m11, m.m21, m.m31, 0.0F,
+        m.m12, m.m22, m.m32, 0.0F,
+        m.m13, m.m23, m.m33, 0.0F,
+        -(m.m41 * m.m11 + m.m42 * m.m12 + m.m43 * m.m13),
+        -(m.m41 * m.m21 + m.m42 * m.m22 + m.m43 * m.m23),
+        -(m.m41 * m.m31 + m.m42 * m.m32 + m.m43 * m.m33),
+        1.0F};
+}
+
+// Normal matrix: inverse transpose of the upper 3x3, translation dropped.
+constexpr Matrix4 mat4InverseTranspose(const Matrix4& m)
+{
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        __m128 x = _mm_setzero_ps(), y = x, z = x;
+        gmathAffineInverseColumnsSSE(m, x, y, z);
+        const __m128 zero = _mm_setzero_ps();
+        Matrix4 r = mat4Identity();
+        _mm_storeu_ps(&r.m11, _mm_blend_ps(x, zero, 0x8));
+        _mm_storeu_ps(&r.m21, _mm_blend_ps(y, zero, 0x8));
+        _mm_storeu_ps(&r.m31, _mm_blend_ps(z, zero, 0x8));
+        return r;
+    }
+#endif
+    Matrix3x4 inv = mat34Inverse(mat4ToMat34(m));
+    return {
+        inv.m11, inv.m21, inv.m31, 0.0F,
+        inv.m12, inv.m22, inv.m32, 0.0F,
+        inv.m13, inv.m23, inv.m33, 0.0F,
+        0.0F, 0.0F, 0.0F, 1.0F};
+}
+
+constexpr Quaternion quatIdentity()
 {
     return {0.0F, 0.0F, 0.0F, 1.0F};
 }
 
-inline Quaternion quatCreateAxisAngle(Vector3 axisUnit, float angleRadian)
+constexpr Quaternion quatCreateAxisAngle(Vector3 axisUnit, float angleRadian)
 {
-    float s = sinf(angleRadian / 2.0F);
-    return {axisUnit.x * s, axisUnit.y * s, axisUnit.z * s, cosf(angleRadian / 2.0F)};
+    float s = gmathSin(angleRadian / 2.0F);
+    return {axisUnit.x * s, axisUnit.y * s, axisUnit.z * s, gmathCos(angleRadian / 2.0F)};
 }
 
-inline Quaternion quatAdd(const Quaternion& a, const Quaternion& b)
+constexpr Quaternion quatAdd(const Quaternion& a, const Quaternion& b)
 {
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        Quaternion q = {0.0F, 0.0F, 0.0F, 0.0F};
+        _mm_storeu_ps(&q.x, _mm_add_ps(_mm_loadu_ps(&a.x), _mm_loadu_ps(&b.x)));
+        return q;
+    }
+#endif
     return {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
 }
 
-inline Quaternion quatSubtraction(const Quaternion& a, const Quaternion& b)
+constexpr Quaternion quatSubtraction(const Quaternion& a, const Quaternion& b)
 {
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        Quaternion q = {0.0F, 0.0F, 0.0F, 0.0F};
+        _mm_storeu_ps(&q.x, _mm_sub_ps(_mm_loadu_ps(&a.x), _mm_loadu_ps(&b.x)));
+        return q;
+    }
+#endif
     return {a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
 }
 
-inline Quaternion quatMultiply(const Quaternion& a, const Quaternion& b)
+constexpr Quaternion quatMultiply(const Quaternion& a, const Quaternion& b)
 {
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        // One column of the Hamilton product per term; negating a factor
+        // instead of subtracting the product rounds identically.
+        const __m128 signX = _mm_set_ps(-0.0F, 0.0F, -0.0F, 0.0F);
+        const __m128 signY = _mm_set_ps(-0.0F, -0.0F, 0.0F, 0.0F);
+        const __m128 signZ = _mm_set_ps(-0.0F, 0.0F, 0.0F, -0.0F);
+        __m128 B = _mm_loadu_ps(&b.x);
+        __m128 r = _mm_mul_ps(_mm_set1_ps(a.x), _mm_xor_ps(_mm_shuffle_ps(B, B, _MM_SHUFFLE(0, 1, 2, 3)), signX));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.y), _mm_xor_ps(_mm_shuffle_ps(B, B, _MM_SHUFFLE(1, 0, 3, 2)), signY)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.z), _mm_xor_ps(_mm_shuffle_ps(B, B, _MM_SHUFFLE(2, 3, 0, 1)), signZ)));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(a.w), B));
+        Quaternion q = {0.0F, 0.0F, 0.0F, 0.0F};
+        _mm_storeu_ps(&q.x, r);
+        return q;
+    }
+#endif
     // clang-format off
     return {
         ( a.x * b.w) + (a.y * b.z) - (a.z * b.y) + (a.w * b.x),
@@ -316,47 +1075,330 @@ inline Quaternion quatMultiply(const Quaternion& a, const Quaternion& b)
     // clang-format on
 }
 
-inline Quaternion quatMultiply(const Quaternion& q, float scalar)
+constexpr Quaternion quatMultiply(const Quaternion& q, float scalar)
 {
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        Quaternion r = {0.0F, 0.0F, 0.0F, 0.0F};
+        _mm_storeu_ps(&r.x, _mm_mul_ps(_mm_loadu_ps(&q.x), _mm_set1_ps(scalar)));
+        return r;
+    }
+#endif
     return {q.x * scalar, q.y * scalar, q.z * scalar, q.w * scalar};
 }
 
-inline Quaternion quatNegate(const Quaternion& q)
+constexpr Quaternion quatNegate(const Quaternion& q)
 {
     return {-q.x, -q.y, -q.z, -q.w};
 }
 
-inline float quatDot(const Quaternion& a, const Quaternion& b)
+constexpr float quatDot(const Quaternion& a, const Quaternion& b)
 {
     return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
 }
 
-inline float quatLengthSquared(const Quaternion& q)
+constexpr float quatLengthSquared(const Quaternion& q)
 {
     return quatDot(q, q);
 }
 
-inline float quatLength(const Quaternion& q)
+constexpr float quatLength(const Quaternion& q)
 {
-    return sqrtf(quatLengthSquared(q));
+    return gmathSqrt(quatLengthSquared(q));
 }
 
-inline Quaternion quatConjugate(const Quaternion& q)
+constexpr Quaternion quatConjugate(const Quaternion& q)
 {
     return {-q.x, -q.y, -q.z, q.w};
 }
 
-inline Vector3 operator*(const Vector3& v, float scalar)
+constexpr Quaternion quatNormalize(const Quaternion& q)
+{
+    return quatMultiply(q, 1.0F / quatLength(q));
+}
+
+// Returns to or -to, whichever lies on the same hemisphere as from, so that
+// blending the two follows the shorter arc.
+constexpr Quaternion quatEnsureShortestPath(const Quaternion& from, const Quaternion& to)
+{
+    return quatDot(from, to) < 0.0F ? quatNegate(to) : to;
+}
+
+// Normalized linear interpolation along the shorter arc. Constant-speed only
+// for small angles, which is what keyframe sampling usually deals with.
+constexpr Quaternion quatNlerp(const Quaternion& a, const Quaternion& b, float t)
+{
+    Quaternion end = quatEnsureShortestPath(a, b);
+    return quatNormalize(quatAdd(a, quatMultiply(quatSubtraction(end, a), t)));
+}
+
+// Slerp approximated by nlerp with a polynomial correction of t that undoes
+// nlerp's speed distortion (fitted over the angle between a and b). Stays
+// within about 0.1 degrees of quatSlerp without any trigonometry.
+constexpr Quaternion quatSlerpApprox(const Quaternion& a, const Quaternion& b, float t)
+{
+    float d = gmathAbs(quatDot(a, b));
+    float A = 1.0904F + d * (-3.2452F + d * (3.55645F - d * 1.43519F));
+    float B = 0.848013F + d * (-1.06021F + d * 0.215638F);
+    float k = A * (t - 0.5F) * (t - 0.5F) + B;
+    float ot = t + t * (t - 0.5F) * (t - 1.0F) * k;
+    return quatNlerp(a, b, ot);
+}
+
+// Batched quatNlerp over structure-of-arrays blocks: each of a, b and out
+// holds count x values, then count y, count z and count w values.
+inline void quatNlerpN(const float* a, const float* b, float t, float* out, size_t count)
+{
+    const float* ax = a;
+    const float* ay = a + count;
+    const float* az = a + 2 * count;
+    const float* aw = a + 3 * count;
+    const float* bx = b;
+    const float* by = b + count;
+    const float* bz = b + 2 * count;
+    const float* bw = b + 3 * count;
+    float* ox = out;
+    float* oy = out + count;
+    float* oz = out + 2 * count;
+    float* ow = out + 3 * count;
+    size_t i = 0;
+
+#if defined(GMATH_AVX2)
+    {
+        const __m256 T = _mm256_set1_ps(t);
+        const __m256 one = _mm256_set1_ps(1.0F);
+        const __m256 sign = _mm256_set1_ps(-0.0F);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 x0 = _mm256_loadu_ps(ax + i), y0 = _mm256_loadu_ps(ay + i), z0 = _mm256_loadu_ps(az + i), w0 = _mm256_loadu_ps(aw + i);
+            __m256 x1 = _mm256_loadu_ps(bx + i), y1 = _mm256_loadu_ps(by + i), z1 = _mm256_loadu_ps(bz + i), w1 = _mm256_loadu_ps(bw + i);
+            __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x0, x1), _mm256_mul_ps(y0, y1)), _mm256_mul_ps(z0, z1)), _mm256_mul_ps(w0, w1));
+            __m256 flip = _mm256_and_ps(_mm256_cmp_ps(dot, _mm256_setzero_ps(), _CMP_LT_OQ), sign);
+            x1 = _mm256_xor_ps(x1, flip);
+            y1 = _mm256_xor_ps(y1, flip);
+            z1 = _mm256_xor_ps(z1, flip);
+            w1 = _mm256_xor_ps(w1, flip);
+            __m256 x = _mm256_add_ps(x0, _mm256_mul_ps(_mm256_sub_ps(x1, x0), T));
+            __m256 y = _mm256_add_ps(y0, _mm256_mul_ps(_mm256_sub_ps(y1, y0), T));
+            __m256 z = _mm256_add_ps(z0, _mm256_mul_ps(_mm256_sub_ps(z1, z0), T));
+            __m256 w = _mm256_add_ps(w0, _mm256_mul_ps(_mm256_sub_ps(w1, w0), T));
+            __m256 len = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)), _mm256_mul_ps(w, w));
+            __m256 inv = _mm256_div_ps(one, _mm256_sqrt_ps(len));
+            _mm256_storeu_ps(ox + i, _mm256_mul_ps(x, inv));
+            _mm256_storeu_ps(oy + i, _mm256_mul_ps(y, inv));
+            _mm256_storeu_ps(oz + i, _mm256_mul_ps(z, inv));
+            _mm256_storeu_ps(ow + i, _mm256_mul_ps(w, inv));
+        }
+    }
+#endif
+
+#if defined(GMATH_SSE4)
+    {
+        const __m128 T = _mm_set1_ps(t);
+        const __m128 one = _mm_set1_ps(1.0F);
+        const __m128 sign = _mm_set1_ps(-0.0F);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x0 = _mm_loadu_ps(ax + i), y0 = _mm_loadu_ps(ay + i), z0 = _mm_loadu_ps(az + i), w0 = _mm_loadu_ps(aw + i);
+            __m128 x1 = _mm_loadu_ps(bx + i), y1 = _mm_loadu_ps(by + i), z1 = _mm_loadu_ps(bz + i), w1 = _mm_loadu_ps(bw + i);
+            __m128 dot = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, x1), _mm_mul_ps(y0, y1)), _mm_mul_ps(z0, z1)), _mm_mul_ps(w0, w1));
+            __m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), sign);
+            x1 = _mm_xor_ps(x1, flip);
+            y1 = _mm_xor_ps(y1, flip);
+            z1 = _mm_xor_ps(z1, flip);
+            w1 = _mm_xor_ps(w1, flip);
+            __m128 x = _mm_add_ps(x0, _mm_mul_ps(_mm_sub_ps(x1, x0), T));
+            __m128 y = _mm_add_ps(y0, _mm_mul_ps(_mm_sub_ps(y1, y0), T));
+            __m128 z = _mm_add_ps(z0, _mm_mul_ps(_mm_sub_ps(z1, z0), T));
+            __m128 w = _mm_add_ps(w0, _mm_mul_ps(_mm_sub_ps(w1, w0), T));
+            __m128 len = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w));
+            __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(len));
+            _mm_storeu_ps(ox + i, _mm_mul_ps(x, inv));
+            _mm_storeu_ps(oy + i, _mm_mul_ps(y, inv));
+            _mm_storeu_ps(oz + i, _mm_mul_ps(z, inv));
+            _mm_storeu_ps(ow + i, _mm_mul_ps(w, inv));
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        Quaternion q = quatNlerp({ax[i], ay[i], az[i], aw[i]}, {bx[i], by[i], bz[i], bw[i]}, t);
+        ox[i] = q.x;
+        oy[i] = q.y;
+        oz[i] = q.z;
+        ow[i] = q.w;
+    }
+}
+
+// Spherical interpolation along the shorter arc; falls back to a linear
+// blend when the rotations are nearly identical.
+inline Quaternion quatSlerp(const Quaternion& a, const Quaternion& b, float t)
+{
+    float cosom = quatDot(a, b);
+    Quaternion end = b;
+    if (cosom < 0.0F)
+    {
+        cosom = -cosom;
+        end = quatNegate(b);
+    }
+
+    float sclp = 1.0F - t;
+    float sclq = t;
+    if ((1.0F - cosom) > 1e-6F)
+    {
+        float omega = acosf(cosom);
+        float sinom = sinf(omega);
+        sclp = sinf((1.0F - t) * omega) / sinom;
+        sclq = sinf(t * omega) / sinom;
+    }
+
+    return quatAdd(quatMultiply(a, sclp), quatMultiply(end, sclq));
+}
+
+// Rotation part of an affine transform, in the convention of
+// mat34CreateTransform. Any scale on the basis vectors is divided out.
+constexpr Quaternion quatCreateFromMat34(const Matrix3x4& m)
+{
+    Vector3 x = vec3Normalize(vec3(m.m11, m.m12, m.m13));
+    Vector3 y = vec3Normalize(vec3(m.m21, m.m22, m.m23));
+    Vector3 z = vec3Normalize(vec3(m.m31, m.m32, m.m33));
+
+    Quaternion q = quatIdentity();
+    float trace = x.x + y.y + z.z;
+    if (trace > 0.0F)
+    {
+        float s = 0.5F / gmathSqrt(trace + 1.0F);
+        q = {(z.y - y.z) * s, (x.z - z.x) * s, (y.x - x.y) * s, 0.25F / s};
+    }
+    else if (x.x > y.y && x.x > z.z)
+    {
+        float s = 2.0F * gmathSqrt(1.0F + x.x - y.y - z.z);
+        q = {0.25F * s, (y.x + x.y) / s, (z.x + x.z) / s, (z.y - y.z) / s};
+    }
+    else if (y.y > z.z)
+    {
+        float s = 2.0F * gmathSqrt(1.0F + y.y - x.x - z.z);
+        q = {(y.x + x.y) / s, 0.25F * s, (z.y + y.z) / s, (x.z - z.x) / s};
+    }
+    else
+    {
+        float s = 2.0F * gmathSqrt(1.0F + z.z - x.x - y.y);
+        q = {(z.x + x.z) / s, (z.y + y.z) / s, 0.25F * s, (y.x - x.y) / s};
+    }
+    return q;
+}
+
+constexpr DualQuaternion dqIdentity()
+{
+    return {quatIdentity(), {0.0F, 0.0F, 0.0F, 0.0F}};
+}
+
+constexpr DualQuaternion dqCreate(const Quaternion& rotation, const Vector3& translation)
+{
+    Quaternion t = {translation.x, translation.y, translation.z, 0.0F};
+    return {rotation, quatMultiply(quatMultiply(rotation, t), 0.5F)};
+}
+
+constexpr DualQuaternion dqCreateFromMat34(const Matrix3x4& m)
+{
+    return dqCreate(quatCreateFromMat34(m), vec3(m.m41, m.m42, m.m43));
+}
+
+constexpr Vector3 dqGetTranslation(const DualQuaternion& dq)
+{
+    Quaternion t = quatMultiply(quatConjugate(dq.real), dq.dual);
+    return vec3(2.0F * t.x, 2.0F * t.y, 2.0F * t.z);
+}
+
+constexpr DualQuaternion dqNormalize(const DualQuaternion& dq)
+{
+    float inv = 1.0F / quatLength(dq.real);
+    return {quatMultiply(dq.real, inv), quatMultiply(dq.dual, inv)};
+}
+
+constexpr Vector3 dqTransformPoint(const Vector3& v, const DualQuaternion& dq)
+{
+    return vec3Add(vec3Transform(v, dq.real), dqGetTranslation(dq));
+}
+
+#if defined(GMATH_SSE4)
+// quatDot broadcast to every lane, summed in the same order as quatDot.
+inline __m128 gmathQuatDotSSE(__m128 a, __m128 b)
+{
+    __m128 p = _mm_mul_ps(a, b);
+    __m128 r = _mm_add_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)));
+    r = _mm_add_ps(r, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+    return _mm_add_ps(r, _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+#endif
+
+// Dual quaternion linear blending of count palette entries, normalized.
+// Each entry is flipped onto the hemisphere of the first one so that the
+// blend never takes the long way around.
+constexpr DualQuaternion dqBlend(const DualQuaternion* palette, const uint8_t* indices, const float* weights, int count)
+{
+#if defined(GMATH_SSE4)
+    if (!GMATH_IS_CONSTANT_EVALUATED())
+    {
+        const __m128 sign = _mm_set1_ps(-0.0F);
+        __m128 pivot = _mm_loadu_ps(&palette[indices[0]].real.x);
+        __m128 real = _mm_setzero_ps();
+        __m128 dual = _mm_setzero_ps();
+        for (int k = 0; k < count; ++k)
+        {
+            const DualQuaternion& dq = palette[indices[k]];
+            __m128 r = _mm_loadu_ps(&dq.real.x);
+            __m128 d = _mm_loadu_ps(&dq.dual.x);
+            __m128 flip = _mm_and_ps(_mm_cmplt_ps(gmathQuatDotSSE(pivot, r), _mm_setzero_ps()), sign);
+            __m128 w = _mm_xor_ps(_mm_set1_ps(weights[k]), flip);
+            real = _mm_add_ps(real, _mm_mul_ps(r, w));
+            dual = _mm_add_ps(dual, _mm_mul_ps(d, w));
+        }
+        __m128 inv = _mm_div_ps(_mm_set1_ps(1.0F), _mm_sqrt_ps(gmathQuatDotSSE(real, real)));
+        DualQuaternion result = dqIdentity();
+        _mm_storeu_ps(&result.real.x, _mm_mul_ps(real, inv));
+        _mm_storeu_ps(&result.dual.x, _mm_mul_ps(dual, inv));
+        return result;
+    }
+#endif
+    const Quaternion& pivot = palette[indices[0]].real;
+    DualQuaternion result = {{0.0F, 0.0F, 0.0F, 0.0F}, {0.0F, 0.0F, 0.0F, 0.0F}};
+    for (int k = 0; k < count; ++k)
+    {
+        const DualQuaternion& dq = palette[indices[k]];
+        float w = quatDot(pivot, dq.real) < 0.0F ? -weights[k] : weights[k];
+        result.real = quatAdd(result.real, quatMultiply(dq.real, w));
+        result.dual = quatAdd(result.dual, quatMultiply(dq.dual, w));
+    }
+    return dqNormalize(result);
+}
+
+constexpr Vector3 operator*(const Vector3& v, float scalar)
 {
     return vec3Multiply(v, scalar);
 }
 
-inline Vector3 operator+(const Vector3& a, const Vector3& b)
+constexpr Vector3 operator+(const Vector3& a, const Vector3& b)
 {
     return vec3Add(a, b);
 }
 
-inline Vector3 operator-(const Vector3& a, const Vector3& b)
+constexpr Vector3 operator-(const Vector3& a, const Vector3& b)
 {
     return vec3Subtract(a, b);
 }
+
+#if defined(GMATH_HAS_CONSTEXPR_MATH)
+// Compile-time checks of the conventions the rest of the code relies on.
+static_assert(mat4Multiply(mat4CreateScale(vec3(2.0F, 2.0F, 2.0F)), mat4CreateTranslation(vec3(1.0F, 2.0F, 3.0F))).m42 == 2.0F, "mat4Multiply applies a, then b");
+static_assert(vec4Transform({1.0F, 1.0F, 1.0F, 1.0F}, mat4CreateTranslation(vec3(1.0F, 2.0F, 3.0F))).z == 4.0F, "row vectors, translation in row 4");
+static_assert(mat34TransformPoint(vec3(1.0F, 1.0F, 1.0F), mat34Inverse(mat34CreateTransform(vec3(1.0F, 2.0F, 3.0F), quatIdentity(), vec3(2.0F, 2.0F, 2.0F)))).y == -0.5F, "mat34Inverse");
+static_assert(quatMultiply(quatCreateAxisAngle(vec3(0.0F, 0.0F, 1.0F), 1.0F), quatIdentity()).z == quatCreateAxisAngle(vec3(0.0F, 0.0F, 1.0F), 1.0F).z, "quatMultiply identity");
+static_assert(gmathAbs(vec3Transform(vec3(1.0F, 0.0F, 0.0F), quatCreateAxisAngle(vec3(0.0F, 0.0F, 1.0F), 3.14159265F / 2.0F)).y + 1.0F) < 1e-6F, "vec3Transform rotates by the conjugate");
+static_assert(gmathAbs(mat4CreatePerspectiveFieldOfView(3.14159265F / 2.0F, 1.0F, 1.0F, 100.0F).m22 - 1.0F) < 1e-6F, "constexpr tan");
+static_assert(mat4Inverse(mat4CreateTranslation(vec3(1.0F, 2.0F, 3.0F))).m43 == -3.0F, "mat4Inverse");
+static_assert(gmathAbs(dqTransformPoint(vec3(1.0F, 0.0F, 0.0F), dqCreate(quatIdentity(), vec3(0.0F, 5.0F, 0.0F))).y - 5.0F) < 1e-6F, "dual quaternion translation");
+static_assert(gmathSqrt(-4.0F) != gmathSqrt(-4.0F) && gmathSqrt(std::numeric_limits<float>::quiet_NaN()) != gmathSqrt(std::numeric_limits<float>::quiet_NaN()), "constexpr sqrt of a negative or NaN is NaN");
+#endif
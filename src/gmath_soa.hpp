@@ -0,0 +1,316 @@
+#pragma once
+
+#include "gmath.hpp"
+#include <vector>
+#include <cassert>
+
+// Structure-of-arrays streams. Components are stored as consecutive blocks
+// (all x, then all y, ...) in one buffer, the layout quatNlerpN expects.
+struct Vector3SoA {
+    std::vector<float> data;
+    size_t count = 0;
+
+    void resize(size_t n)
+    {
+        if (n != count)
+        {
+            data.assign(3 * n, 0.0F);
+            count = n;
+        }
+    }
+
+    void assign(size_t n, const Vector3& v)
+    {
+        data.resize(3 * n);
+        count = n;
+        for (size_t i = 0; i < n; ++i)
+        {
+            set(i, v);
+        }
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    float* x() { return data.data(); }
+    float* y() { return data.data() + count; }
+    float* z() { return data.data() + 2 * count; }
+    const float* x() const { return data.data(); }
+    const float* y() const { return data.data() + count; }
+    const float* z() const { return data.data() + 2 * count; }
+
+    Vector3 get(size_t i) const
+    {
+        return {x()[i], y()[i], z()[i]};
+    }
+
+    void set(size_t i, const Vector3& v)
+    {
+        x()[i] = v.x;
+        y()[i] = v.y;
+        z()[i] = v.z;
+    }
+};
+
+struct QuaternionSoA {
+    std::vector<float> data;
+    size_t count = 0;
+
+    void resize(size_t n)
+    {
+        if (n != count)
+        {
+            data.assign(4 * n, 0.0F);
+            count = n;
+        }
+    }
+
+    void assign(size_t n, const Quaternion& q)
+    {
+        data.resize(4 * n);
+        count = n;
+        for (size_t i = 0; i < n; ++i)
+        {
+            set(i, q);
+        }
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    float* x() { return data.data(); }
+    float* y() { return data.data() + count; }
+    float* z() { return data.data() + 2 * count; }
+    float* w() { return data.data() + 3 * count; }
+    const float* x() const { return data.data(); }
+    const float* y() const { return data.data() + count; }
+    const float* z() const { return data.data() + 2 * count; }
+    const float* w() const { return data.data() + 3 * count; }
+
+    Quaternion get(size_t i) const
+    {
+        return {x()[i], y()[i], z()[i], w()[i]};
+    }
+
+    void set(size_t i, const Quaternion& q)
+    {
+        x()[i] = q.x;
+        y()[i] = q.y;
+        z()[i] = q.z;
+        w()[i] = q.w;
+    }
+};
+
+// Lane types let each batched kernel be written once and run 8-wide (AVX2),
+// 4-wide (SSE4) or 1-wide for the tail.
+struct GmathLaneScalar {
+    typedef float V;
+    static constexpr size_t width = 1;
+    static V load(const float* p) { return *p; }
+    static void store(float* p, V v) { *p = v; }
+    static V set1(float f) { return f; }
+    static V add(V a, V b) { return a + b; }
+    static V sub(V a, V b) { return a - b; }
+    static V mul(V a, V b) { return a * b; }
+    static V div(V a, V b) { return a / b; }
+    static V sqrt(V a) { return sqrtf(a); }
+};
+
+#if defined(GMATH_AVX2)
+struct GmathLaneWide {
+    typedef __m256 V;
+    static constexpr size_t width = 8;
+    static V load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+    static V set1(float f) { return _mm256_set1_ps(f); }
+    static V add(V a, V b) { return _mm256_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm256_div_ps(a, b); }
+    static V sqrt(V a) { return _mm256_sqrt_ps(a); }
+};
+#elif defined(GMATH_SSE4)
+struct GmathLaneWide {
+    typedef __m128 V;
+    static constexpr size_t width = 4;
+    static V load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, V v) { _mm_storeu_ps(p, v); }
+    static V set1(float f) { return _mm_set1_ps(f); }
+    static V add(V a, V b) { return _mm_add_ps(a, b); }
+    static V sub(V a, V b) { return _mm_sub_ps(a, b); }
+    static V mul(V a, V b) { return _mm_mul_ps(a, b); }
+    static V div(V a, V b) { return _mm_div_ps(a, b); }
+    static V sqrt(V a) { return _mm_sqrt_ps(a); }
+};
+#else
+typedef GmathLaneScalar GmathLaneWide;
+#endif
+
+// Calls f(lane, i) for every block of lane width starting at i, wide blocks
+// first and single elements for the remainder.
+template <typename F>
+inline void soaForEach(size_t count, F&& f)
+{
+    size_t i = 0;
+    for (; i + GmathLaneWide::width <= count; i += GmathLaneWide::width)
+    {
+        f(GmathLaneWide(), i);
+    }
+    for (; i < count; ++i)
+    {
+        f(GmathLaneScalar(), i);
+    }
+}
+
+inline void vec3AddN(const Vector3SoA& a, const Vector3SoA& b, Vector3SoA& out)
+{
+    assert(a.size() == b.size());
+    out.resize(a.size());
+    soaForEach(a.size(), [&](auto lane, size_t i) {
+        typedef decltype(lane) L;
+        L::store(out.x() + i, L::add(L::load(a.x() + i), L::load(b.x() + i)));
+        L::store(out.y() + i, L::add(L::load(a.y() + i), L::load(b.y() + i)));
+        L::store(out.z() + i, L::add(L::load(a.z() + i), L::load(b.z() + i)));
+    });
+}
+
+inline void vec3ScaleN(const Vector3SoA& v, float scalar, Vector3SoA& out)
+{
+    out.resize(v.size());
+    soaForEach(v.size(), [&](auto lane, size_t i) {
+        typedef decltype(lane) L;
+        typename L::V s = L::set1(scalar);
+        L::store(out.x() + i, L::mul(L::load(v.x() + i), s));
+        L::store(out.y() + i, L::mul(L::load(v.y() + i), s));
+        L::store(out.z() + i, L::mul(L::load(v.z() + i), s));
+    });
+}
+
+inline void vec3LerpN(const Vector3SoA& a, const Vector3SoA& b, float t, Vector3SoA& out)
+{
+    assert(a.size() == b.size());
+    out.resize(a.size());
+    soaForEach(a.size(), [&](auto lane, size_t i) {
+        typedef decltype(lane) L;
+        typename L::V T = L::set1(t);
+        typename L::V ax = L::load(a.x() + i), ay = L::load(a.y() + i), az = L::load(a.z() + i);
+        L::store(out.x() + i, L::add(ax, L::mul(L::sub(L::load(b.x() + i), ax), T)));
+        L::store(out.y() + i, L::add(ay, L::mul(L::sub(L::load(b.y() + i), ay), T)));
+        L::store(out.z() + i, L::add(az, L::mul(L::sub(L::load(b.z() + i), az), T)));
+    });
+}
+
+inline void vec3DotN(const Vector3SoA& a, const Vector3SoA& b, float* out)
+{
+    assert(a.size() == b.size());
+    soaForEach(a.size(), [&](auto lane, size_t i) {
+        typedef decltype(lane) L;
+        typename L::V d = L::mul(L::load(a.x() + i), L::load(b.x() + i));
+        d = L::add(d, L::mul(L::load(a.y() + i), L::load(b.y() + i)));
+        d = L::add(d, L::mul(L::load(a.z() + i), L::load(b.z() + i)));
+        L::store(out + i, d);
+    });
+}
+
+inline void vec3CrossN(const Vector3SoA& a, const Vector3SoA& b, Vector3SoA& out)
+{
+    assert(a.size() == b.size());
+    out.resize(a.size());
+    soaForEach(a.size(), [&](auto lane, size_t i) {
+        typedef decltype(lane) L;
+        typename L::V ax = L::load(a.x() + i), ay = L::load(a.y() + i), az = L::load(a.z() + i);
+        typename L::V bx = L::load(b.x() + i), by = L::load(b.y() + i), bz = L::load(b.z() + i);
+        L::store(out.x() + i, L::sub(L::mul(ay, bz), L::mul(az, by)));
+        L::store(out.y() + i, L::sub(L::mul(az, bx), L::mul(ax, bz)));
+        L::store(out.z() + i, L::sub(L::mul(ax, by), L::mul(ay, bx)));
+    });
+}
+
+inline void vec3NormalizeN(const Vector3SoA& v, Vector3SoA& out)
+{
+    out.resize(v.size());
+    soaForEach(v.size(), [&](auto lane, size_t i) {
+        typedef decltype(lane) L;
+        typename L::V x = L::load(v.x() + i), y = L::load(v.y() + i), z = L::load(v.z() + i);
+        typename L::V len = L::add(L::add(L::mul(x, x), L::mul(y, y)), L::mul(z, z));
+        typename L::V inv = L::div(L::set1(1.0F), L::sqrt(len));
+        L::store(out.x() + i, L::mul(x, inv));
+        L::store(out.y() + i, L::mul(y, inv));
+        L::store(out.z() + i, L::mul(z, inv));
+    });
+}
+
+// Batched vec3Transform: out[i] = v[i] rotated by q[i].
+inline void quatRotateN(const Vector3SoA& v, const QuaternionSoA& q, Vector3SoA& out)
+{
+    assert(v.size() == q.size());
+    out.resize(v.size());
+    soaForEach(v.size(), [&](auto lane, size_t i) {
+        typedef decltype(lane) L;
+        typename L::V vx = L::load(v.x() + i), vy = L::load(v.y() + i), vz = L::load(v.z() + i);
+        typename L::V qx = L::load(q.x() + i), qy = L::load(q.y() + i), qz = L::load(q.z() + i), qw = L::load(q.w() + i);
+        typename L::V two = L::set1(2.0F);
+        typename L::V cx = L::sub(L::mul(vy, qz), L::mul(vz, qy));
+        typename L::V cy = L::sub(L::mul(vz, qx), L::mul(vx, qz));
+        typename L::V cz = L::sub(L::mul(vx, qy), L::mul(vy, qx));
+        typename L::V a = L::mul(two, qw);
+        typename L::V b = L::sub(L::mul(qw, qw), L::add(L::add(L::mul(qx, qx), L::mul(qy, qy)), L::mul(qz, qz)));
+        typename L::V c = L::mul(two, L::add(L::add(L::mul(qx, vx), L::mul(qy, vy)), L::mul(qz, vz)));
+        L::store(out.x() + i, L::add(L::mul(cx, a), L::add(L::mul(vx, b), L::mul(qx, c))));
+        L::store(out.y() + i, L::add(L::mul(cy, a), L::add(L::mul(vy, b), L::mul(qy, c))));
+        L::store(out.z() + i, L::add(L::mul(cz, a), L::add(L::mul(vz, b), L::mul(qz, c))));
+    });
+}
+
+inline void quatNlerpN(const QuaternionSoA& a, const QuaternionSoA& b, float t, QuaternionSoA& out)
+{
+    assert(a.size() == b.size());
+    out.resize(a.size());
+    quatNlerpN(a.data.data(), b.data.data(), t, out.data.data(), a.size());
+}
+
+// Batched mat34CreateTransform, one Matrix3x4 per element.
+inline void mat34ComposeN(const Vector3SoA& position, const QuaternionSoA& rotation, const Vector3SoA& scale, Matrix3x4* out)
+{
+    assert(position.size() == rotation.size() && position.size() == scale.size());
+    soaForEach(position.size(), [&](auto lane, size_t i) {
+        typedef decltype(lane) L;
+        const size_t W = L::width;
+        typename L::V qx = L::load(rotation.x() + i), qy = L::load(rotation.y() + i), qz = L::load(rotation.z() + i), qw = L::load(rotation.w() + i);
+        typename L::V sx = L::load(scale.x() + i), sy = L::load(scale.y() + i), sz = L::load(scale.z() + i);
+        typename L::V two = L::set1(2.0F);
+
+        // vec3Transform of the unit axes, expanded.
+        typename L::V ww = L::sub(L::mul(qw, qw), L::add(L::add(L::mul(qx, qx), L::mul(qy, qy)), L::mul(qz, qz)));
+        typename L::V xx = L::mul(two, L::mul(qx, qx)), yy = L::mul(two, L::mul(qy, qy)), zz = L::mul(two, L::mul(qz, qz));
+        typename L::V xy = L::mul(two, L::mul(qx, qy)), xz = L::mul(two, L::mul(qx, qz)), yz = L::mul(two, L::mul(qy, qz));
+        typename L::V wx = L::mul(two, L::mul(qw, qx)), wy = L::mul(two, L::mul(qw, qy)), wz = L::mul(two, L::mul(qw, qz));
+
+        float cols[12][W];
+        L::store(cols[0], L::mul(L::add(ww, xx), sx));
+        L::store(cols[1], L::mul(L::add(xy, wz), sy));
+        L::store(cols[2], L::mul(L::sub(xz, wy), sz));
+        L::store(cols[3], L::load(position.x() + i));
+        L::store(cols[4], L::mul(L::sub(xy, wz), sx));
+        L::store(cols[5], L::mul(L::add(ww, yy), sy));
+        L::store(cols[6], L::mul(L::add(yz, wx), sz));
+        L::store(cols[7], L::load(position.y() + i));
+        L::store(cols[8], L::mul(L::add(xz, wy), sx));
+        L::store(cols[9], L::mul(L::sub(yz, wx), sy));
+        L::store(cols[10], L::mul(L::add(ww, zz), sz));
+        L::store(cols[11], L::load(position.z() + i));
+
+        for (size_t k = 0; k < W; ++k)
+        {
+            float* m = &out[i + k].m11;
+            for (int c = 0; c < 12; ++c)
+            {
+                m[c] = cols[c][k];
+            }
+        }
+    });
+}
@@ -0,0 +1,226 @@
+#include "lz4_block.hpp"
+#include <cstring>
+#include <vector>
+
+#define LZ4_MIN_MATCH 4
+// The last 5 bytes are always literals, and no match starts in the last 12.
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MATCH_LIMIT 12
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_HASH_BITS 16
+#define LZ4_WINDOW_MASK 0xFFFF
+
+static uint32_t lz4Read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t lz4Hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_BITS);
+}
+
+static uint8_t* lz4WriteLength(uint8_t* op, size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)length;
+    return op;
+}
+
+// One sequence: literals, then a match unless matchLength is 0 (the last
+// sequence). Returns nullptr if it would not fit before end.
+static uint8_t* lz4WriteSequence(uint8_t* op, uint8_t* end, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+{
+    size_t worst = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+    if (worst > (size_t)(end - op))
+    {
+        return nullptr;
+    }
+    size_t matchCode = matchLength ? matchLength - LZ4_MIN_MATCH : 0;
+    *op++ = (uint8_t)(((literalLength < 15 ? literalLength : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    if (literalLength >= 15)
+    {
+        op = lz4WriteLength(op, literalLength - 15);
+    }
+    if (literalLength)
+    {
+        memcpy(op, literals, literalLength);
+        op += literalLength;
+    }
+    if (matchLength)
+    {
+        *op++ = (uint8_t)offset;
+        *op++ = (uint8_t)(offset >> 8);
+        if (matchCode >= 15)
+        {
+            op = lz4WriteLength(op, matchCode - 15);
+        }
+    }
+    return op;
+}
+
+size_t lz4Compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity, unsigned searchDepth)
+{
+    // head holds the latest position of each hash, chain the one before
+    // each position within the window.
+    std::vector<int64_t> head((size_t)1 << LZ4_HASH_BITS, -1);
+    std::vector<int64_t> chain(size < LZ4_WINDOW_MASK + 1 ? size : LZ4_WINDOW_MASK + 1, -1);
+    auto insert = [&](size_t pos) {
+        uint32_t h = lz4Hash(lz4Read32(src + pos));
+        chain[pos & LZ4_WINDOW_MASK] = head[h];
+        head[h] = (int64_t)pos;
+    };
+
+    uint8_t* op = dst;
+    uint8_t* end = dst + capacity;
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + LZ4_MATCH_LIMIT <= size)
+    {
+        uint32_t sequence = lz4Read32(src + pos);
+        size_t bestLength = 0;
+        size_t bestOffset = 0;
+        int64_t candidate = head[lz4Hash(sequence)];
+        for (unsigned attempt = 0; attempt < searchDepth && candidate >= 0 && pos - (size_t)candidate <= LZ4_MAX_OFFSET; ++attempt)
+        {
+            const uint8_t* match = src + candidate;
+            if (lz4Read32(match) == sequence)
+            {
+                size_t length = LZ4_MIN_MATCH;
+                while (pos + length < size - LZ4_LAST_LITERALS && match[length] == src[pos + length])
+                {
+                    ++length;
+                }
+                if (length > bestLength)
+                {
+                    bestLength = length;
+                    bestOffset = pos - (size_t)candidate;
+                }
+            }
+            int64_t next = chain[(size_t)candidate & LZ4_WINDOW_MASK];
+            if (next >= candidate)
+            {
+                break;
+            }
+            candidate = next;
+        }
+
+        if (bestLength < LZ4_MIN_MATCH)
+        {
+            insert(pos++);
+            continue;
+        }
+        op = lz4WriteSequence(op, end, src + anchor, pos - anchor, bestOffset, bestLength);
+        if (!op)
+        {
+            return 0;
+        }
+        for (size_t i = pos; i < pos + bestLength && i + LZ4_MATCH_LIMIT <= size; ++i)
+        {
+            insert(i);
+        }
+        pos += bestLength;
+        anchor = pos;
+    }
+
+    op = lz4WriteSequence(op, end, src + anchor, size - anchor, 0, 0);
+    return op ? (size_t)(op - dst) : 0;
+}
+
+static bool lz4ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length)
+{
+    uint8_t b;
+    do
+    {
+        if (ip == end)
+        {
+            return false;
+        }
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+bool lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize)
+{
+    const uint8_t* ip = src;
+    const uint8_t* ipEnd = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* opEnd = dst + dstSize;
+    for (;;)
+    {
+        if (ip == ipEnd)
+        {
+            return false;
+        }
+        uint32_t token = *ip++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !lz4ReadLength(ip, ipEnd, literalLength))
+        {
+            return false;
+        }
+        if (literalLength > (size_t)(ipEnd - ip) || literalLength > (size_t)(opEnd - op))
+        {
+            return false;
+        }
+        if (literalLength)
+        {
+            memcpy(op, ip, literalLength);
+            op += literalLength;
+            ip += literalLength;
+        }
+        if (ip == ipEnd)
+        {
+            return op == opEnd;
+        }
+
+        if (ipEnd - ip < 2)
+        {
+            return false;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !lz4ReadLength(ip, ipEnd, matchLength))
+        {
+            return false;
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || matchLength > (size_t)(opEnd - op))
+        {
+            return false;
+        }
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength)
+        {
+            memcpy(op, match, matchLength);
+        }
+        else if (offset >= 8)
+        {
+            // Every 8 bytes read were written before this step.
+            size_t i = 0;
+            for (; i + 8 <= matchLength; i += 8)
+            {
+                memcpy(op + i, match + i, 8);
+            }
+            for (; i < matchLength; ++i)
+            {
+                op[i] = match[i];
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; ++i)
+            {
+                op[i] = match[i];
+            }
+        }
+        op += matchLength;
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// LZ4 block format (no frame header or checksums), so any LZ4 decoder reads
+// what lz4Compress writes. Used for the chunks of baked files; decoding
+// runs at memory speed, while the compressor searches hash chains since it
+// only runs at bake time.
+
+// Largest output lz4Compress can produce for size input bytes.
+inline size_t lz4CompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+// Compresses src into dst, trying up to searchDepth earlier matches per
+// position. Returns the compressed size, or 0 if it does not fit capacity.
+size_t lz4Compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity, unsigned searchDepth = 16);
+
+// Decompresses a whole block. Returns false unless src decodes to exactly
+// dstSize bytes without reading or writing out of bounds, so it is safe on
+// corrupt input.
+bool lz4Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
@@ -3,23 +3,32 @@
 #include "model.hpp"
 #include "gmath.hpp"
 #include "camera.hpp"
+#include "asset_cache.hpp"
+#include "async_io.hpp"
+#include "worker_pool.hpp"
 #include "game_object/game_object.hpp"
 
+Camera gCam;
+
 struct Player : GameObject {
 
-    Model model;
+    ModelInstance model;
 
     void onUpdate(float dt) override
     {
+        Matrix4 world = mat34ToMat4(getWorldMatrix());
+        model.selectLod(gCam, world, 480.0F);
         model.updateAnimation(dt);
-        model.updateMesh(getWorldMatrix());
+        model.updateMesh(world);
         model.draw();
     }
 };
 
-Camera gCam;
-Model gModel;
+ModelInstance gModel;
 SceneTree gScene;
+WorkerPool gWorkers;
+AsyncFileReader gFileReader;
+AssetCache gAssets;
 
 void initOpenGL()
 {
@@ -44,9 +53,10 @@ void onInit()
 
 void onUpdate(const GameAppState& appState)
 {
-    float scale = 1.0F;
-    Matrix4 model = mat4CreateScale(vec3(scale, scale, scale));
+    constexpr float scale = 1.0F;
+    constexpr Matrix4 model = mat4CreateScale(vec3(scale, scale, scale));
     //model = mat4Multiply(mat4CreateFromAxisAngle(vec3(0.0F, 0.0F, 1.0F), deg2Rad(45.0F)), model);
+    gModel.selectLod(gCam, model, 480.0F);
     gModel.updateAnimation(appState.dt);
     gModel.updateMesh(model);
     gCam.updateMVP();
@@ -56,24 +66,33 @@ void onUpdate(const GameAppState& appState)
     gModel.draw();
     gScene.propagateTransform();
     gScene.updateGameObjects(1.0F / 60.0F);
+    gAssets.update();
 }
 
 int main()
 {
-    gModel.load("cube.gltf");
-    gModel.animation.setCurrentAction("RunCycle");
-    //gModel.animation.setCurrentAction("Armature|RunCycle");
+    gAssets.workers = &gWorkers;
+    gAssets.io = &gFileReader;
+    ModelHandle cube = gAssets.loadModel("cube.gltf");
+    if (!cube)
+    {
+        abort();
+    }
+
+    gModel.setAsset(cube);
+    gModel.setCurrentAction("RunCycle");
+    //gModel.setCurrentAction("Armature|RunCycle");
 
     Player obj;
     obj.setPosition(vec3(0.0F, 0.0F, 1.0F));
-    obj.model.load("cube.gltf");
-    obj.model.animation.setCurrentAction("RunCycle");
+    obj.model.setAsset(cube);
+    obj.model.setCurrentAction("RunCycle");
     obj.setScale(vec3(2.0F, 2.0F, 2.0F));
     obj.setRotation(quatCreateAxisAngle(vec3(0.0F, 1.0F, 0.0F), deg2Rad(90.0F)));
     obj.addObject(new Player());
     static_cast<Player*>(obj.objects[0])->setPosition(vec3(0.0F, 0.0F, 1.0F));
-    static_cast<Player*>(obj.objects[0])->model.load("cube.gltf");
-    static_cast<Player*>(obj.objects[0])->model.animation.setCurrentAction("RunCycle");
+    static_cast<Player*>(obj.objects[0])->model.setAsset(cube);
+    static_cast<Player*>(obj.objects[0])->model.setCurrentAction("RunCycle");
     //static_cast<Player*>(obj.objects[0])->setScale(vec3(2.0F, 2.0F, 2.0F));
     gScene.setRoot(&obj);
     //gScene.updateGameObjects(1.0F/60.0F);
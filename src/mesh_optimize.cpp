@@ -0,0 +1,993 @@
+#include "mesh_optimize.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#define FORSYTH_CACHE_SIZE 32
+
+// FIFO cache simulation; reports misses per triangle in triMisses if given.
+static uint32_t simulateVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, unsigned cacheSize, std::vector<uint32_t>& timestamps, uint32_t& time, uint8_t* triMisses = nullptr)
+{
+    uint32_t misses = 0;
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        uint8_t triMiss = 0;
+        for (size_t k = 0; k < 3; ++k)
+        {
+            uint32_t v = indices[i + k];
+            assert(v < vertexCount);
+            (void)vertexCount;
+            if (time - timestamps[v] > cacheSize)
+            {
+                timestamps[v] = time++;
+                ++triMiss;
+            }
+        }
+        misses += triMiss;
+        if (triMisses)
+        {
+            triMisses[i / 3] = triMiss;
+        }
+    }
+    return misses;
+}
+
+VertexCacheStats meshAnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0)
+    {
+        return stats;
+    }
+    // Timestamps start far enough in the past to miss.
+    uint32_t time = cacheSize + 1;
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    stats.misses = simulateVertexCache(indices.data(), indices.size(), vertexCount, cacheSize, timestamps, time);
+    stats.acmr = (float)stats.misses / (float)(indices.size() / 3);
+    stats.atvr = (float)stats.misses / (float)vertexCount;
+    return stats;
+}
+
+struct WeldInfluences {
+    uint8_t bones[MODEL_BONE_INFLUENCE_MAX];
+    float weights[MODEL_BONE_INFLUENCE_MAX];
+};
+
+// Influence slots in bone order with empty slots zeroed, so two vertices
+// compare equal whatever order their influences were assigned in.
+static WeldInfluences weldInfluences(const VertexWeight& w)
+{
+    WeldInfluences r;
+    int order[MODEL_BONE_INFLUENCE_MAX];
+    for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+    {
+        order[k] = k;
+    }
+    std::sort(order, order + MODEL_BONE_INFLUENCE_MAX, [&w](int a, int b) {
+        bool emptyA = w.weights[a] == 0.0F;
+        bool emptyB = w.weights[b] == 0.0F;
+        if (emptyA != emptyB)
+        {
+            return emptyB;
+        }
+        return w.boneIndices[a] < w.boneIndices[b];
+    });
+    for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+    {
+        bool empty = w.weights[order[k]] == 0.0F;
+        r.bones[k] = empty ? 0 : w.boneIndices[order[k]];
+        r.weights[k] = empty ? 0.0F : w.weights[order[k]];
+    }
+    return r;
+}
+
+static uint64_t weldCellKey(int64_t x, int64_t y, int64_t z)
+{
+    uint64_t h = (uint64_t)x * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)y * 0xC2B2AE3D27D4EB4FULL + (h << 6) + (h >> 2);
+    h ^= (uint64_t)z * 0x165667B19E3779F9ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+size_t meshWeldVertices(Mesh& mesh, float epsilon)
+{
+    assert(!mesh.quantized());
+    size_t vertexCount = mesh.positions.size() / 3;
+    bool skinned = !mesh.weights.empty();
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<float> positions;
+    std::vector<VertexWeight> weights;
+    std::vector<WeldInfluences> influences;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+
+    auto cellOf = [epsilon](float f) -> int64_t {
+        if (epsilon > 0.0F)
+        {
+            return (int64_t)floorf(f / epsilon);
+        }
+        // -0 and +0 compare equal, so they must share a cell.
+        f = f == 0.0F ? 0.0F : f;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    };
+    auto matches = [&](uint32_t unique, const float* p, const WeldInfluences& inf) {
+        for (int k = 0; k < 3; ++k)
+        {
+            if (!(fabsf(positions[unique * 3 + k] - p[k]) <= epsilon))
+            {
+                return false;
+            }
+        }
+        if (!skinned)
+        {
+            return true;
+        }
+        const WeldInfluences& other = influences[unique];
+        for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+        {
+            if (other.bones[k] != inf.bones[k] || !(fabsf(other.weights[k] - inf.weights[k]) <= epsilon))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // With an epsilon, a match may sit in any neighbouring cell.
+    int reach = epsilon > 0.0F ? 1 : 0;
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        const float* p = &mesh.positions[v * 3];
+        WeldInfluences inf = skinned ? weldInfluences(mesh.weights[v]) : WeldInfluences();
+        int64_t cx = cellOf(p[0]);
+        int64_t cy = cellOf(p[1]);
+        int64_t cz = cellOf(p[2]);
+        uint32_t found = ~0U;
+        for (int dx = -reach; dx <= reach && found == ~0U; ++dx)
+        {
+            for (int dy = -reach; dy <= reach && found == ~0U; ++dy)
+            {
+                for (int dz = -reach; dz <= reach && found == ~0U; ++dz)
+                {
+                    auto cell = cells.find(weldCellKey(cx + dx, cy + dy, cz + dz));
+                    if (cell == cells.end())
+                    {
+                        continue;
+                    }
+                    for (uint32_t unique : cell->second)
+                    {
+                        if (matches(unique, p, inf))
+                        {
+                            found = unique;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (found == ~0U)
+        {
+            found = (uint32_t)(positions.size() / 3);
+            positions.insert(positions.end(), p, p + 3);
+            if (skinned)
+            {
+                weights.push_back(mesh.weights[v]);
+                influences.push_back(inf);
+            }
+            cells[weldCellKey(cx, cy, cz)].push_back(found);
+        }
+        remap[v] = found;
+    }
+
+    std::vector<uint32_t> source = mesh.indices.unpack();
+    std::vector<uint32_t> indices;
+    indices.reserve(source.size());
+    bool triangles = source.size() % 3 == 0;
+    for (size_t i = 0; i < source.size(); i += triangles ? 3 : 1)
+    {
+        if (!triangles)
+        {
+            indices.push_back(remap[source[i]]);
+            continue;
+        }
+        uint32_t a = remap[source[i]];
+        uint32_t b = remap[source[i + 1]];
+        uint32_t c = remap[source[i + 2]];
+        if (a != b && b != c && a != c)
+        {
+            indices.push_back(a);
+            indices.push_back(b);
+            indices.push_back(c);
+        }
+    }
+
+    mesh.positions.swap(positions);
+    mesh.weights.swap(weights);
+    mesh.indices.assign(indices, mesh.positions.size() / 3);
+    return mesh.positions.size() / 3;
+}
+
+static float forsythVertexScore(int cachePosition, uint32_t liveTriangles)
+{
+    if (liveTriangles == 0)
+    {
+        return -1.0F;
+    }
+    float score = 0.0F;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // The last triangle's vertices are scored flat so it is not
+            // simply extended into a strip.
+            score = 0.75F;
+        }
+        else
+        {
+            const float scaler = 1.0F / (FORSYTH_CACHE_SIZE - 3);
+            score = powf(1.0F - (float)(cachePosition - 3) * scaler, 1.5F);
+        }
+    }
+    // Vertices with few triangles left are finished first.
+    score += 2.0F * powf((float)liveTriangles, -0.5F);
+    return score;
+}
+
+void meshOptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0 || indices.size() % 3 != 0)
+    {
+        return;
+    }
+
+    // Triangles per vertex, the live ones kept at the front of each range.
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (uint32_t v : indices)
+    {
+        ++offsets[v + 1];
+    }
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        uint32_t v = indices[i];
+        adjacency[offsets[v] + liveTriangles[v]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScore[v] = forsythVertexScore(-1, liveTriangles[v]);
+    }
+    std::vector<float> triangleScore(triCount);
+    std::vector<uint8_t> emitted(triCount, 0);
+    uint32_t best = 0;
+    for (size_t t = 0; t < triCount; ++t)
+    {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[best])
+        {
+            best = (uint32_t)t;
+        }
+    }
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    size_t cursor = 0;
+    const uint32_t none = ~0U;
+
+    while (out.size() < indices.size())
+    {
+        if (best == none)
+        {
+            // Dead end: nothing in the cache has triangles left.
+            while (emitted[cursor])
+            {
+                ++cursor;
+            }
+            best = (uint32_t)cursor;
+        }
+
+        const uint32_t* tri = &indices[best * 3];
+        emitted[best] = 1;
+        nextCache.clear();
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t v = tri[k];
+            out.push_back(v);
+            nextCache.push_back(v);
+            uint32_t* live = &adjacency[offsets[v]];
+            uint32_t* last = live + liveTriangles[v] - 1;
+            for (uint32_t* it = live; it <= last; ++it)
+            {
+                if (*it == best)
+                {
+                    std::swap(*it, *last);
+                    break;
+                }
+            }
+            --liveTriangles[v];
+        }
+        for (uint32_t v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+            {
+                nextCache.push_back(v);
+            }
+        }
+        cache.swap(nextCache);
+
+        // Everything that left or moved within the cache is rescored, then
+        // the triangles around the cached vertices.
+        for (uint32_t v : nextCache)
+        {
+            cachePosition[v] = -1;
+        }
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            cachePosition[cache[i]] = i < FORSYTH_CACHE_SIZE ? (int)i : -1;
+        }
+        for (uint32_t v : nextCache)
+        {
+            vertexScore[v] = forsythVertexScore(cachePosition[v], liveTriangles[v]);
+        }
+        for (uint32_t v : cache)
+        {
+            vertexScore[v] = forsythVertexScore(cachePosition[v], liveTriangles[v]);
+        }
+
+        best = none;
+        float bestScore = -1.0F;
+        for (size_t i = 0; i < cache.size() && i < FORSYTH_CACHE_SIZE; ++i)
+        {
+            uint32_t v = cache[i];
+            for (uint32_t j = 0; j < liveTriangles[v]; ++j)
+            {
+                uint32_t t = adjacency[offsets[v] + j];
+                float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                triangleScore[t] = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+        if (cache.size() > FORSYTH_CACHE_SIZE)
+        {
+            cache.resize(FORSYTH_CACHE_SIZE);
+        }
+    }
+
+    indices.swap(out);
+}
+
+void meshOptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& positions, float threshold)
+{
+    size_t triCount = indices.size() / 3;
+    size_t vertexCount = positions.size() / 3;
+    if (triCount == 0 || indices.size() % 3 != 0)
+    {
+        return;
+    }
+
+    // Hard boundaries where a triangle misses on all three vertices: the
+    // order across them does not matter to the cache.
+    std::vector<uint8_t> triMisses(triCount);
+    std::vector<uint32_t> timestamps(vertexCount, 0);
+    uint32_t time = MESH_VERTEX_CACHE_SIZE + 1;
+    simulateVertexCache(indices.data(), indices.size(), vertexCount, MESH_VERTEX_CACHE_SIZE, timestamps, time, triMisses.data());
+    std::vector<uint32_t> hard;
+    for (size_t t = 0; t < triCount; ++t)
+    {
+        if (t == 0 || triMisses[t] == 3)
+        {
+            hard.push_back((uint32_t)t);
+        }
+    }
+    hard.push_back((uint32_t)triCount);
+
+    // Soft boundaries inside each hard cluster, placed wherever restarting
+    // with a cold cache keeps the misses within threshold.
+    std::vector<uint32_t> clusters;
+    for (size_t h = 0; h + 1 < hard.size(); ++h)
+    {
+        uint32_t start = hard[h];
+        uint32_t end = hard[h + 1];
+        time += MESH_VERTEX_CACHE_SIZE + 1;
+        uint32_t clusterMisses = simulateVertexCache(&indices[start * 3], (end - start) * 3, vertexCount, MESH_VERTEX_CACHE_SIZE, timestamps, time);
+        float clusterThreshold = threshold * (float)clusterMisses / (float)(end - start);
+
+        clusters.push_back(start);
+        time += MESH_VERTEX_CACHE_SIZE + 1;
+        uint32_t runStart = start;
+        uint32_t runMisses = 0;
+        for (uint32_t t = start; t < end; ++t)
+        {
+            runMisses += simulateVertexCache(&indices[t * 3], 3, vertexCount, MESH_VERTEX_CACHE_SIZE, timestamps, time);
+            if (t + 1 < end && (float)runMisses / (float)(t + 1 - runStart) <= clusterThreshold)
+            {
+                clusters.push_back(t + 1);
+                runStart = t + 1;
+                runMisses = 0;
+                time += MESH_VERTEX_CACHE_SIZE + 1;
+            }
+        }
+    }
+    clusters.push_back((uint32_t)triCount);
+
+    Vector3 meshCenter = vec3Zero();
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        meshCenter = vec3Add(meshCenter, vec3(positions[v * 3], positions[v * 3 + 1], positions[v * 3 + 2]));
+    }
+    meshCenter = vec3Multiply(meshCenter, 1.0F / (float)std::max<size_t>(vertexCount, 1));
+
+    // Clusters facing away from the centre, i.e. on the outside, go first.
+    struct Cluster {
+        uint32_t start;
+        uint32_t end;
+        float sortKey;
+    };
+    std::vector<Cluster> sorted;
+    for (size_t c = 0; c + 1 < clusters.size(); ++c)
+    {
+        Vector3 centroid = vec3Zero();
+        Vector3 normal = vec3Zero();
+        float area = 0.0F;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            const uint32_t* tri = &indices[t * 3];
+            Vector3 p0 = vec3(positions[tri[0] * 3], positions[tri[0] * 3 + 1], positions[tri[0] * 3 + 2]);
+            Vector3 p1 = vec3(positions[tri[1] * 3], positions[tri[1] * 3 + 1], positions[tri[1] * 3 + 2]);
+            Vector3 p2 = vec3(positions[tri[2] * 3], positions[tri[2] * 3 + 1], positions[tri[2] * 3 + 2]);
+            Vector3 n = vec3Cross(vec3Subtract(p1, p0), vec3Subtract(p2, p0));
+            float triArea = vec3Length(n);
+            centroid = vec3Add(centroid, vec3Multiply(vec3Add(vec3Add(p0, p1), p2), triArea / 3.0F));
+            normal = vec3Add(normal, n);
+            area += triArea;
+        }
+        if (area > 0.0F)
+        {
+            centroid = vec3Multiply(centroid, 1.0F / area);
+        }
+        float normalLength = vec3Length(normal);
+        float key = normalLength > 0.0F ? vec3Dot(vec3Subtract(centroid, meshCenter), normal) / normalLength : 0.0F;
+        sorted.push_back({clusters[c], clusters[c + 1], key});
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    for (const Cluster& c : sorted)
+    {
+        out.insert(out.end(), indices.begin() + c.start * 3, indices.begin() + c.end * 3);
+    }
+    indices.swap(out);
+}
+
+void meshOptimizeVertexFetch(Mesh& mesh)
+{
+    assert(!mesh.quantized());
+    size_t vertexCount = mesh.positions.size() / 3;
+    const uint32_t unused = ~0U;
+    std::vector<uint32_t> remap(vertexCount, unused);
+    uint32_t next = 0;
+    for (size_t level = mesh.lods.size() + 1; level-- > 0;)
+    {
+        IndexBuffer& buffer = level == 0 ? mesh.indices : mesh.lods[level - 1].indices;
+        std::vector<uint32_t> indices = buffer.unpack();
+        for (uint32_t& idx : indices)
+        {
+            if (remap[idx] == unused)
+            {
+                remap[idx] = next++;
+            }
+            idx = remap[idx];
+        }
+        // Coarse levels reach fewer vertices and may fit a narrower width.
+        buffer.assign(indices, next);
+        if (level > 0)
+        {
+            mesh.lods[level - 1].vertexCount = next;
+        }
+    }
+
+    std::vector<float> positions(next * 3);
+    std::vector<VertexWeight> weights(mesh.weights.empty() ? 0 : next);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        uint32_t to = remap[v];
+        if (to == unused)
+        {
+            continue;
+        }
+        positions[to * 3 + 0] = mesh.positions[v * 3 + 0];
+        positions[to * 3 + 1] = mesh.positions[v * 3 + 1];
+        positions[to * 3 + 2] = mesh.positions[v * 3 + 2];
+        if (!weights.empty())
+        {
+            weights[to] = mesh.weights[v];
+        }
+    }
+    mesh.positions.swap(positions);
+    mesh.weights.swap(weights);
+}
+
+// Border edges are held in place this much harder than faces.
+#define MESH_LOD_BORDER_WEIGHT 10.0
+// Cost, as a relative distance, of collapsing between vertices whose skin
+// weights differ completely.
+#define MESH_LOD_SKIN_WEIGHT 0.05
+
+// Sum of squared distances to a set of planes; divided by weight it is the
+// mean squared distance.
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+};
+
+static void quadricAddPlane(Quadric& q, const double n[3], double d, double w)
+{
+    q.a00 += w * n[0] * n[0];
+    q.a01 += w * n[0] * n[1];
+    q.a02 += w * n[0] * n[2];
+    q.a11 += w * n[1] * n[1];
+    q.a12 += w * n[1] * n[2];
+    q.a22 += w * n[2] * n[2];
+    q.b0 += w * n[0] * d;
+    q.b1 += w * n[1] * d;
+    q.b2 += w * n[2] * d;
+    q.c += w * d * d;
+    q.weight += w;
+}
+
+static void quadricAdd(Quadric& q, const Quadric& o)
+{
+    q.a00 += o.a00;
+    q.a01 += o.a01;
+    q.a02 += o.a02;
+    q.a11 += o.a11;
+    q.a12 += o.a12;
+    q.a22 += o.a22;
+    q.b0 += o.b0;
+    q.b1 += o.b1;
+    q.b2 += o.b2;
+    q.c += o.c;
+    q.weight += o.weight;
+}
+
+static double quadricError(const Quadric& q, const double p[3])
+{
+    double x = p[0], y = p[1], z = p[2];
+    double e = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return q.weight > 0.0 ? std::max(e, 0.0) / q.weight : 0.0;
+}
+
+// Half the summed difference between two vertices' per-bone weights: 0 when
+// they skin identically, 1 when they share no influence.
+static double skinDistance(const VertexWeight& a, const VertexWeight& b)
+{
+    uint8_t bones[MODEL_BONE_INFLUENCE_MAX * 2];
+    double difference[MODEL_BONE_INFLUENCE_MAX * 2];
+    int count = 0;
+    auto accumulate = [&](const VertexWeight& w, double sign) {
+        for (int i = 0; i < MODEL_BONE_INFLUENCE_MAX; ++i)
+        {
+            int j = 0;
+            while (j < count && bones[j] != w.boneIndices[i])
+            {
+                ++j;
+            }
+            if (j == count)
+            {
+                bones[count] = w.boneIndices[i];
+                difference[count++] = 0.0;
+            }
+            difference[j] += sign * w.weights[i];
+        }
+    };
+    accumulate(a, 1.0);
+    accumulate(b, -1.0);
+    double distance = 0.0;
+    for (int j = 0; j < count; ++j)
+    {
+        distance += fabs(difference[j]);
+    }
+    return distance * 0.5;
+}
+
+static void lodTriangleNormal(const double* positions, uint32_t a, uint32_t b, uint32_t c, double n[3])
+{
+    const double* p0 = &positions[a * 3];
+    const double* p1 = &positions[b * 3];
+    const double* p2 = &positions[c * 3];
+    double e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    double e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+void meshBuildLods(Mesh& mesh, uint32_t maxLevels, float reduction, float maxError)
+{
+    assert(!mesh.quantized());
+    mesh.lods.clear();
+    size_t vertexCount = mesh.positions.size() / 3;
+    if (maxLevels == 0 || vertexCount == 0 || mesh.indices.size() < 3 || mesh.indices.size() % 3 != 0)
+    {
+        return;
+    }
+    bool skinned = !mesh.weights.empty();
+
+    // Errors are measured with the mesh scaled into a unit box.
+    double lo[3] = {mesh.positions[0], mesh.positions[1], mesh.positions[2]};
+    double hi[3] = {lo[0], lo[1], lo[2]};
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            lo[k] = std::min(lo[k], (double)mesh.positions[v * 3 + k]);
+            hi[k] = std::max(hi[k], (double)mesh.positions[v * 3 + k]);
+        }
+    }
+    double extent = std::max(hi[0] - lo[0], std::max(hi[1] - lo[1], hi[2] - lo[2]));
+    double scale = extent > 0.0 ? 1.0 / extent : 1.0;
+    std::vector<double> positions(vertexCount * 3);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            positions[v * 3 + k] = (mesh.positions[v * 3 + k] - lo[k]) * scale;
+        }
+    }
+
+    std::vector<uint32_t> indices = mesh.indices.unpack();
+    std::vector<Quadric> quadrics(vertexCount);
+    std::unordered_map<uint64_t, uint32_t> edgeUse;
+    auto edgeKey = [](uint32_t a, uint32_t b) { return (uint64_t)a << 32 | b; };
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            ++edgeUse[edgeKey(indices[i + k], indices[i + (k + 1) % 3])];
+        }
+    }
+
+    // Vertices on an open border may only slide along it, and are held
+    // there by planes standing on the border edges.
+    std::vector<uint8_t> border(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        double n[3];
+        lodTriangleNormal(positions.data(), indices[i], indices[i + 1], indices[i + 2], n);
+        double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length <= 0.0)
+        {
+            continue;
+        }
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        const double* p0 = &positions[indices[i] * 3];
+        double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+        for (int k = 0; k < 3; ++k)
+        {
+            quadricAddPlane(quadrics[indices[i + k]], n, d, length * 0.5);
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            if (edgeUse.count(edgeKey(b, a)))
+            {
+                continue;
+            }
+            border[a] = border[b] = 1;
+            const double* pa = &positions[a * 3];
+            const double* pb = &positions[b * 3];
+            double e[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+            double en[3] = {e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0]};
+            double enLength = sqrt(en[0] * en[0] + en[1] * en[1] + en[2] * en[2]);
+            if (enLength <= 0.0)
+            {
+                continue;
+            }
+            en[0] /= enLength;
+            en[1] /= enLength;
+            en[2] /= enLength;
+            double ed = -(en[0] * pa[0] + en[1] * pa[1] + en[2] * pa[2]);
+            double w = (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]) * MESH_LOD_BORDER_WEIGHT;
+            quadricAddPlane(quadrics[a], en, ed, w);
+            quadricAddPlane(quadrics[b], en, ed, w);
+        }
+    }
+
+    struct Collapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> adjacency;
+    std::vector<uint8_t> locked(vertexCount);
+    double maxCost = (double)maxError * maxError;
+    double levelCost = 0.0;
+    size_t levelTriangles = indices.size() / 3;
+
+    while (mesh.lods.size() < maxLevels)
+    {
+        size_t target = (size_t)((float)levelTriangles * reduction);
+        bool stuck = false;
+        while (indices.size() / 3 > target && !stuck)
+        {
+            // Triangles around each vertex.
+            offsets.assign(vertexCount + 1, 0);
+            for (uint32_t v : indices)
+            {
+                ++offsets[v + 1];
+            }
+            for (size_t v = 0; v < vertexCount; ++v)
+            {
+                offsets[v + 1] += offsets[v];
+            }
+            adjacency.resize(indices.size());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i)
+            {
+                adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+            }
+
+            collapses.clear();
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    uint32_t a = indices[i + k];
+                    uint32_t b = indices[i + (k + 1) % 3];
+                    bool borderEdge = !edgeUse.count(edgeKey(b, a));
+                    for (int dir = 0; dir < 2; ++dir)
+                    {
+                        uint32_t from = dir ? b : a;
+                        uint32_t to = dir ? a : b;
+                        // Interior edges are seen from both sides; take each
+                        // direction once.
+                        if (!borderEdge && dir)
+                        {
+                            continue;
+                        }
+                        if (border[from] && !borderEdge)
+                        {
+                            continue;
+                        }
+                        double cost = quadricError(quadrics[from], &positions[to * 3]);
+                        if (skinned)
+                        {
+                            double skin = skinDistance(mesh.weights[from], mesh.weights[to]) * MESH_LOD_SKIN_WEIGHT;
+                            cost += skin * skin;
+                        }
+                        if (cost <= maxCost)
+                        {
+                            collapses.push_back({from, to, cost});
+                        }
+                    }
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+            // Collapses whose neighbourhoods do not overlap, cheapest first,
+            // so each sees the triangles as they were when it was costed.
+            std::fill(locked.begin(), locked.end(), 0);
+            size_t triangles = indices.size() / 3;
+            size_t performed = 0;
+            for (const Collapse& c : collapses)
+            {
+                if (triangles <= target)
+                {
+                    break;
+                }
+                if (locked[c.from] || locked[c.to])
+                {
+                    continue;
+                }
+                bool flips = false;
+                size_t removed = 0;
+                for (uint32_t j = offsets[c.from]; j < offsets[c.from + 1] && !flips; ++j)
+                {
+                    const uint32_t* tri = &indices[adjacency[j] * 3];
+                    if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+                    {
+                        ++removed;
+                        continue;
+                    }
+                    uint32_t moved[3] = {tri[0], tri[1], tri[2]};
+                    for (uint32_t& v : moved)
+                    {
+                        v = v == c.from ? c.to : v;
+                    }
+                    double n0[3];
+                    double n1[3];
+                    lodTriangleNormal(positions.data(), tri[0], tri[1], tri[2], n0);
+                    lodTriangleNormal(positions.data(), moved[0], moved[1], moved[2], n1);
+                    // Turning a face more than 60 degrees counts as a flip.
+                    double dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+                    double lengths = sqrt((n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2]) * (n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2]));
+                    flips = dot <= 0.5 * lengths;
+                }
+                if (flips)
+                {
+                    continue;
+                }
+
+                for (uint32_t j = offsets[c.from]; j < offsets[c.from + 1]; ++j)
+                {
+                    uint32_t* tri = &indices[adjacency[j] * 3];
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        locked[tri[k]] = 1;
+                        tri[k] = tri[k] == c.from ? c.to : tri[k];
+                    }
+                }
+                quadricAdd(quadrics[c.to], quadrics[c.from]);
+                levelCost = std::max(levelCost, c.cost);
+                triangles -= removed;
+                ++performed;
+            }
+            stuck = performed == 0;
+
+            size_t kept = 0;
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                uint32_t a = indices[i];
+                uint32_t b = indices[i + 1];
+                uint32_t c = indices[i + 2];
+                if (a != b && b != c && a != c)
+                {
+                    indices[kept++] = a;
+                    indices[kept++] = b;
+                    indices[kept++] = c;
+                }
+            }
+            indices.resize(kept);
+            edgeUse.clear();
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    ++edgeUse[edgeKey(indices[i + k], indices[i + (k + 1) % 3])];
+                }
+            }
+        }
+
+        // A level must be worth switching to.
+        size_t triangles = indices.size() / 3;
+        if (triangles == 0 || (float)triangles > (float)levelTriangles * 0.9F)
+        {
+            break;
+        }
+        std::vector<uint32_t> levelIndices = indices;
+        meshOptimizeVertexCache(levelIndices, vertexCount);
+        MeshLod lod;
+        lod.indices.assign(levelIndices, vertexCount);
+        lod.vertexCount = (uint32_t)vertexCount;
+        lod.error = (float)(sqrt(levelCost) * extent);
+        mesh.lods.push_back(std::move(lod));
+        levelTriangles = triangles;
+        if (stuck)
+        {
+            break;
+        }
+    }
+
+    meshOptimizeVertexFetch(mesh);
+}
+
+static PackedVertexWeight packVertexWeight(const VertexWeight& w)
+{
+    PackedVertexWeight packed;
+    float sum = 0.0F;
+    for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+    {
+        packed.boneIndices[k] = w.boneIndices[k];
+        sum += std::max(w.weights[k], 0.0F);
+    }
+    if (!(sum > 0.0F))
+    {
+        // Nothing to normalise; bind to the first slot's bone instead.
+        memset(packed.weights, 0, sizeof(packed.weights));
+        packed.weights[0] = 255;
+        return packed;
+    }
+
+    // Largest remainder rounding keeps the total at exactly 255.
+    float remainders[MODEL_BONE_INFLUENCE_MAX];
+    int total = 0;
+    for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+    {
+        float scaled = std::max(w.weights[k], 0.0F) / sum * 255.0F;
+        int whole = std::min((int)scaled, 255);
+        packed.weights[k] = (uint8_t)whole;
+        remainders[k] = scaled - (float)whole;
+        total += whole;
+    }
+    while (total < 255)
+    {
+        int best = 0;
+        for (int k = 1; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+        {
+            if (remainders[k] > remainders[best])
+            {
+                best = k;
+            }
+        }
+        ++packed.weights[best];
+        remainders[best] = -1.0F;
+        ++total;
+    }
+    return packed;
+}
+
+void meshQuantize(Mesh& mesh)
+{
+    assert(!mesh.quantized());
+    size_t vertexCount = mesh.positions.size() / 3;
+    if (vertexCount == 0)
+    {
+        return;
+    }
+
+    float lo[3] = {mesh.positions[0], mesh.positions[1], mesh.positions[2]};
+    float hi[3] = {lo[0], lo[1], lo[2]};
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            lo[k] = std::min(lo[k], mesh.positions[v * 3 + k]);
+            hi[k] = std::max(hi[k], mesh.positions[v * 3 + k]);
+        }
+    }
+    float scale[3];
+    float inverse[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        scale[k] = (hi[k] - lo[k]) / 65535.0F;
+        inverse[k] = scale[k] > 0.0F ? 1.0F / scale[k] : 0.0F;
+    }
+
+    mesh.packedPositions.resize(vertexCount * 3);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            float q = (mesh.positions[v * 3 + k] - lo[k]) * inverse[k] + 0.5F;
+            mesh.packedPositions[v * 3 + k] = (uint16_t)std::min(std::max(q, 0.0F), 65535.0F);
+        }
+    }
+    mesh.quantizeMin = vec3(lo[0], lo[1], lo[2]);
+    mesh.quantizeScale = vec3(scale[0], scale[1], scale[2]);
+
+    mesh.packedWeights.resize(mesh.weights.size());
+    for (size_t v = 0; v < mesh.weights.size(); ++v)
+    {
+        mesh.packedWeights[v] = packVertexWeight(mesh.weights[v]);
+    }
+    std::vector<float>().swap(mesh.positions);
+    std::vector<VertexWeight>().swap(mesh.weights);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "model.hpp"
+
+// Size of the FIFO post-transform cache the statistics are measured against.
+#define MESH_VERTEX_CACHE_SIZE 16
+
+struct VertexCacheStats {
+    uint32_t misses = 0;
+    // Average cache misses per triangle (0.5 is ideal, 3 is worst) and per
+    // vertex (1 is ideal).
+    float acmr = 0.0F;
+    float atvr = 0.0F;
+};
+
+VertexCacheStats meshAnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned cacheSize = MESH_VERTEX_CACHE_SIZE);
+
+// The passes below work on meshes that are not yet quantized.
+
+// Merges vertices whose positions lie within epsilon per axis and whose bone
+// influences match within epsilon, then drops triangles that collapse. An
+// epsilon of 0 merges exact duplicates only. Returns the new vertex count.
+size_t meshWeldVertices(Mesh& mesh, float epsilon = 0.0F);
+
+// Reorders triangles for post-transform cache hits (Forsyth's linear-speed
+// vertex cache optimisation).
+void meshOptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Splits a cache-ordered triangle list into clusters that cost at most
+// threshold times the cache misses, then orders the clusters outside-in so
+// the depth test rejects more of what is drawn later.
+void meshOptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<float>& positions, float threshold = 1.05F);
+
+// Renumbers vertices in order of first use and drops unreferenced ones, so
+// skinning and transforms walk positions and weights linearly. LODs are
+// walked coarsest first, which leaves each one's vertices as a prefix and
+// sets its vertexCount.
+void meshOptimizeVertexFetch(Mesh& mesh);
+
+// Replaces mesh.lods with up to maxLevels simplified versions of the mesh,
+// each keeping about reduction of the previous level's triangles. Edges are
+// collapsed onto existing vertices in order of quadric error, so positions
+// and skin weights are never altered, only shared; collapses between
+// differently weighted vertices are penalised. The chain stops early once a
+// level would exceed maxError, relative to the mesh's largest extent, or
+// stops shrinking. Ends with meshOptimizeVertexFetch.
+void meshBuildLods(Mesh& mesh, uint32_t maxLevels, float reduction = 0.5F, float maxError = 0.02F);
+
+// Replaces positions and weights with their quantized form (see
+// Mesh::packedPositions). Positions move by at most half a step of
+// 1/65535 of the mesh bounds; weights are renormalised and rounded so each
+// vertex's sum to exactly 255. Run after every other pass, which all expect
+// float data.
+void meshQuantize(Mesh& mesh);
@@ -1,3 +1,305 @@
 #include "model.hpp"
+#include "mesh_optimize.hpp"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <stack>
+#include <cstdio>
+#include <cstdlib>
 
-Assimp::Importer Model::importer;
+static Matrix3x4 assimpMat4ToMat34(const aiMatrix4x4& m)
+{
+    Matrix3x4 my = {
+        m.a1, m.a2, m.a3, m.a4,
+        m.b1, m.b2, m.b3, m.b4,
+        m.c1, m.c2, m.c3, m.c4};
+    return my;
+}
+
+static Vector3 assimpVec3ToVec3(const aiVector3D& v)
+{
+    return vec3(v.x, v.y, v.z);
+}
+
+// mat34CreateTransform builds its basis with vec3Transform, which rotates by
+// the conjugate of what Assimp's rotation matrix does, so keys are conjugated
+// here to animate the same way. Interpolation is unaffected by conjugation.
+static Quaternion assimpQuatToQuat(const aiQuaternion& q)
+{
+    return quatConjugate({q.x, q.y, q.z, q.w});
+}
+
+void ModelAsset::load(const char* path)
+{
+    if (!loadSource(path))
+    {
+        abort();
+    }
+}
+
+// Each load owns its importer, so assets can be imported on several threads
+// at once.
+bool ModelAsset::loadSource(const char* path, const ModelImportOptions& options, ModelImportStats* stats)
+{
+    assert(path);
+
+    Assimp::Importer importer;
+    scene = importer.ReadFile(path, 0);
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode || !scene->HasMeshes())
+    {
+        printf("ERROR::ASSIMP => %s\n", importer.GetErrorString());
+        scene = nullptr;
+        return false;
+    }
+
+    processNode(scene->mRootNode);
+    processAnimationNode();
+
+    ModelImportStats totals;
+    uint32_t missesBefore = 0;
+    uint32_t missesAfter = 0;
+    for (Mesh& mesh : baseMeshes)
+    {
+        size_t vertexCount = mesh.positions.size() / 3;
+        missesBefore += meshAnalyzeVertexCache(mesh.indices.unpack(), vertexCount).misses;
+        totals.verticesBefore += vertexCount;
+        if (options.weldVertices)
+        {
+            vertexCount = meshWeldVertices(mesh, options.weldEpsilon);
+        }
+        // The passes assume triangle lists; anything else is left alone.
+        if (mesh.indices.size() % 3 == 0)
+        {
+            std::vector<uint32_t> indices = mesh.indices.unpack();
+            if (options.optimizeVertexCache)
+            {
+                meshOptimizeVertexCache(indices, vertexCount);
+            }
+            if (options.optimizeOverdraw)
+            {
+                meshOptimizeOverdraw(indices, mesh.positions);
+            }
+            mesh.indices.assign(indices, vertexCount);
+            // Building LODs reorders the vertices for them itself.
+            if (options.lodLevels > 0)
+            {
+                meshBuildLods(mesh, options.lodLevels, options.lodReduction, options.lodMaxError);
+            }
+            else if (options.optimizeVertexFetch)
+            {
+                meshOptimizeVertexFetch(mesh);
+            }
+        }
+        missesAfter += meshAnalyzeVertexCache(mesh.indices.unpack(), mesh.positions.size() / 3).misses;
+        totals.indexBytes += mesh.indices.data.size();
+        for (const MeshLod& lod : mesh.lods)
+        {
+            totals.indexBytes += lod.indices.data.size();
+        }
+        totals.triangles += mesh.indices.size() / 3;
+        totals.verticesAfter += mesh.positions.size() / 3;
+        totals.lods += mesh.lods.size();
+        if (options.quantizeVertices)
+        {
+            meshQuantize(mesh);
+        }
+    }
+    if (stats && totals.triangles)
+    {
+        totals.acmrBefore = (float)missesBefore / (float)totals.triangles;
+        totals.acmrAfter = (float)missesAfter / (float)totals.triangles;
+        *stats = totals;
+    }
+
+    scene = nullptr;
+    return true;
+}
+
+void ModelAsset::processNode(aiNode* node)
+{
+    for (uint32_t i = 0; i < node->mNumMeshes; ++i)
+    {
+        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+        baseMeshes.push_back(processMesh(mesh));
+    }
+    for (uint32_t i = 0; i < node->mNumChildren; ++i)
+    {
+        processNode(node->mChildren[i]);
+    }
+}
+
+Mesh ModelAsset::processMesh(aiMesh* mesh)
+{
+    Mesh polygon;
+    for (uint32_t i = 0; i < mesh->mNumVertices; ++i)
+    {
+        aiVector3D v = mesh->mVertices[i];
+        polygon.positions.push_back(v.x);
+        polygon.positions.push_back(v.y);
+        polygon.positions.push_back(v.z);
+
+        if (mesh->HasBones())
+        {
+            polygon.weights.push_back(VertexWeight());
+        }
+    }
+    std::vector<uint32_t> indices;
+    for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
+    {
+        aiFace face = mesh->mFaces[i];
+        for (uint32_t j = 0; j < face.mNumIndices; ++j)
+        {
+            indices.push_back(face.mIndices[j]);
+        }
+    }
+    polygon.indices.assign(indices, mesh->mNumVertices);
+    if (mesh->HasBones())
+    {
+        processBone(mesh, polygon);
+    }
+    return polygon;
+}
+
+void ModelAsset::processBone(aiMesh* mesh, Mesh& polygon)
+{
+    std::unordered_map<std::string, const aiBone*> boneNames;
+
+    for (uint32_t i = 0; i < mesh->mNumBones; ++i)
+    {
+        const aiBone* bone = mesh->mBones[i];
+        boneNames[std::string(bone->mName.C_Str())] = bone;
+    }
+
+    const aiNode* rootBone = nullptr;
+    std::stack<const aiNode*> nodeStack;
+    nodeStack.push(scene->mRootNode);
+    while (nodeStack.size())
+    {
+        const aiNode* node = nodeStack.top();
+        nodeStack.pop();
+        for (uint32_t i = 0; i < node->mNumChildren; ++i)
+        {
+            const aiNode* child = node->mChildren[i];
+            if (boneNames.count(std::string(child->mName.C_Str())) > 0)
+            {
+                rootBone = child;
+                goto foundRoot;
+            }
+            nodeStack.push(child);
+        }
+    }
+    assert(rootBone);
+foundRoot:
+
+    boneHierarchy.push_back(Bone());
+    nodeStack = std::stack<const aiNode*>();
+    nodeStack.push(rootBone);
+    uint8_t boneCounter = 1;
+    while (nodeStack.size())
+    {
+        const aiNode* node = nodeStack.top();
+        nodeStack.pop();
+        if (boneNames.count(std::string(node->mName.C_Str())) < 1)
+        {
+            continue;
+        }
+        const aiBone* bone = boneNames[std::string(node->mName.C_Str())];
+        Bone b;
+        b.parent = 0;
+        b.offsetMatrix = assimpMat4ToMat34(bone->mOffsetMatrix);
+        boneHierarchy.push_back(b);
+        boneIndexMap[std::string(node->mName.C_Str())] = boneCounter;
+        ++boneCounter;
+        for (uint32_t i = 0; i < node->mNumChildren; ++i)
+        {
+            const aiNode* child = node->mChildren[i];
+            nodeStack.push(child);
+        }
+    }
+
+    nodeStack = std::stack<const aiNode*>();
+    nodeStack.push(rootBone);
+    while (nodeStack.size())
+    {
+        const aiNode* node = nodeStack.top();
+        nodeStack.pop();
+        if (boneNames.count(std::string(node->mName.C_Str())) < 1)
+        {
+            continue;
+        }
+        else
+        {
+            if (rootBone->mName != node->mName)
+            {
+                uint8_t parent = boneIndexMap[std::string(node->mParent->mName.C_Str())];
+                uint8_t current = boneIndexMap[std::string(node->mName.C_Str())];
+                boneHierarchy[current].parent = parent;
+            }
+        }
+
+        for (uint32_t i = 0; i < node->mNumChildren; ++i)
+        {
+            const aiNode* child = node->mChildren[i];
+            nodeStack.push(child);
+        }
+    }
+
+    for (uint32_t i = 0; i < mesh->mNumBones; ++i)
+    {
+        const aiBone* bone = mesh->mBones[i];
+        uint8_t idx = boneIndexMap[std::string(bone->mName.C_Str())];
+        for (uint32_t j = 0; j < bone->mNumWeights; ++j)
+        {
+            aiVertexWeight w = bone->mWeights[j];
+            for (uint32_t k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+            {
+                if (w.mWeight > 0.0 && polygon.weights[w.mVertexId].boneIndices[k] == 0)
+                {
+                    polygon.weights[w.mVertexId].boneIndices[k] = idx;
+                    polygon.weights[w.mVertexId].weights[k] = w.mWeight;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void ModelAsset::processAnimationNode()
+{
+    for (uint32_t i = 0; i < scene->mNumAnimations; ++i)
+    {
+        const aiAnimation* animAction = scene->mAnimations[i];
+        AnimAction action;
+        action.duration = scene->mAnimations[i]->mDuration / 1000.0;
+        for (uint32_t j = 0; j < animAction->mNumChannels; ++j)
+        {
+            const aiNodeAnim* animChannel = animAction->mChannels[j];
+            if (boneIndexMap.count(std::string(animChannel->mNodeName.C_Str())) == 0)
+            {
+                continue;
+            }
+            assert(animChannel->mNumPositionKeys == animChannel->mNumRotationKeys && animChannel->mNumPositionKeys == animChannel->mNumScalingKeys);
+            action.keyframes.resize(animChannel->mNumPositionKeys);
+            uint8_t boneID = boneIndexMap[std::string(animChannel->mNodeName.C_Str())];
+            for (uint32_t k = 0; k < animChannel->mNumPositionKeys; ++k)
+            {
+                aiVectorKey keyPos = animChannel->mPositionKeys[k];
+                aiQuatKey keyRot = animChannel->mRotationKeys[k];
+                aiVectorKey keyScale = animChannel->mScalingKeys[k];
+                AnimKeyFrame& frame = action.keyframes[k];
+                if (frame.locations.size() != boneHierarchy.size())
+                {
+                    frame.locations.assign(boneHierarchy.size(), vec3Zero());
+                    frame.rotations.assign(boneHierarchy.size(), quatIdentity());
+                    frame.scales.assign(boneHierarchy.size(), vec3One());
+                }
+                frame.locations.set(boneID, assimpVec3ToVec3(keyPos.mValue));
+                frame.rotations.set(boneID, assimpQuatToQuat(keyRot.mValue));
+                frame.scales.set(boneID, assimpVec3ToVec3(keyScale.mValue));
+                action.keyframes[k].timeStamp = keyPos.mTime / 1000.0;
+            }
+        }
+        actions[std::string(animAction->mName.C_Str())] = action;
+    }
+}
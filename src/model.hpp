@@ -1,45 +1,35 @@
 #pragma once
 
 #include "glad.h"
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
+#include <algorithm>
 #include <vector>
 #include <unordered_map>
-#include <stack>
 #include <string>
+#include <memory>
 #include <cassert>
 #include <cstdint>
-#include <cstdlib>
+#include <cstring>
 #include "gmath.hpp"
+#include "gmath_soa.hpp"
+#include "camera.hpp"
 
 #define MODEL_BONE_INFLUENCE_MAX 4
 
-inline aiMatrix4x4 myMat4ToAssimpMat4(const Matrix4& my)
-{
-    aiMatrix4x4 m(
-        my.m11, my.m21, my.m31, my.m41,
-        my.m12, my.m22, my.m32, my.m42,
-        my.m13, my.m23, my.m33, my.m43,
-        my.m14, my.m24, my.m34, my.m44);
-    return m;
-}
+struct aiScene;
+struct aiNode;
+struct aiMesh;
+struct WorkerPool;
 
 struct Bone {
-    uint8_t parent;
-    aiMatrix4x4 offsetMatrix;
-    aiMatrix4x4 localMatrix;
-    aiMatrix4x4 globalMatrix;
-};
-
-struct AnimKey {
-    aiVector3D location;
-    aiQuaternion rotation;
-    aiVector3D scale;
+    uint8_t parent = 0;
+    Matrix3x4 offsetMatrix = mat34Identity();
 };
 
+// One key per bone, indexed like the bone hierarchy.
 struct AnimKeyFrame {
-    std::vector<AnimKey> keyPerBone;
+    Vector3SoA locations;
+    QuaternionSoA rotations;
+    Vector3SoA scales;
     double timeStamp;
 };
 
@@ -48,11 +38,24 @@ struct AnimAction {
     double duration;
 };
 
+// Rotation interpolation used when sampling a pose, cheapest first.
+enum class AnimQuality {
+    Nlerp,
+    SlerpApprox,
+    Slerp,
+};
+
+// Playback state of one instance; the actions it plays are owned by the
+// ModelAsset.
 struct Animation {
-    std::unordered_map<std::string, AnimAction> actions;
     const AnimAction* currentAction;
     double elapsedTime;
-    double prevTime;
+    AnimQuality quality = AnimQuality::Slerp;
+    Vector3SoA poseLocations;
+    QuaternionSoA poseRotations;
+    Vector3SoA poseScales;
+    std::vector<Matrix3x4> poseMatrices;
+    std::vector<Matrix3x4> globalMatrices;
 
     Animation()
     {
@@ -60,15 +63,16 @@ struct Animation {
         elapsedTime = 0.0;
     }
 
-    void setCurrentAction(std::string name)
+    void setCurrentAction(const AnimAction* action)
     {
-        assert(actions.size());
-        assert(actions.count(name) > 0);
-        currentAction = &actions[name];
+        assert(action);
+        currentAction = action;
         elapsedTime = 0.0F;
     }
 
-    void updateAnimation(double dt, std::vector<Bone>& lerpBones, std::vector<aiMatrix4x4>& outBoneTable)
+    // Writes the skinning palette to outBoneTable, or as dual quaternions to
+    // outDualQuatTable instead when one is given.
+    void updateAnimation(double dt, const std::vector<Bone>& bones, std::vector<Matrix3x4>& outBoneTable, std::vector<DualQuaternion>* outDualQuatTable = nullptr)
     {
         assert(currentAction);
 
@@ -107,29 +111,54 @@ struct Animation {
             scaleFactor = float(midWayLength / frameDiff);
         }
 
-        const uint32_t boneFirst = 1;
-        for (uint32_t i = boneFirst; i < lastFrame->keyPerBone.size(); ++i)
+        vec3LerpN(lastFrame->locations, nextFrame->locations, scaleFactor, poseLocations);
+        vec3LerpN(lastFrame->scales, nextFrame->scales, scaleFactor, poseScales);
+        if (quality == AnimQuality::Nlerp)
+        {
+            quatNlerpN(lastFrame->rotations, nextFrame->rotations, scaleFactor, poseRotations);
+        }
+        else
         {
-            const AnimKey* k0 = &lastFrame->keyPerBone[i];
-            const AnimKey* k1 = &nextFrame->keyPerBone[i];
-            aiVector3D location = k0->location + (k1->location - k0->location) * scaleFactor;
-            aiQuaternion rotation;
-            aiQuaternion::Interpolate(rotation, k0->rotation, k1->rotation, scaleFactor);
-            aiVector3D scaling = k0->scale + (k1->scale - k0->scale) * scaleFactor;
-            lerpBones[i].localMatrix = aiMatrix4x4(scaling, rotation, location);
+            poseRotations.resize(lastFrame->rotations.size());
+            for (size_t i = 0; i < poseRotations.size(); ++i)
+            {
+                Quaternion q0 = lastFrame->rotations.get(i);
+                Quaternion q1 = nextFrame->rotations.get(i);
+                if (quality == AnimQuality::SlerpApprox)
+                {
+                    poseRotations.set(i, quatSlerpApprox(q0, q1, scaleFactor));
+                }
+                else
+                {
+                    poseRotations.set(i, quatSlerp(q0, q1, scaleFactor));
+                }
+            }
         }
+        poseMatrices.resize(poseLocations.size());
+        mat34ComposeN(poseLocations, poseRotations, poseScales, poseMatrices.data());
 
-        for (uint32_t i = boneFirst; i < lerpBones.size(); ++i)
+        globalMatrices.resize(bones.size(), mat34Identity());
+        const uint32_t boneFirst = 1;
+        for (uint32_t i = boneFirst; i < bones.size(); ++i)
         {
-            Bone* bone = &lerpBones[i];
-            aiMatrix4x4 parentGlobalTransform = aiMatrix4x4();
+            const Bone* bone = &bones[i];
+            Matrix3x4 parentGlobalTransform = mat34Identity();
             if (bone->parent > 0)
             {
-                parentGlobalTransform = lerpBones[bone->parent].globalMatrix;
+                parentGlobalTransform = globalMatrices[bone->parent];
             }
 
-            bone->globalMatrix = parentGlobalTransform * bone->localMatrix;
-            outBoneTable[i] = bone->globalMatrix * bone->offsetMatrix;
+            Matrix3x4 localMatrix = i < poseMatrices.size() ? poseMatrices[i] : mat34Identity();
+            globalMatrices[i] = mat34Multiply(localMatrix, parentGlobalTransform);
+            Matrix3x4 skinMatrix = mat34Multiply(bone->offsetMatrix, globalMatrices[i]);
+            if (outDualQuatTable)
+            {
+                (*outDualQuatTable)[i] = dqCreateFromMat34(skinMatrix);
+            }
+            else
+            {
+                outBoneTable[i] = skinMatrix;
+            }
         }
     }
 };
@@ -148,250 +177,428 @@ struct VertexWeight {
     }
 };
 
-struct Mesh {
-    std::vector<float> positions;
-    std::vector<VertexWeight> weights;
-    std::vector<uint32_t> indices;
+// VertexWeight in 8 bytes: weights as 8-bit unorm values that always sum to
+// 255.
+struct PackedVertexWeight {
+    uint8_t boneIndices[MODEL_BONE_INFLUENCE_MAX];
+    uint8_t weights[MODEL_BONE_INFLUENCE_MAX];
 };
 
-struct Model {
-    static Assimp::Importer importer;
+// Triangle indices at the narrowest width, 1, 2 or 4 bytes, that can
+// address the vertices they were assigned for. Processing works on plain
+// uint32_t lists and packs them here once it is done.
+struct IndexBuffer {
+    std::vector<uint8_t> data;
+    uint32_t stride = 4;
 
-    const aiScene* scene = nullptr;
-    std::vector<Bone> boneHierarchy;
-    std::unordered_map<std::string, uint8_t> boneIndexMap;
-    Animation animation;
-    std::vector<aiMatrix4x4> boneTable;
-    std::vector<Mesh> baseMeshes;
-    std::vector<Mesh> animatedMeshes;
-    std::vector<Mesh> displayMeshes;
+    static uint32_t strideFor(size_t vertexCount)
+    {
+        return vertexCount <= 0x100 ? 1 : vertexCount <= 0x10000 ? 2 : 4;
+    }
 
-    void load(const char* path)
+    size_t size() const
     {
-        assert(path);
+        return data.size() / stride;
+    }
 
-        scene = importer.ReadFile(path, 0);
+    bool empty() const
+    {
+        return data.empty();
+    }
 
-        if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode || !scene->HasMeshes())
+    uint32_t operator[](size_t i) const
+    {
+        if (stride == 1)
         {
-            printf("ERROR::ASSIMP => %s\n", importer.GetErrorString());
-            abort();
+            return data[i];
         }
-
-        processNode(scene->mRootNode);
-        processAnimationNode();
-
-        boneTable.resize(boneHierarchy.size());
-        animatedMeshes = baseMeshes;
-        displayMeshes = baseMeshes;
-
-        scene = nullptr;
-        importer.FreeScene();
+        if (stride == 2)
+        {
+            uint16_t idx;
+            memcpy(&idx, &data[i * 2], sizeof(idx));
+            return idx;
+        }
+        uint32_t idx;
+        memcpy(&idx, &data[i * 4], sizeof(idx));
+        return idx;
     }
 
-    void processNode(aiNode* node)
+    // Calls f with every index, choosing the width once rather than per
+    // index.
+    template<typename F>
+    void forEach(F f) const
     {
-        for (uint32_t i = 0; i < node->mNumMeshes; ++i)
+        if (stride == 1)
+        {
+            forEachTyped<uint8_t>(f);
+        }
+        else if (stride == 2)
         {
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            baseMeshes.push_back(processMesh(mesh));
+            forEachTyped<uint16_t>(f);
         }
-        for (uint32_t i = 0; i < node->mNumChildren; ++i)
+        else
         {
-            processNode(node->mChildren[i]);
+            forEachTyped<uint32_t>(f);
         }
     }
 
-    Mesh processMesh(aiMesh* mesh)
+    void assign(const std::vector<uint32_t>& indices, size_t vertexCount)
     {
-        Mesh polygon;
-        for (uint32_t i = 0; i < mesh->mNumVertices; ++i)
+        stride = strideFor(vertexCount);
+        data.resize(indices.size() * stride);
+        for (size_t i = 0; i < indices.size(); ++i)
         {
-            aiVector3D v = mesh->mVertices[i];
-            polygon.positions.push_back(v.x);
-            polygon.positions.push_back(v.y);
-            polygon.positions.push_back(v.z);
-
-            if (mesh->HasBones())
+            assert(indices[i] < vertexCount);
+            if (stride == 1)
             {
-                polygon.weights.push_back(VertexWeight());
+                data[i] = (uint8_t)indices[i];
             }
-        }
-        for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
-        {
-            aiFace face = mesh->mFaces[i];
-            for (uint32_t j = 0; j < face.mNumIndices; ++j)
+            else if (stride == 2)
             {
-                polygon.indices.push_back(face.mIndices[j]);
+                uint16_t idx = (uint16_t)indices[i];
+                memcpy(&data[i * 2], &idx, sizeof(idx));
+            }
+            else
+            {
+                memcpy(&data[i * 4], &indices[i], sizeof(uint32_t));
             }
         }
-        if (mesh->HasBones())
+    }
+
+    std::vector<uint32_t> unpack() const
+    {
+        std::vector<uint32_t> indices;
+        indices.reserve(size());
+        forEach([&indices](uint32_t idx) { indices.push_back(idx); });
+        return indices;
+    }
+
+    GLenum glType() const
+    {
+        return stride == 1 ? GL_UNSIGNED_BYTE : stride == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+
+private:
+    template<typename T, typename F>
+    void forEachTyped(F& f) const
+    {
+        const uint8_t* p = data.data();
+        size_t count = size();
+        for (size_t i = 0; i < count; ++i)
         {
-            processBone(mesh, polygon);
+            T idx;
+            memcpy(&idx, p + i * sizeof(T), sizeof(T));
+            f((uint32_t)idx);
         }
-        return polygon;
     }
+};
 
-    void processBone(aiMesh* mesh, Mesh& polygon)
+// A simplified version of a Mesh, drawn from the same vertices. It only
+// references the first vertexCount of them, so skinning it can stop there.
+struct MeshLod {
+    IndexBuffer indices;
+    uint32_t vertexCount = 0;
+    // How far, in mesh units, the surface may stray from the full mesh.
+    float error = 0.0F;
+};
+
+struct Mesh {
+    std::vector<float> positions;
+    std::vector<VertexWeight> weights;
+    IndexBuffer indices;
+    // Coarser levels after the full mesh, finest first; see meshBuildLods.
+    std::vector<MeshLod> lods;
+    // Quantized form from meshQuantize, which empties positions and weights:
+    // 16-bit unorm positions within the mesh bounds, decoded as
+    // quantizeMin + q * quantizeScale, and packed weights. 14 bytes per
+    // vertex instead of 32.
+    std::vector<uint16_t> packedPositions;
+    std::vector<PackedVertexWeight> packedWeights;
+    Vector3 quantizeMin = vec3Zero();
+    Vector3 quantizeScale = vec3Zero();
+
+    bool quantized() const
+    {
+        return !packedPositions.empty();
+    }
+
+    bool skinned() const
     {
-        std::unordered_map<std::string, const aiBone*> boneNames;
+        return !weights.empty() || !packedWeights.empty();
+    }
 
-        for (uint32_t i = 0; i < mesh->mNumBones; ++i)
+    size_t vertexCount() const
+    {
+        return quantized() ? packedPositions.size() / 3 : positions.size() / 3;
+    }
+
+    Vector3 position(size_t v) const
+    {
+        if (!quantized())
         {
-            const aiBone* bone = mesh->mBones[i];
-            boneNames[std::string(bone->mName.C_Str())] = bone;
+            return vec3(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]);
         }
+        const uint16_t* q = &packedPositions[v * 3];
+        return vec3(quantizeMin.x + (float)q[0] * quantizeScale.x, quantizeMin.y + (float)q[1] * quantizeScale.y, quantizeMin.z + (float)q[2] * quantizeScale.z);
+    }
 
-        const aiNode* rootBone = nullptr;
-        std::stack<const aiNode*> nodeStack;
-        nodeStack.push(scene->mRootNode);
-        while (nodeStack.size())
+    // Float xyz positions, whichever form the mesh is stored in.
+    void decodePositions(std::vector<float>& out) const
+    {
+        if (!quantized())
         {
-            const aiNode* node = nodeStack.top();
-            nodeStack.pop();
-            for (uint32_t i = 0; i < node->mNumChildren; ++i)
-            {
-                const aiNode* child = node->mChildren[i];
-                if (boneNames.count(std::string(child->mName.C_Str())) > 0)
-                {
-                    rootBone = child;
-                    goto foundRoot;
-                }
-                nodeStack.push(child);
-            }
+            out = positions;
+            return;
         }
-        assert(rootBone);
-    foundRoot:
-
-        boneHierarchy.push_back(Bone());
-        nodeStack = std::stack<const aiNode*>();
-        nodeStack.push(rootBone);
-        uint8_t boneCounter = 1;
-        while (nodeStack.size())
+        out.resize(vertexCount() * 3);
+        for (size_t v = 0; v < vertexCount(); ++v)
         {
-            const aiNode* node = nodeStack.top();
-            nodeStack.pop();
-            if (boneNames.count(std::string(node->mName.C_Str())) < 1)
-            {
-                continue;
-            }
-            const aiBone* bone = boneNames[std::string(node->mName.C_Str())];
-            Bone b;
-            b.parent = 0;
-            b.offsetMatrix = bone->mOffsetMatrix;
-            boneHierarchy.push_back(b);
-            boneIndexMap[std::string(node->mName.C_Str())] = boneCounter;
-            ++boneCounter;
-            for (uint32_t i = 0; i < node->mNumChildren; ++i)
-            {
-                const aiNode* child = node->mChildren[i];
-                nodeStack.push(child);
-            }
+            Vector3 p = position(v);
+            out[v * 3 + 0] = p.x;
+            out[v * 3 + 1] = p.y;
+            out[v * 3 + 2] = p.z;
         }
+    }
+
+    // Level 0 is the full mesh.
+    size_t lodCount() const
+    {
+        return lods.size() + 1;
+    }
+
+    const IndexBuffer& lodIndices(size_t level) const
+    {
+        return level == 0 ? indices : lods[level - 1].indices;
+    }
+
+    size_t lodVertexCount(size_t level) const
+    {
+        return level == 0 ? vertexCount() : lods[level - 1].vertexCount;
+    }
+
+    float lodError(size_t level) const
+    {
+        return level == 0 ? 0.0F : lods[level - 1].error;
+    }
+};
+
+// DualQuat avoids the volume loss of linear blending but only supports
+// rigid bones; any scale in the skinning palette is dropped.
+enum class SkinningMode {
+    Linear,
+    DualQuat,
+};
 
-        nodeStack = std::stack<const aiNode*>();
-        nodeStack.push(rootBone);
-        while (nodeStack.size())
+// Processing applied to meshes when importing from source.
+struct ModelImportOptions {
+    bool weldVertices = true;
+    // 0 welds exact duplicates only.
+    float weldEpsilon = 0.0F;
+    bool optimizeVertexCache = true;
+    bool optimizeOverdraw = true;
+    bool optimizeVertexFetch = true;
+    // Simplified levels to generate per mesh, each with about lodReduction
+    // of the previous level's triangles, as long as they stay within
+    // lodMaxError of the mesh's size.
+    uint32_t lodLevels = 4;
+    float lodReduction = 0.5F;
+    float lodMaxError = 0.02F;
+    // Store meshes quantized, see Mesh::packedPositions.
+    bool quantizeVertices = false;
+};
+
+// Vertex counts and post-transform cache misses per triangle over all
+// meshes, as imported and after processing, and the LODs generated.
+struct ModelImportStats {
+    float acmrBefore = 0.0F;
+    float acmrAfter = 0.0F;
+    size_t triangles = 0;
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    size_t lods = 0;
+    // Index storage after packing, over every level.
+    size_t indexBytes = 0;
+};
+
+// Everything loaded from a model file. Read-only once loaded and shared by
+// every ModelInstance drawing it.
+struct ModelAsset {
+    const aiScene* scene = nullptr;
+    std::vector<Bone> boneHierarchy;
+    std::unordered_map<std::string, uint8_t> boneIndexMap;
+    std::unordered_map<std::string, AnimAction> actions;
+    std::vector<Mesh> baseMeshes;
+
+    // Importing is the only part of ModelAsset that touches Assimp;
+    // everything it produces is converted to gmath types, see model.cpp.
+    // load aborts on an import error, loadSource returns false instead.
+    void load(const char* path);
+    bool loadSource(const char* path, const ModelImportOptions& options = ModelImportOptions(), ModelImportStats* stats = nullptr);
+    void processNode(aiNode* node);
+    Mesh processMesh(aiMesh* mesh);
+    void processBone(aiMesh* mesh, Mesh& polygon);
+    void processAnimationNode();
+
+    // Baked .arenamesh files (see baked_model.hpp) need no Assimp to load.
+    // loadBaked returns false on a missing, stale or corrupt file. With a
+    // pool, its threads help decompress.
+    bool loadBaked(const char* path, WorkerPool* pool = nullptr);
+    bool loadBakedFromMemory(const uint8_t* data, size_t size, const char* path, WorkerPool* pool = nullptr);
+    bool saveBaked(const char* path, uint64_t sourceHash = 0) const;
+
+    const AnimAction* findAction(const std::string& name) const
+    {
+        auto it = actions.find(name);
+        return it != actions.end() ? &it->second : nullptr;
+    }
+
+    // Heap bytes held, for cache budgeting.
+    size_t memoryBytes() const
+    {
+        size_t bytes = sizeof(*this) + boneHierarchy.capacity() * sizeof(Bone);
+        for (const Mesh& mesh : baseMeshes)
         {
-            const aiNode* node = nodeStack.top();
-            nodeStack.pop();
-            if (boneNames.count(std::string(node->mName.C_Str())) < 1)
-            {
-                continue;
-            }
-            else
+            bytes += sizeof(Mesh) + mesh.positions.capacity() * sizeof(float) + mesh.weights.capacity() * sizeof(VertexWeight) + mesh.indices.data.capacity();
+            bytes += mesh.packedPositions.capacity() * sizeof(uint16_t) + mesh.packedWeights.capacity() * sizeof(PackedVertexWeight);
+            for (const MeshLod& lod : mesh.lods)
             {
-                if (rootBone->mName != node->mName)
-                {
-                    uint8_t parent = boneIndexMap[std::string(node->mParent->mName.C_Str())];
-                    uint8_t current = boneIndexMap[std::string(node->mName.C_Str())];
-                    boneHierarchy[current].parent = parent;
-                }
+                bytes += sizeof(MeshLod) + lod.indices.data.capacity();
             }
-
-            for (uint32_t i = 0; i < node->mNumChildren; ++i)
+        }
+        for (const auto& it : boneIndexMap)
+        {
+            bytes += sizeof(it) + it.first.capacity();
+        }
+        for (const auto& it : actions)
+        {
+            bytes += sizeof(it) + it.first.capacity();
+            for (const AnimKeyFrame& frame : it.second.keyframes)
             {
-                const aiNode* child = node->mChildren[i];
-                nodeStack.push(child);
+                bytes += sizeof(AnimKeyFrame) + (frame.locations.data.capacity() + frame.rotations.data.capacity() + frame.scales.data.capacity()) * sizeof(float);
             }
         }
+        return bytes;
+    }
+};
 
-        for (uint32_t i = 0; i < mesh->mNumBones; ++i)
+// One drawn copy of a ModelAsset: playback, pose and skinned output only.
+// Meshes without weights are not copied, unless quantized; their base
+// positions are used.
+struct ModelInstance {
+    std::shared_ptr<const ModelAsset> asset;
+    Animation animation;
+    SkinningMode skinningMode = SkinningMode::Linear;
+    std::vector<Matrix3x4> boneTable;
+    std::vector<DualQuaternion> dualQuatTable;
+    std::vector<std::vector<float>> animatedPositions;
+    std::vector<std::vector<float>> displayPositions;
+    // LOD drawn for each mesh, 0 being full detail; see selectLod.
+    std::vector<uint32_t> meshLods;
+
+    void setAsset(std::shared_ptr<const ModelAsset> modelAsset)
+    {
+        asset = std::move(modelAsset);
+        animation = Animation();
+        boneTable.assign(asset->boneHierarchy.size(), mat34Identity());
+        dualQuatTable.clear();
+        animatedPositions.assign(asset->baseMeshes.size(), std::vector<float>());
+        displayPositions.assign(asset->baseMeshes.size(), std::vector<float>());
+        meshLods.assign(asset->baseMeshes.size(), 0);
+        for (size_t i = 0; i < asset->baseMeshes.size(); ++i)
         {
-            const aiBone* bone = mesh->mBones[i];
-            uint8_t idx = boneIndexMap[std::string(bone->mName.C_Str())];
-            for (uint32_t j = 0; j < bone->mNumWeights; ++j)
+            const Mesh& mesh = asset->baseMeshes[i];
+            mesh.decodePositions(displayPositions[i]);
+            if (mesh.skinned() || mesh.quantized())
             {
-                aiVertexWeight w = bone->mWeights[j];
-                for (uint32_t k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
-                {
-                    if (w.mWeight > 0.0 && polygon.weights[w.mVertexId].boneIndices[k] == 0)
-                    {
-                        polygon.weights[w.mVertexId].boneIndices[k] = idx;
-                        polygon.weights[w.mVertexId].weights[k] = w.mWeight;
-                        break;
-                    }
-                }
+                animatedPositions[i] = displayPositions[i];
             }
         }
     }
 
-    void processAnimationNode()
+    void setCurrentAction(const std::string& name)
+    {
+        assert(asset);
+        const AnimAction* action = asset->findAction(name);
+        assert(action);
+        animation.setCurrentAction(action);
+    }
+
+    // Picks for each mesh the coarsest LOD whose error, drawn with mtx,
+    // covers at most maxPixelError pixels of a viewportHeight tall view.
+    // Distance is taken to the model's origin. Call before updateAnimation,
+    // which only skins the vertices the chosen LODs use.
+    void selectLod(const Camera& camera, const Matrix4& mtx, float viewportHeight, float maxPixelError = 1.0F)
     {
-        for (uint32_t i = 0; i < scene->mNumAnimations; ++i)
+        Vector3 origin = vec3(mtx.m41, mtx.m42, mtx.m43);
+        float scaleSquared = fmaxf(vec3LengthSquared(vec3(mtx.m11, mtx.m12, mtx.m13)), fmaxf(vec3LengthSquared(vec3(mtx.m21, mtx.m22, mtx.m23)), vec3LengthSquared(vec3(mtx.m31, mtx.m32, mtx.m33))));
+        float scale = gmathSqrt(scaleSquared);
+        for (size_t i = 0; i < asset->baseMeshes.size(); ++i)
         {
-            const aiAnimation* animAction = scene->mAnimations[i];
-            AnimAction action;
-            action.duration = scene->mAnimations[i]->mDuration / 1000.0;
-            for (uint32_t j = 0; j < animAction->mNumChannels; ++j)
+            const Mesh& mesh = asset->baseMeshes[i];
+            uint32_t level = (uint32_t)mesh.lodCount() - 1;
+            while (level > 0 && camera.projectedSize(origin, mesh.lodError(level) * scale, viewportHeight) > maxPixelError)
             {
-                const aiNodeAnim* animChannel = animAction->mChannels[j];
-                if (boneIndexMap.count(std::string(animChannel->mNodeName.C_Str())) == 0)
-                {
-                    continue;
-                }
-                assert(animChannel->mNumPositionKeys == animChannel->mNumRotationKeys && animChannel->mNumPositionKeys == animChannel->mNumScalingKeys);
-                action.keyframes.resize(animChannel->mNumPositionKeys);
-                uint8_t boneID = boneIndexMap[std::string(animChannel->mNodeName.C_Str())];
-                for (uint32_t k = 0; k < animChannel->mNumPositionKeys; ++k)
-                {
-                    aiVectorKey keyPos = animChannel->mPositionKeys[k];
-                    aiQuatKey keyRot = animChannel->mRotationKeys[k];
-                    aiVectorKey keyScale = animChannel->mScalingKeys[k];
-                    action.keyframes[k].keyPerBone.resize(boneHierarchy.size());
-                    action.keyframes[k].keyPerBone[boneID].location = keyPos.mValue;
-                    action.keyframes[k].keyPerBone[boneID].rotation = keyRot.mValue;
-                    action.keyframes[k].keyPerBone[boneID].scale = keyScale.mValue;
-                    action.keyframes[k].timeStamp = keyPos.mTime / 1000.0;
-                }
+                --level;
             }
-            animation.actions[std::string(animAction->mName.C_Str())] = action;
+            meshLods[i] = level;
         }
     }
 
     void updateAnimation(double dt)
     {
-        animation.updateAnimation(dt, boneHierarchy, boneTable);
-        for (size_t i = 0; i < baseMeshes.size(); ++i)
+        const std::vector<Bone>& boneHierarchy = asset->boneHierarchy;
+        if (skinningMode == SkinningMode::DualQuat)
+        {
+            dualQuatTable.resize(boneHierarchy.size(), dqIdentity());
+            animation.updateAnimation(dt, boneHierarchy, boneTable, &dualQuatTable);
+        }
+        else
+        {
+            animation.updateAnimation(dt, boneHierarchy, boneTable);
+        }
+
+        for (size_t i = 0; i < asset->baseMeshes.size(); ++i)
         {
-            const std::vector<float>& pos = baseMeshes[i].positions;
-            const std::vector<VertexWeight>& vertexWeights = baseMeshes[i].weights;
-            std::vector<float>& outPos = animatedMeshes[i].positions;
-            for (size_t idx = 0; idx < vertexWeights.size(); ++idx)
+            const Mesh& mesh = asset->baseMeshes[i];
+            std::vector<float>& outPos = animatedPositions[i];
+            size_t skinCount = mesh.skinned() ? mesh.lodVertexCount(meshLods[i]) : 0;
+            for (size_t idx = 0; idx < skinCount; ++idx)
             {
-                aiVector3D v;
-                v.x = pos[idx * 3 + 0];
-                v.y = pos[idx * 3 + 1];
-                v.z = pos[idx * 3 + 2];
-                aiVector3D totalPosition;
+                // Quantized meshes are decoded here, a vertex at a time.
+                Vector3 v = mesh.position(idx);
+                const uint8_t* boneIndices;
+                float weights[MODEL_BONE_INFLUENCE_MAX];
+                if (mesh.quantized())
+                {
+                    const PackedVertexWeight& packed = mesh.packedWeights[idx];
+                    boneIndices = packed.boneIndices;
+                    for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+                    {
+                        weights[k] = (float)packed.weights[k] * (1.0F / 255.0F);
+                    }
+                }
+                else
+                {
+                    boneIndices = mesh.weights[idx].boneIndices;
+                    memcpy(weights, mesh.weights[idx].weights, sizeof(weights));
+                }
+                if (skinningMode == SkinningMode::DualQuat)
+                {
+                    DualQuaternion dq = dqBlend(dualQuatTable.data(), boneIndices, weights, MODEL_BONE_INFLUENCE_MAX);
+                    Vector3 p = dqTransformPoint(v, dq);
+                    outPos[idx * 3 + 0] = p.x;
+                    outPos[idx * 3 + 1] = p.y;
+                    outPos[idx * 3 + 2] = p.z;
+                    continue;
+                }
+                Vector3 totalPosition = vec3Zero();
                 for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
                 {
-                    //if (vertexWeights[idx].boneIndices[k] == 0) { break; }
-                    //if (!(vertexWeights[idx].weights[k] > 0.0F)) { break; }
-                    aiVector3D localPosition = v;
-                    localPosition *= boneTable[vertexWeights[idx].boneIndices[k]];
-                    localPosition *= vertexWeights[idx].weights[k];
-                    totalPosition += localPosition;
+                    //if (boneIndices[k] == 0) { break; }
+                    //if (!(weights[k] > 0.0F)) { break; }
+                    Vector3 localPosition = mat34TransformPoint(v, boneTable[boneIndices[k]]);
+                    localPosition = vec3Multiply(localPosition, weights[k]);
+                    totalPosition = vec3Add(totalPosition, localPosition);
                 }
                 outPos[idx * 3 + 0] = totalPosition.x;
                 outPos[idx * 3 + 1] = totalPosition.y;
@@ -402,42 +609,28 @@ struct Model {
 
     void updateMesh(const Matrix4& mtx)
     {
-        aiMatrix4x4 m = myMat4ToAssimpMat4(mtx);
-        const std::vector<Mesh>& meshes = animatedMeshes;
-        for (size_t i = 0; i < meshes.size(); ++i)
+        for (size_t i = 0; i < asset->baseMeshes.size(); ++i)
         {
-            const std::vector<float>& pos = meshes[i].positions;
-            std::vector<float>& outPos = displayMeshes[i].positions;
-            for (size_t idx = 0; idx < pos.size(); idx += 3)
-            {
-                aiVector3D v;
-                //Vector4 v;
-                v.x = pos[idx + 0];
-                v.y = pos[idx + 1];
-                v.z = pos[idx + 2];
-                //v.w = 1.0F;
-                v *= m;
-                //v = vec4Transform(v, mtx);
-                outPos[idx + 0] = v.x;
-                outPos[idx + 1] = v.y;
-                outPos[idx + 2] = v.z;
-            }
+            const std::vector<float>& pos = animatedPositions[i].empty() ? asset->baseMeshes[i].positions : animatedPositions[i];
+            std::vector<float>& outPos = displayPositions[i];
+            mat4TransformPoints(pos.data(), outPos.data(), asset->baseMeshes[i].lodVertexCount(meshLods[i]), mtx);
         }
     }
 
+    // Index data goes to GL at its stored width.
     void draw()
     {
-        glBegin(GL_TRIANGLES);
-        for (const Mesh& mesh : displayMeshes)
+        glEnableClientState(GL_VERTEX_ARRAY);
+        for (size_t i = 0; i < asset->baseMeshes.size(); ++i)
         {
-            for (uint32_t idx : mesh.indices)
+            const IndexBuffer& indices = asset->baseMeshes[i].lodIndices(meshLods[i]);
+            if (indices.empty())
             {
-                float x = mesh.positions[3 * idx + 0];
-                float y = mesh.positions[3 * idx + 1];
-                float z = mesh.positions[3 * idx + 2];
-                glVertex3f(x, y, z);
+                continue;
             }
+            glVertexPointer(3, GL_FLOAT, 0, displayPositions[i].data());
+            glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), indices.glType(), indices.data.data());
         }
-        glEnd();
+        glDisableClientState(GL_VERTEX_ARRAY);
     }
 };
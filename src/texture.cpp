@@ -0,0 +1,101 @@
+#include "texture.hpp"
+#include "gmath.hpp"
+#include "stb_image.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+bool textureDecode(const uint8_t* data, size_t size, const char* name, TextureImage& out, bool generateMips)
+{
+    assert(data || size == 0);
+    assert(name);
+
+    out.mips.clear();
+    if (size > INT_MAX)
+    {
+        printf("ERROR::TEXTURE => %s is too large\n", name);
+        return false;
+    }
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load_from_memory(data, (int)size, &width, &height, &channels, 4);
+    if (!pixels)
+    {
+        printf("ERROR::TEXTURE => %s: %s\n", name, stbi_failure_reason());
+        return false;
+    }
+
+    TextureMip base;
+    base.width = (uint32_t)width;
+    base.height = (uint32_t)height;
+    base.data.assign(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+    out.mips.push_back(std::move(base));
+    if (generateMips)
+    {
+        textureGenerateMips(out);
+    }
+    return true;
+}
+
+static void downsamplePixel(const uint8_t* row0, const uint8_t* row1, uint32_t x0, uint32_t x1, uint8_t* out)
+{
+    for (int c = 0; c < 4; ++c)
+    {
+        uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+        out[c] = (uint8_t)((sum + 2) >> 2);
+    }
+}
+
+void textureDownsample(const TextureMip& src, TextureMip& dst)
+{
+    assert(src.data.size() == textureLevelBytes(TextureFormat::RGBA8, src.width, src.height));
+
+    dst.width = std::max(src.width / 2, 1U);
+    dst.height = std::max(src.height / 2, 1U);
+    dst.data.resize((size_t)dst.width * dst.height * 4);
+
+    for (uint32_t y = 0; y < dst.height; ++y)
+    {
+        const uint8_t* row0 = &src.data[(size_t)std::min(y * 2, src.height - 1) * src.width * 4];
+        const uint8_t* row1 = &src.data[(size_t)std::min(y * 2 + 1, src.height - 1) * src.width * 4];
+        uint8_t* out = &dst.data[(size_t)y * dst.width * 4];
+        uint32_t x = 0;
+#if defined(GMATH_SSE4)
+        // Two output pixels from four source pixels of each row: widen to
+        // 16 bits, add the rows, then add each pixel to its right neighbour.
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i round = _mm_set1_epi16(2);
+        for (; x + 2 <= dst.width && (x + 2) * 2 <= src.width; x += 2)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+            __m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+            __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+            __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+            left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+            right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+            __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(left, right), round), 2);
+            _mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, zero));
+        }
+#endif
+        for (; x < dst.width; ++x)
+        {
+            downsamplePixel(row0, row1, std::min(x * 2, src.width - 1), std::min(x * 2 + 1, src.width - 1), out + x * 4);
+        }
+    }
+}
+
+void textureGenerateMips(TextureImage& image)
+{
+    assert(!image.mips.empty() && image.format == TextureFormat::RGBA8);
+
+    image.mips.resize(1);
+    while (image.mips.back().width > 1 || image.mips.back().height > 1)
+    {
+        TextureMip next;
+        textureDownsample(image.mips.back(), next);
+        image.mips.push_back(std::move(next));
+    }
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include "glad.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// glad was generated without the S3TC and BPTC extensions.
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+// RGBA8 is what decoding produces; the block formats come from the bake
+// step (see texture_compress.hpp) and go to GL as they are.
+enum class TextureFormat : uint32_t {
+    RGBA8,
+    BC1,
+    BC3,
+    BC7,
+    Count,
+};
+
+// Bytes per 4x4 block, or 0 for RGBA8.
+inline size_t textureBlockBytes(TextureFormat format)
+{
+    return format == TextureFormat::BC1 ? 8 : format == TextureFormat::RGBA8 ? 0 : 16;
+}
+
+// Bytes of one width x height level; block formats round up to whole
+// blocks.
+inline size_t textureLevelBytes(TextureFormat format, uint32_t width, uint32_t height)
+{
+    if (format == TextureFormat::RGBA8)
+    {
+        return (size_t)width * height * 4;
+    }
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * textureBlockBytes(format);
+}
+
+inline const char* textureFormatName(TextureFormat format)
+{
+    static const char* names[] = {"RGBA8", "BC1", "BC3", "BC7"};
+    return format < TextureFormat::Count ? names[(size_t)format] : "?";
+}
+
+// One level of an image: RGBA8 rows tightly packed, or blocks in row order.
+struct TextureMip {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> data;
+};
+
+// An image and its mip chain, largest first, still in system memory.
+// Nothing here touches GL, so images can be built on any thread.
+struct TextureImage {
+    TextureFormat format = TextureFormat::RGBA8;
+    std::vector<TextureMip> mips;
+
+    size_t bytes() const
+    {
+        size_t total = 0;
+        for (const TextureMip& mip : mips)
+        {
+            total += mip.data.size();
+        }
+        return total;
+    }
+};
+
+// Decodes a PNG, JPG or anything else stb_image reads into RGBA8, then
+// builds the mip chain down to 1x1 unless generateMips is false. name is
+// only used in error messages.
+bool textureDecode(const uint8_t* data, size_t size, const char* name, TextureImage& out, bool generateMips = true);
+
+// Halves src with a 2x2 box filter, clamping at odd edges.
+void textureDownsample(const TextureMip& src, TextureMip& dst);
+
+// Replaces everything after the first level with a full chain.
+void textureGenerateMips(TextureImage& image);
+
+// Which formats the GL context takes, indexed by TextureFormat. S3TC is an
+// extension everywhere and BPTC needs GL 4.2 or ARB_texture_compression_bptc,
+// so the block formats start out unsupported until textureQueryGLSupport
+// finds them. Loads read this on worker threads to decide whether to decode
+// blocks to RGBA8, so the query runs once, right after the context is made
+// current and before any load starts.
+inline bool* textureGLSupport()
+{
+    static bool supported[(size_t)TextureFormat::Count] = {true};
+    return supported;
+}
+
+inline bool textureGLSupports(TextureFormat format)
+{
+    return format < TextureFormat::Count && textureGLSupport()[(size_t)format];
+}
+
+// Checks the compressed formats the context lists, and its extension string
+// for drivers that leave formats off that list.
+inline void textureQueryGLSupport()
+{
+    static const struct {
+        TextureFormat format;
+        GLenum glFormat;
+        const char* extension;
+    } blockFormats[] = {
+        {TextureFormat::BC1, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, "GL_EXT_texture_compression_s3tc"},
+        {TextureFormat::BC3, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, "GL_EXT_texture_compression_s3tc"},
+        {TextureFormat::BC7, GL_COMPRESSED_RGBA_BPTC_UNORM, "GL_ARB_texture_compression_bptc"},
+    };
+
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+    std::vector<GLint> listed((size_t)(count > 0 ? count : 0));
+    if (!listed.empty())
+    {
+        glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, listed.data());
+    }
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    // Core profiles only list extensions through glGetStringi; that error
+    // must not be left for the next upload to pick up.
+    while (glGetError() != GL_NO_ERROR)
+    {
+    }
+
+    for (const auto& block : blockFormats)
+    {
+        bool supported = false;
+        for (GLint listedFormat : listed)
+        {
+            supported = supported || (GLenum)listedFormat == block.glFormat;
+        }
+        if (!supported && extensions)
+        {
+            size_t length = strlen(block.extension);
+            for (const char* at = strstr(extensions, block.extension); at && !supported; at = strstr(at + length, block.extension))
+            {
+                supported = at[length] == ' ' || at[length] == '\0';
+            }
+        }
+        textureGLSupport()[(size_t)block.format] = supported;
+        if (!supported)
+        {
+            printf("Texture: %s is not supported by this GL context, decoding it to RGBA8\n", textureFormatName(block.format));
+        }
+    }
+}
+
+// A GL texture object and the size of what was uploaded to it. Main thread
+// only, like every GL call.
+struct Texture {
+    GLuint id = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipCount = 0;
+    size_t bytes = 0;
+
+    Texture() = default;
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+
+    ~Texture()
+    {
+        if (id)
+        {
+            glDeleteTextures(1, &id);
+        }
+    }
+
+    // False, with the texture left as it was, if the context does not take
+    // the format or GL reports an error. name is only used in error messages.
+    bool upload(const TextureImage& image, const char* name)
+    {
+        assert(!image.mips.empty());
+
+        if (!textureGLSupports(image.format))
+        {
+            printf("ERROR::TEXTURE => %s is %s, which this GL context does not support\n", name, textureFormatName(image.format));
+            return false;
+        }
+        // Errors from earlier calls are not this upload's.
+        while (glGetError() != GL_NO_ERROR)
+        {
+        }
+
+        if (!id)
+        {
+            glGenTextures(1, &id);
+        }
+        glBindTexture(GL_TEXTURE_2D, id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (size_t level = 0; level < image.mips.size(); ++level)
+        {
+            const TextureMip& mip = image.mips[level];
+            if (image.format == TextureFormat::RGBA8)
+            {
+                glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA8, (GLsizei)mip.width, (GLsizei)mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.data.data());
+            }
+            else
+            {
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, glFormat(image.format), (GLsizei)mip.width, (GLsizei)mip.height, 0, (GLsizei)mip.data.size(), mip.data.data());
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.mips.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.mips.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+        {
+            printf("ERROR::TEXTURE => uploading %s (%s, %ux%u) failed with GL error 0x%04X\n", name, textureFormatName(image.format), image.mips[0].width, image.mips[0].height, error);
+            return false;
+        }
+        width = image.mips[0].width;
+        height = image.mips[0].height;
+        mipCount = (uint32_t)image.mips.size();
+        bytes = image.bytes();
+        return true;
+    }
+
+    void bind() const
+    {
+        glBindTexture(GL_TEXTURE_2D, id);
+    }
+
+    static GLenum glFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+        case TextureFormat::BC1:
+            return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case TextureFormat::BC3:
+            return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case TextureFormat::BC7:
+            return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default:
+            return GL_RGBA8;
+        }
+    }
+};
@@ -0,0 +1,762 @@
+#include "texture_compress.hpp"
+#include "gmath.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+// A 4x4 block as floats, channel-major so four pixels of a channel load at
+// once.
+struct EncodeBlock {
+    float c[4][16];
+};
+
+static float clampChannel(float v)
+{
+    return std::min(std::max(v, 0.0F), 255.0F);
+}
+
+// Picks the nearest palette entry for each pixel over the first channels
+// rows and returns the summed squared error. The SSE path measures four
+// pixels at a time in the same order as the scalar one, so both pick the
+// same indices and the same total.
+static float selectIndices(const float (*rows)[16], int channels, const float (*palette)[4], int paletteSize, uint8_t* indices)
+{
+    float distances[16];
+#if defined(GMATH_SSE4)
+    for (int p = 0; p < 16; p += 4)
+    {
+        __m128 best = _mm_set1_ps(FLT_MAX);
+        __m128 bestIndex = _mm_setzero_ps();
+        for (int e = 0; e < paletteSize; ++e)
+        {
+            __m128 d = _mm_setzero_ps();
+            for (int c = 0; c < channels; ++c)
+            {
+                __m128 diff = _mm_sub_ps(_mm_loadu_ps(&rows[c][p]), _mm_set1_ps(palette[e][c]));
+                d = _mm_add_ps(d, _mm_mul_ps(diff, diff));
+            }
+            __m128 closer = _mm_cmplt_ps(d, best);
+            best = _mm_min_ps(d, best);
+            bestIndex = _mm_blendv_ps(bestIndex, _mm_set1_ps((float)e), closer);
+        }
+        int32_t lanes[4];
+        _mm_storeu_ps(&distances[p], best);
+        _mm_storeu_si128((__m128i*)lanes, _mm_cvttps_epi32(bestIndex));
+        for (int i = 0; i < 4; ++i)
+        {
+            indices[p + i] = (uint8_t)lanes[i];
+        }
+    }
+#else
+    for (int p = 0; p < 16; ++p)
+    {
+        float best = FLT_MAX;
+        int bestIndex = 0;
+        for (int e = 0; e < paletteSize; ++e)
+        {
+            float d = 0.0F;
+            for (int c = 0; c < channels; ++c)
+            {
+                float diff = rows[c][p] - palette[e][c];
+                d = d + diff * diff;
+            }
+            if (d < best)
+            {
+                best = d;
+                bestIndex = e;
+            }
+        }
+        distances[p] = best;
+        indices[p] = (uint8_t)bestIndex;
+    }
+#endif
+    float error = 0.0F;
+    for (int p = 0; p < 16; ++p)
+    {
+        error += distances[p];
+    }
+    return error;
+}
+
+// Endpoints spanning the block along its principal axis, e0 at the high
+// end. Falls back to the bounding box for Fast and for flat blocks.
+static void fitAxis(const EncodeBlock& b, int channels, bool principal, float e0[4], float e1[4])
+{
+    float mean[4] = {};
+    for (int c = 0; c < channels; ++c)
+    {
+        e0[c] = b.c[c][0];
+        e1[c] = b.c[c][0];
+        for (int p = 0; p < 16; ++p)
+        {
+            e0[c] = std::max(e0[c], b.c[c][p]);
+            e1[c] = std::min(e1[c], b.c[c][p]);
+            mean[c] += b.c[c][p];
+        }
+        mean[c] *= 1.0F / 16.0F;
+    }
+    if (!principal)
+    {
+        return;
+    }
+
+    float cov[4][4] = {};
+    for (int p = 0; p < 16; ++p)
+    {
+        for (int i = 0; i < channels; ++i)
+        {
+            for (int j = 0; j < channels; ++j)
+            {
+                cov[i][j] += (b.c[i][p] - mean[i]) * (b.c[j][p] - mean[j]);
+            }
+        }
+    }
+    // Power iteration, seeded with the column of the widest channel so it
+    // cannot start orthogonal to the answer.
+    int widest = 0;
+    for (int c = 1; c < channels; ++c)
+    {
+        widest = cov[c][c] > cov[widest][widest] ? c : widest;
+    }
+    float axis[4];
+    for (int c = 0; c < channels; ++c)
+    {
+        axis[c] = cov[c][widest];
+    }
+    for (int iter = 0; iter < 8; ++iter)
+    {
+        float next[4] = {};
+        float largest = 0.0F;
+        for (int i = 0; i < channels; ++i)
+        {
+            for (int j = 0; j < channels; ++j)
+            {
+                next[i] += cov[i][j] * axis[j];
+            }
+            largest = std::max(largest, std::fabs(next[i]));
+        }
+        if (largest == 0.0F)
+        {
+            return;
+        }
+        for (int c = 0; c < channels; ++c)
+        {
+            axis[c] = next[c] / largest;
+        }
+    }
+
+    float lengthSq = 0.0F;
+    for (int c = 0; c < channels; ++c)
+    {
+        lengthSq += axis[c] * axis[c];
+    }
+    float lo = FLT_MAX;
+    float hi = -FLT_MAX;
+    for (int p = 0; p < 16; ++p)
+    {
+        float t = 0.0F;
+        for (int c = 0; c < channels; ++c)
+        {
+            t += (b.c[c][p] - mean[c]) * axis[c];
+        }
+        lo = std::min(lo, t);
+        hi = std::max(hi, t);
+    }
+    for (int c = 0; c < channels; ++c)
+    {
+        e0[c] = clampChannel(mean[c] + axis[c] * hi / lengthSq);
+        e1[c] = clampChannel(mean[c] + axis[c] * lo / lengthSq);
+    }
+}
+
+// Least-squares endpoints for pixels rebuilt as e0 + (e1 - e0) *
+// weights[index]. False if every pixel used the same weight.
+static bool fitLeastSquares(const EncodeBlock& b, int firstChannel, int channels, const uint8_t* indices, const float* weights, float e0[4], float e1[4])
+{
+    float aa = 0.0F;
+    float ab = 0.0F;
+    float bb = 0.0F;
+    float r0[4] = {};
+    float r1[4] = {};
+    for (int p = 0; p < 16; ++p)
+    {
+        float w = weights[indices[p]];
+        aa += (1.0F - w) * (1.0F - w);
+        ab += (1.0F - w) * w;
+        bb += w * w;
+        for (int c = 0; c < channels; ++c)
+        {
+            r0[c] += (1.0F - w) * b.c[firstChannel + c][p];
+            r1[c] += w * b.c[firstChannel + c][p];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6F)
+    {
+        return false;
+    }
+    for (int c = 0; c < channels; ++c)
+    {
+        e0[c] = clampChannel((bb * r0[c] - ab * r1[c]) / det);
+        e1[c] = clampChannel((aa * r1[c] - ab * r0[c]) / det);
+    }
+    return true;
+}
+
+static int refinementPasses(TextureQuality quality)
+{
+    return quality == TextureQuality::Fast ? 0 : quality == TextureQuality::Normal ? 1 : 4;
+}
+
+static uint16_t packRgb565(const float c[4])
+{
+    uint32_t r = (uint32_t)(c[0] * (31.0F / 255.0F) + 0.5F);
+    uint32_t g = (uint32_t)(c[1] * (63.0F / 255.0F) + 0.5F);
+    uint32_t b = (uint32_t)(c[2] * (31.0F / 255.0F) + 0.5F);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRgb565(uint16_t v, float out[4])
+{
+    uint32_t r = v >> 11;
+    uint32_t g = (v >> 5) & 63;
+    uint32_t b = v & 31;
+    out[0] = (float)((r << 3) | (r >> 2));
+    out[1] = (float)((g << 2) | (g >> 4));
+    out[2] = (float)((b << 3) | (b >> 2));
+    out[3] = 0.0F;
+}
+
+// BC1 colour block in four-colour mode (c0 > c1). Equal endpoints would
+// select three-colour mode, where index 3 is transparent; the search never
+// picks past index 0 then since every entry is the same.
+static void encodeColorBlock(const EncodeBlock& b, TextureQuality quality, uint8_t out[8])
+{
+    static const float weights[4] = {0.0F, 1.0F, 1.0F / 3.0F, 2.0F / 3.0F};
+
+    float e0[4];
+    float e1[4];
+    fitAxis(b, 3, quality != TextureQuality::Fast, e0, e1);
+
+    float bestError = FLT_MAX;
+    uint16_t best0 = 0;
+    uint16_t best1 = 0;
+    uint8_t bestIndices[16] = {};
+    for (int pass = 0;; ++pass)
+    {
+        uint16_t c0 = packRgb565(e0);
+        uint16_t c1 = packRgb565(e1);
+        if (c0 < c1)
+        {
+            std::swap(c0, c1);
+        }
+        float palette[4][4];
+        unpackRgb565(c0, palette[0]);
+        unpackRgb565(c1, palette[1]);
+        for (int c = 0; c < 3; ++c)
+        {
+            palette[2][c] = (2.0F * palette[0][c] + palette[1][c]) / 3.0F;
+            palette[3][c] = (palette[0][c] + 2.0F * palette[1][c]) / 3.0F;
+        }
+        uint8_t indices[16];
+        float error = selectIndices(b.c, 3, palette, 4, indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            best0 = c0;
+            best1 = c1;
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+        if (pass == refinementPasses(quality) || error == 0.0F || !fitLeastSquares(b, 0, 3, indices, weights, e0, e1))
+        {
+            break;
+        }
+    }
+
+    uint32_t bits = 0;
+    for (int p = 0; p < 16; ++p)
+    {
+        bits |= (uint32_t)bestIndices[p] << (p * 2);
+    }
+    out[0] = (uint8_t)best0;
+    out[1] = (uint8_t)(best0 >> 8);
+    out[2] = (uint8_t)best1;
+    out[3] = (uint8_t)(best1 >> 8);
+    memcpy(out + 4, &bits, 4);
+}
+
+// BC4 alpha block of BC3 in eight-value mode (a0 > a1).
+static void encodeAlphaBlock(const EncodeBlock& b, TextureQuality quality, uint8_t out[8])
+{
+    static const float weights[8] = {0.0F, 1.0F, 1.0F / 7.0F, 2.0F / 7.0F, 3.0F / 7.0F, 4.0F / 7.0F, 5.0F / 7.0F, 6.0F / 7.0F};
+    const float(*alpha)[16] = &b.c[3];
+
+    float e0[4];
+    float e1[4];
+    e0[0] = *std::max_element(b.c[3], b.c[3] + 16);
+    e1[0] = *std::min_element(b.c[3], b.c[3] + 16);
+
+    float bestError = FLT_MAX;
+    uint32_t best0 = 0;
+    uint32_t best1 = 0;
+    uint8_t bestIndices[16] = {};
+    for (int pass = 0;; ++pass)
+    {
+        uint32_t a0 = (uint32_t)(e0[0] + 0.5F);
+        uint32_t a1 = (uint32_t)(e1[0] + 0.5F);
+        if (a0 < a1)
+        {
+            std::swap(a0, a1);
+        }
+        float palette[8][4];
+        palette[0][0] = (float)a0;
+        palette[1][0] = (float)a1;
+        for (int i = 1; i < 7; ++i)
+        {
+            palette[i + 1][0] = (float)((7 - i) * a0 + i * a1) / 7.0F;
+        }
+        uint8_t indices[16];
+        float error = selectIndices(alpha, 1, palette, 8, indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            best0 = a0;
+            best1 = a1;
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+        if (pass == refinementPasses(quality) || error == 0.0F || !fitLeastSquares(b, 3, 1, indices, weights, e0, e1))
+        {
+            break;
+        }
+    }
+
+    uint64_t bits = 0;
+    for (int p = 0; p < 16; ++p)
+    {
+        bits |= (uint64_t)bestIndices[p] << (p * 3);
+    }
+    out[0] = (uint8_t)best0;
+    out[1] = (uint8_t)best1;
+    for (int i = 0; i < 6; ++i)
+    {
+        out[2 + i] = (uint8_t)(bits >> (i * 8));
+    }
+}
+
+struct BlockBitWriter {
+    uint8_t* out;
+    uint32_t position = 0;
+
+    void put(uint32_t value, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; ++i, ++position)
+        {
+            out[position >> 3] |= (uint8_t)(((value >> i) & 1) << (position & 7));
+        }
+    }
+};
+
+static void bc7Quantize(const float e[4], uint32_t pbit, int q[4])
+{
+    for (int c = 0; c < 4; ++c)
+    {
+        q[c] = std::min(std::max((int)((e[c] - (float)pbit) * 0.5F + 0.5F), 0), 127);
+    }
+}
+
+static float bc7QuantizeError(const float e[4], uint32_t pbit)
+{
+    int q[4];
+    bc7Quantize(e, pbit, q);
+    float error = 0.0F;
+    for (int c = 0; c < 4; ++c)
+    {
+        float d = e[c] - (float)((q[c] << 1) | (int)pbit);
+        error += d * d;
+    }
+    return error;
+}
+
+// BC7 mode 6 only: one subset, RGBA endpoints of 7 bits plus a p-bit each,
+// 4-bit indices. It covers opaque and alpha blocks alike and is the mode
+// most encoders land on for smooth content; multi-subset modes would win
+// on sharp edges at several times the search cost.
+static void encodeBc7Block(const EncodeBlock& b, TextureQuality quality, uint8_t out[16])
+{
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    float fitWeights[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        fitWeights[i] = (float)weights[i] / 64.0F;
+    }
+
+    float e0[4];
+    float e1[4];
+    fitAxis(b, 4, quality != TextureQuality::Fast, e0, e1);
+
+    float bestError = FLT_MAX;
+    int best0[4] = {};
+    int best1[4] = {};
+    uint32_t bestP0 = 0;
+    uint32_t bestP1 = 0;
+    uint8_t bestIndices[16] = {};
+    for (int pass = 0;; ++pass)
+    {
+        // High tries every pairing; otherwise each endpoint keeps the p-bit
+        // that rounds it best.
+        uint32_t pbits[4][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+        int pairings = 4;
+        if (quality != TextureQuality::High)
+        {
+            pbits[0][0] = bc7QuantizeError(e0, 1) < bc7QuantizeError(e0, 0) ? 1 : 0;
+            pbits[0][1] = bc7QuantizeError(e1, 1) < bc7QuantizeError(e1, 0) ? 1 : 0;
+            pairings = 1;
+        }
+
+        float passError = FLT_MAX;
+        uint8_t passIndices[16] = {};
+        for (int pairing = 0; pairing < pairings; ++pairing)
+        {
+            uint32_t p0 = pbits[pairing][0];
+            uint32_t p1 = pbits[pairing][1];
+            int q0[4];
+            int q1[4];
+            bc7Quantize(e0, p0, q0);
+            bc7Quantize(e1, p1, q1);
+            float palette[16][4];
+            for (int i = 0; i < 16; ++i)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    int v0 = (q0[c] << 1) | (int)p0;
+                    int v1 = (q1[c] << 1) | (int)p1;
+                    palette[i][c] = (float)(((64 - weights[i]) * v0 + weights[i] * v1 + 32) >> 6);
+                }
+            }
+            uint8_t indices[16];
+            float error = selectIndices(b.c, 4, palette, 16, indices);
+            if (error < passError)
+            {
+                passError = error;
+                memcpy(passIndices, indices, sizeof(indices));
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                memcpy(best0, q0, sizeof(q0));
+                memcpy(best1, q1, sizeof(q1));
+                bestP0 = p0;
+                bestP1 = p1;
+                memcpy(bestIndices, indices, sizeof(indices));
+            }
+        }
+        if (pass == refinementPasses(quality) || passError == 0.0F || !fitLeastSquares(b, 0, 4, passIndices, fitWeights, e0, e1))
+        {
+            break;
+        }
+    }
+
+    // The first pixel's index drops its top bit, so it must be below 8.
+    if (bestIndices[0] & 8)
+    {
+        std::swap(best0, best1);
+        std::swap(bestP0, bestP1);
+        for (uint8_t& index : bestIndices)
+        {
+            index = (uint8_t)(15 - index);
+        }
+    }
+
+    memset(out, 0, 16);
+    BlockBitWriter w = {out};
+    w.put(1U << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+        w.put((uint32_t)best0[c], 7);
+        w.put((uint32_t)best1[c], 7);
+    }
+    w.put(bestP0, 1);
+    w.put(bestP1, 1);
+    w.put(bestIndices[0], 3);
+    for (int p = 1; p < 16; ++p)
+    {
+        w.put(bestIndices[p], 4);
+    }
+}
+
+bool textureHasAlpha(const TextureImage& image)
+{
+    assert(!image.mips.empty() && image.format == TextureFormat::RGBA8);
+
+    const std::vector<uint8_t>& data = image.mips[0].data;
+    for (size_t i = 3; i < data.size(); i += 4)
+    {
+        if (data[i] != 255)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+TextureFormat textureChooseFormat(const TextureImage& image)
+{
+    return textureHasAlpha(image) ? TextureFormat::BC3 : TextureFormat::BC1;
+}
+
+void textureEncodeBlock(const uint8_t rgba[64], TextureFormat format, TextureQuality quality, uint8_t* out)
+{
+    assert(format != TextureFormat::RGBA8 && format < TextureFormat::Count);
+
+    EncodeBlock b;
+    for (int p = 0; p < 16; ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            b.c[c][p] = (float)rgba[p * 4 + c];
+        }
+    }
+    switch (format)
+    {
+    case TextureFormat::BC1:
+        encodeColorBlock(b, quality, out);
+        break;
+    case TextureFormat::BC3:
+        encodeAlphaBlock(b, quality, out);
+        encodeColorBlock(b, quality, out + 8);
+        break;
+    default:
+        encodeBc7Block(b, quality, out);
+        break;
+    }
+}
+
+void textureCompress(const TextureImage& src, TextureFormat format, TextureQuality quality, TextureImage& out, unsigned threadCount)
+{
+    assert(!src.mips.empty() && src.format == TextureFormat::RGBA8);
+    assert(format != TextureFormat::RGBA8 && format < TextureFormat::Count);
+
+    struct BlockRow {
+        uint32_t mip;
+        uint32_t y;
+    };
+    std::vector<BlockRow> rows;
+    out.format = format;
+    out.mips.resize(src.mips.size());
+    for (size_t level = 0; level < src.mips.size(); ++level)
+    {
+        const TextureMip& mip = src.mips[level];
+        out.mips[level].width = mip.width;
+        out.mips[level].height = mip.height;
+        out.mips[level].data.resize(textureLevelBytes(format, mip.width, mip.height));
+        for (uint32_t y = 0; y < (mip.height + 3) / 4; ++y)
+        {
+            rows.push_back({(uint32_t)level, y});
+        }
+    }
+
+    size_t blockBytes = textureBlockBytes(format);
+    std::atomic<size_t> nextRow(0);
+    auto encodeRows = [&]() {
+        for (size_t i = nextRow++; i < rows.size(); i = nextRow++)
+        {
+            const TextureMip& mip = src.mips[rows[i].mip];
+            uint8_t* dst = out.mips[rows[i].mip].data.data();
+            uint32_t blocksX = (mip.width + 3) / 4;
+            for (uint32_t bx = 0; bx < blocksX; ++bx)
+            {
+                uint8_t rgba[64];
+                for (uint32_t p = 0; p < 16; ++p)
+                {
+                    uint32_t x = std::min(bx * 4 + (p & 3), mip.width - 1);
+                    uint32_t y = std::min(rows[i].y * 4 + (p >> 2), mip.height - 1);
+                    memcpy(rgba + p * 4, &mip.data[((size_t)y * mip.width + x) * 4], 4);
+                }
+                textureEncodeBlock(rgba, format, quality, dst + ((size_t)rows[i].y * blocksX + bx) * blockBytes);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    unsigned extra = (unsigned)std::min<size_t>(std::max(threadCount, 1U), rows.size()) - 1;
+    for (unsigned t = 0; t < extra; ++t)
+    {
+        threads.emplace_back(encodeRows);
+    }
+    encodeRows();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+static void decodeColorBlock(const uint8_t in[8], bool alwaysFourColor, uint8_t out[64])
+{
+    uint16_t c0 = (uint16_t)(in[0] | in[1] << 8);
+    uint16_t c1 = (uint16_t)(in[2] | in[3] << 8);
+    float e0[4];
+    float e1[4];
+    unpackRgb565(c0, e0);
+    unpackRgb565(c1, e1);
+    uint8_t palette[4][4];
+    bool fourColor = alwaysFourColor || c0 > c1;
+    for (int c = 0; c < 3; ++c)
+    {
+        int a = (int)e0[c];
+        int b = (int)e1[c];
+        palette[0][c] = (uint8_t)a;
+        palette[1][c] = (uint8_t)b;
+        palette[2][c] = (uint8_t)(fourColor ? (2 * a + b) / 3 : (a + b) / 2);
+        palette[3][c] = (uint8_t)(fourColor ? (a + 2 * b) / 3 : 0);
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = fourColor ? 255 : 0;
+
+    uint32_t bits = (uint32_t)in[4] | (uint32_t)in[5] << 8 | (uint32_t)in[6] << 16 | (uint32_t)in[7] << 24;
+    for (int p = 0; p < 16; ++p)
+    {
+        memcpy(out + p * 4, palette[(bits >> (p * 2)) & 3], 4);
+    }
+}
+
+// Writes the alpha channel only.
+static void decodeAlphaBlock(const uint8_t in[8], uint8_t out[64])
+{
+    int a0 = in[0];
+    int a1 = in[1];
+    int palette[8] = {a0, a1};
+    for (int i = 1; i < 7; ++i)
+    {
+        if (a0 > a1)
+        {
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        }
+        else
+        {
+            palette[i + 1] = i < 5 ? ((5 - i) * a0 + i * a1) / 5 : i == 5 ? 0 : 255;
+        }
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+        bits |= (uint64_t)in[2 + i] << (i * 8);
+    }
+    for (int p = 0; p < 16; ++p)
+    {
+        out[p * 4 + 3] = (uint8_t)palette[(bits >> (p * 3)) & 7];
+    }
+}
+
+struct BlockBitReader {
+    const uint8_t* in;
+    uint32_t position = 0;
+
+    uint32_t get(uint32_t count)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < count; ++i, ++position)
+        {
+            value |= (uint32_t)((in[position >> 3] >> (position & 7)) & 1) << i;
+        }
+        return value;
+    }
+};
+
+// Mode 6 only, the layout encodeBc7Block writes.
+static bool decodeBc7Block(const uint8_t in[16], uint8_t out[64])
+{
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    BlockBitReader reader = {in};
+    if (reader.get(7) != 1 << 6)
+    {
+        return false;
+    }
+    int e[2][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        e[0][c] = (int)reader.get(7) << 1;
+        e[1][c] = (int)reader.get(7) << 1;
+    }
+    int p0 = (int)reader.get(1);
+    int p1 = (int)reader.get(1);
+    for (int c = 0; c < 4; ++c)
+    {
+        e[0][c] |= p0;
+        e[1][c] |= p1;
+    }
+    for (int p = 0; p < 16; ++p)
+    {
+        // The first index drops its top bit, which is always 0.
+        int w = weights[reader.get(p == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c)
+        {
+            out[p * 4 + c] = (uint8_t)(((64 - w) * e[0][c] + w * e[1][c] + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+bool textureDecodeBlock(const uint8_t* block, TextureFormat format, uint8_t rgba[64])
+{
+    assert(format != TextureFormat::RGBA8 && format < TextureFormat::Count);
+
+    switch (format)
+    {
+    case TextureFormat::BC1:
+        decodeColorBlock(block, false, rgba);
+        return true;
+    case TextureFormat::BC3:
+        decodeColorBlock(block + 8, true, rgba);
+        decodeAlphaBlock(block, rgba);
+        return true;
+    default:
+        return decodeBc7Block(block, rgba);
+    }
+}
+
+bool textureDecompress(const TextureImage& src, const char* name, TextureImage& out)
+{
+    assert(!src.mips.empty() && src.format != TextureFormat::RGBA8 && src.format < TextureFormat::Count);
+
+    size_t blockBytes = textureBlockBytes(src.format);
+    out.format = TextureFormat::RGBA8;
+    out.mips.resize(src.mips.size());
+    for (size_t level = 0; level < src.mips.size(); ++level)
+    {
+        const TextureMip& mip = src.mips[level];
+        TextureMip& dst = out.mips[level];
+        assert(mip.data.size() == textureLevelBytes(src.format, mip.width, mip.height));
+        dst.width = mip.width;
+        dst.height = mip.height;
+        dst.data.resize(textureLevelBytes(TextureFormat::RGBA8, mip.width, mip.height));
+        uint32_t blocksX = (mip.width + 3) / 4;
+        for (uint32_t by = 0; by < (mip.height + 3) / 4; ++by)
+        {
+            for (uint32_t bx = 0; bx < blocksX; ++bx)
+            {
+                uint8_t rgba[64];
+                if (!textureDecodeBlock(&mip.data[((size_t)by * blocksX + bx) * blockBytes], src.format, rgba))
+                {
+                    printf("ERROR::TEXTURE => %s has a %s block this decoder cannot read\n", name, textureFormatName(src.format));
+                    out.mips.clear();
+                    return false;
+                }
+                // Edge blocks carry padding past the level; it is dropped.
+                for (uint32_t p = 0; p < 16; ++p)
+                {
+                    uint32_t x = bx * 4 + (p & 3);
+                    uint32_t y = by * 4 + (p >> 2);
+                    if (x < mip.width && y < mip.height)
+                    {
+                        memcpy(&dst.data[((size_t)y * mip.width + x) * 4], rgba + p * 4, 4);
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include "texture.hpp"
+
+// How hard the block encoders search. Fast takes each block's bounding box
+// as its endpoints; Normal fits them along the principal axis and refines
+// once by least squares; High refines further and, for BC7, tries every
+// p-bit pairing.
+enum class TextureQuality {
+    Fast,
+    Normal,
+    High,
+};
+
+// True if any pixel of the first level has alpha below 255.
+bool textureHasAlpha(const TextureImage& image);
+
+// BC1 for opaque images, BC3 otherwise.
+TextureFormat textureChooseFormat(const TextureImage& image);
+
+// Encodes one 4x4 block of RGBA8 pixels, rows in order, to format.
+// out receives textureBlockBytes(format) bytes.
+void textureEncodeBlock(const uint8_t rgba[64], TextureFormat format, TextureQuality quality, uint8_t* out);
+
+// Encodes every level of an RGBA8 image to a block format. Rows of blocks
+// are spread over threadCount threads; edge blocks of levels that are not a
+// multiple of 4 repeat their last row and column.
+void textureCompress(const TextureImage& src, TextureFormat format, TextureQuality quality, TextureImage& out, unsigned threadCount = 1);
+
+// Decodes one block of format back to 4x4 RGBA8 pixels, rows in order.
+// BC7 is read in mode 6 only, the one mode textureEncodeBlock writes; a
+// block in any other mode returns false.
+bool textureDecodeBlock(const uint8_t* block, TextureFormat format, uint8_t rgba[64]);
+
+// Decodes every level of a block-compressed image to RGBA8, for GL contexts
+// that cannot take its format. name is only used in error messages.
+bool textureDecompress(const TextureImage& src, const char* name, TextureImage& out);
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running submitted jobs in FIFO order. Jobs still
+// queued when the pool is destroyed are run before the threads exit.
+struct WorkerPool {
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    // 0 picks one thread per core, leaving one for the main thread.
+    explicit WorkerPool(unsigned threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(2U, std::thread::hardware_concurrency()) - 1;
+        }
+        for (unsigned i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads)
+        {
+            t.join();
+        }
+    }
+
+    template<typename F>
+    auto submit(F f) -> std::future<decltype(f())>
+    {
+        using Result = decltype(f());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(f));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back([task]() { (*task)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    size_t threadCount() const
+    {
+        return threads.size();
+    }
+
+private:
+    void run()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job();
+        }
+    }
+};
+
+// Runs body(i) for every i in [0, count) on the calling thread, helped by
+// up to one job per pool thread (none if pool is null). The caller works
+// through the range itself instead of waiting for helpers to start, so
+// this is safe from inside a pool job; it returns once every item is done.
+template<typename F>
+void parallelFor(WorkerPool* pool, size_t count, F body)
+{
+    struct Shared {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> finished{0};
+        size_t count = 0;
+        std::function<void(size_t)> body;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto shared = std::make_shared<Shared>();
+    shared->count = count;
+    shared->body = std::move(body);
+    // Helpers that start after the range is used up never touch body, whose
+    // captures may be gone by then.
+    auto work = [](Shared& s) {
+        for (size_t i = s.next++; i < s.count; i = s.next++)
+        {
+            s.body(i);
+            if (++s.finished == s.count)
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.done.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = pool && count > 1 ? std::min(pool->threadCount(), count - 1) : 0;
+    for (size_t i = 0; i < helpers; ++i)
+    {
+        pool->submit([shared, work]() { work(*shared); });
+    }
+    work(*shared);
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&shared]() { return shared->finished == shared->count; });
+}
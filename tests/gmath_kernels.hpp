@@ -0,0 +1,221 @@
+// Deliberately without #pragma once: test_gmath.cpp includes this with the
+// SIMD backend and gmath_scalar.cpp includes it again inside a namespace
+// with GMATH_NO_SIMD, so both run every kernel on the same inputs.
+
+// Kernel name and the floats it produced. Arguments that draw from the
+// generator are sequenced explicitly so both builds see the same inputs.
+typedef std::vector<std::pair<std::string, std::vector<float>>> GmathKernelResults;
+
+struct GmathTestRandom {
+    uint32_t state = 12345;
+
+    // Uniform in [lo, hi).
+    float next(float lo = -1.0F, float hi = 1.0F)
+    {
+        state = state * 1664525U + 1013904223U;
+        return lo + (hi - lo) * (float)(state >> 8) / 16777216.0F;
+    }
+
+    Vector3 vector()
+    {
+        float x = next();
+        float y = next();
+        return vec3(x, y, next());
+    }
+
+    Quaternion rotation()
+    {
+        Quaternion q;
+        q.x = next();
+        q.y = next();
+        q.z = next();
+        q.w = next();
+        return quatNormalize(q);
+    }
+
+    // A scaled, sheared, translated matrix far from singular.
+    Matrix3x4 affine()
+    {
+        Vector3 position = vector();
+        Quaternion q = rotation();
+        float sx = next(0.5F, 2.0F);
+        float sy = next(0.5F, 2.0F);
+        Matrix3x4 m = mat34CreateTransform(position, q, vec3(sx, sy, next(0.5F, 2.0F)));
+        m.m21 += next(-0.2F, 0.2F);
+        m.m32 += next(-0.2F, 0.2F);
+        return m;
+    }
+
+    Matrix4 general()
+    {
+        Matrix4 m = mat34ToMat4(affine());
+        m.m14 = next(-0.2F, 0.2F);
+        m.m24 = next(-0.2F, 0.2F);
+        m.m34 = next(-0.2F, 0.2F);
+        return m;
+    }
+};
+
+template <typename T>
+inline void gmathTestRecord(std::vector<float>& out, const T& value)
+{
+    const float* f = (const float*)&value;
+    out.insert(out.end(), f, f + sizeof(T) / sizeof(float));
+}
+
+inline GmathKernelResults gmathRunKernels()
+{
+    // Not a multiple of 8, so the batched kernels run their tails as well.
+    const size_t count = 37;
+    GmathTestRandom rng;
+    GmathKernelResults results;
+    std::vector<float>* out = nullptr;
+    auto begin = [&](const char* name) {
+        results.push_back({name, {}});
+        out = &results.back().second;
+    };
+
+    begin("vec4Transform");
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector4 v = {rng.next(), rng.next(), rng.next(), rng.next()};
+        gmathTestRecord(*out, vec4Transform(v, rng.general()));
+    }
+
+    begin("mat4Multiply");
+    for (size_t i = 0; i < count; ++i)
+    {
+        Matrix4 a = rng.general();
+        gmathTestRecord(*out, mat4Multiply(a, rng.general()));
+    }
+
+    begin("mat4TransformPoints");
+    std::vector<float> points(count * 3);
+    for (float& f : points)
+    {
+        f = rng.next(-10.0F, 10.0F);
+    }
+    out->resize(points.size());
+    mat4TransformPoints(points.data(), out->data(), count, rng.general());
+
+    begin("mat34Multiply");
+    for (size_t i = 0; i < count; ++i)
+    {
+        Matrix3x4 a = rng.affine();
+        gmathTestRecord(*out, mat34Multiply(a, rng.affine()));
+    }
+
+    begin("mat4Inverse");
+    for (size_t i = 0; i < count; ++i)
+    {
+        gmathTestRecord(*out, mat4Inverse(rng.general()));
+    }
+
+    begin("mat34Inverse");
+    for (size_t i = 0; i < count; ++i)
+    {
+        gmathTestRecord(*out, mat34Inverse(rng.affine()));
+    }
+
+    begin("mat4AffineInverse");
+    for (size_t i = 0; i < count; ++i)
+    {
+        gmathTestRecord(*out, mat4AffineInverse(mat34ToMat4(rng.affine())));
+    }
+
+    begin("mat4InverseTranspose");
+    for (size_t i = 0; i < count; ++i)
+    {
+        gmathTestRecord(*out, mat4InverseTranspose(mat34ToMat4(rng.affine())));
+    }
+
+    begin("mat4RigidInverse");
+    for (size_t i = 0; i < count; ++i)
+    {
+        Vector3 position = rng.vector();
+        gmathTestRecord(*out, mat4RigidInverse(mat34ToMat4(mat34CreateTransform(position, rng.rotation(), vec3One()))));
+    }
+
+    begin("quatOps");
+    for (size_t i = 0; i < count; ++i)
+    {
+        Quaternion a = rng.rotation();
+        Quaternion b = rng.rotation();
+        gmathTestRecord(*out, quatAdd(a, b));
+        gmathTestRecord(*out, quatSubtraction(a, b));
+        gmathTestRecord(*out, quatMultiply(a, b));
+        gmathTestRecord(*out, quatMultiply(a, rng.next()));
+    }
+
+    // Each blend mixes entries from both hemispheres of the first one.
+    begin("dqBlend");
+    std::vector<DualQuaternion> palette(8);
+    for (size_t i = 0; i < palette.size(); ++i)
+    {
+        Vector3 position = rng.vector();
+        palette[i] = dqCreateFromMat34(mat34CreateTransform(position, rng.rotation(), vec3One()));
+        if (i % 3 == 0)
+        {
+            palette[i].real = quatNegate(palette[i].real);
+            palette[i].dual = quatNegate(palette[i].dual);
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint8_t indices[4];
+        float weights[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            indices[k] = (uint8_t)((i + k * 3) % palette.size());
+            weights[k] = rng.next(0.0F, 1.0F);
+        }
+        gmathTestRecord(*out, dqBlend(palette.data(), indices, weights, 1 + (int)(i % 4)));
+    }
+
+    Vector3SoA a, b, c;
+    QuaternionSoA qa, qb, qc;
+    a.resize(count);
+    b.resize(count);
+    qa.resize(count);
+    qb.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        a.set(i, rng.vector());
+        b.set(i, rng.vector());
+        qa.set(i, rng.rotation());
+        qb.set(i, rng.rotation());
+    }
+
+    begin("vec3AddN");
+    vec3AddN(a, b, c);
+    *out = c.data;
+    begin("vec3ScaleN");
+    vec3ScaleN(a, 1.7F, c);
+    *out = c.data;
+    begin("vec3LerpN");
+    vec3LerpN(a, b, 0.3F, c);
+    *out = c.data;
+    begin("vec3DotN");
+    out->resize(count);
+    vec3DotN(a, b, out->data());
+    begin("vec3CrossN");
+    vec3CrossN(a, b, c);
+    *out = c.data;
+    begin("vec3NormalizeN");
+    vec3NormalizeN(a, c);
+    *out = c.data;
+    begin("quatRotateN");
+    quatRotateN(a, qa, c);
+    *out = c.data;
+    begin("quatNlerpN");
+    quatNlerpN(qa, qb, 0.6F, qc);
+    *out = qc.data;
+    begin("mat34ComposeN");
+    std::vector<Matrix3x4> composed(count);
+    mat34ComposeN(a, qa, b, composed.data());
+    for (const Matrix3x4& m : composed)
+    {
+        gmathTestRecord(*out, m);
+    }
+    return results;
+}
@@ -0,0 +1,24 @@
+// gmath.hpp and gmath_soa.hpp again with GMATH_NO_SIMD, inside a namespace so
+// their scalar fallbacks do not clash with the SIMD build of the same names.
+// The standard headers come first so they stay outside the namespace.
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define GMATH_NO_SIMD 1
+
+namespace gmath_scalar {
+#include "gmath.hpp"
+#include "gmath_soa.hpp"
+#include "gmath_kernels.hpp"
+
+GmathKernelResults gmathRunScalarKernels()
+{
+    return gmathRunKernels();
+}
+}
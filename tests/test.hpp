@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A minimal harness: TEST(name) registers a function with arena_tests and
+// CHECK records a failure without stopping the test.
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+std::vector<TestCase>& testRegistry();
+extern int testFailures;
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*run)())
+    {
+        testRegistry().push_back({name, run});
+    }
+};
+
+#define TEST(name)                                             \
+    static void name();                                        \
+    static TestRegistrar name##Registrar(#name, name);         \
+    static void name()
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);         \
+            ++testFailures;                                                  \
+        }                                                                    \
+    } while (0)
+
+// Scratch file for tests that go through the file system.
+std::string testTempPath(const char* name);
+
+std::vector<uint8_t> testReadFile(const std::string& path);
@@ -0,0 +1,421 @@
+#include "test.hpp"
+#include "baked_model.hpp"
+#include "lz4_block.hpp"
+#include "mesh_optimize.hpp"
+#include "worker_pool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <random>
+
+// A skinned, animated asset: a grid big enough to span several chunks with
+// a LOD chain, a small quantized mesh, three bones and two actions.
+static ModelAsset bakedTestAsset(uint32_t gridSize = 160)
+{
+    ModelAsset asset;
+    for (int m = 0; m < 2; ++m)
+    {
+        uint32_t n = m == 0 ? gridSize : 4;
+        Mesh mesh;
+        for (uint32_t z = 0; z <= n; ++z)
+        {
+            for (uint32_t x = 0; x <= n; ++x)
+            {
+                mesh.positions.insert(mesh.positions.end(), {(float)x, (float)((x * z) % 7) * 0.01F, (float)z});
+                VertexWeight weight;
+                weight.boneIndices[0] = (uint8_t)(x % 3);
+                weight.weights[0] = 1.0F;
+                mesh.weights.push_back(weight);
+            }
+        }
+        std::vector<uint32_t> indices;
+        for (uint32_t z = 0; z < n; ++z)
+        {
+            for (uint32_t x = 0; x < n; ++x)
+            {
+                uint32_t v = z * (n + 1) + x;
+                indices.insert(indices.end(), {v, v + n + 1, v + 1, v + 1, v + n + 1, v + n + 2});
+            }
+        }
+        mesh.indices.assign(indices, mesh.vertexCount());
+        if (m == 0)
+        {
+            meshBuildLods(mesh, 3);
+        }
+        else
+        {
+            meshQuantize(mesh);
+        }
+        asset.baseMeshes.push_back(std::move(mesh));
+    }
+
+    asset.boneHierarchy.resize(3);
+    for (uint8_t b = 0; b < 3; ++b)
+    {
+        asset.boneHierarchy[b].parent = b == 0 ? 0 : b - 1;
+        asset.boneHierarchy[b].offsetMatrix = mat34CreateTransform(vec3(b, 0.0F, 0.0F), quatIdentity(), vec3One());
+    }
+    asset.boneIndexMap = {{"root", 0}, {"arm", 1}, {"hand", 2}};
+    const char* names[] = {"run1", "run2"};
+    for (int a = 0; a < 2; ++a)
+    {
+        AnimAction action;
+        action.duration = 1.5 + a;
+        for (int k = 0; k < 40; ++k)
+        {
+            AnimKeyFrame frame;
+            frame.timeStamp = k * 0.04;
+            frame.locations.assign(3, vec3((float)k, (float)a, 0.0F));
+            frame.rotations.assign(3, quatIdentity());
+            frame.scales.assign(3, vec3One());
+            action.keyframes.push_back(frame);
+        }
+        asset.actions[names[a]] = action;
+    }
+    return asset;
+}
+
+template<typename T>
+static bool bakedTestSameArray(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+static bool bakedTestSame(const ModelAsset& a, const ModelAsset& b)
+{
+    if (a.baseMeshes.size() != b.baseMeshes.size() || a.boneHierarchy.size() != b.boneHierarchy.size() || a.boneIndexMap != b.boneIndexMap ||
+        a.actions.size() != b.actions.size())
+    {
+        return false;
+    }
+    for (size_t m = 0; m < a.baseMeshes.size(); ++m)
+    {
+        const Mesh& x = a.baseMeshes[m];
+        const Mesh& y = b.baseMeshes[m];
+        if (x.positions != y.positions || x.packedPositions != y.packedPositions || x.indices.data != y.indices.data || x.indices.stride != y.indices.stride ||
+            !bakedTestSameArray(x.weights, y.weights) || !bakedTestSameArray(x.packedWeights, y.packedWeights) || x.lods.size() != y.lods.size())
+        {
+            return false;
+        }
+        for (size_t l = 0; l < x.lods.size(); ++l)
+        {
+            if (x.lods[l].indices.data != y.lods[l].indices.data || x.lods[l].vertexCount != y.lods[l].vertexCount || x.lods[l].error != y.lods[l].error)
+            {
+                return false;
+            }
+        }
+    }
+    for (size_t i = 0; i < a.boneHierarchy.size(); ++i)
+    {
+        if (a.boneHierarchy[i].parent != b.boneHierarchy[i].parent || memcmp(&a.boneHierarchy[i].offsetMatrix, &b.boneHierarchy[i].offsetMatrix, sizeof(Matrix3x4)) != 0)
+        {
+            return false;
+        }
+    }
+    for (const auto& it : a.actions)
+    {
+        auto other = b.actions.find(it.first);
+        if (other == b.actions.end() || other->second.duration != it.second.duration || other->second.keyframes.size() != it.second.keyframes.size())
+        {
+            return false;
+        }
+        for (size_t k = 0; k < it.second.keyframes.size(); ++k)
+        {
+            const AnimKeyFrame& p = it.second.keyframes[k];
+            const AnimKeyFrame& q = other->second.keyframes[k];
+            if (p.timeStamp != q.timeStamp || p.locations.data != q.locations.data || p.rotations.data != q.rotations.data || p.scales.data != q.scales.data ||
+                p.locations.size() != q.locations.size())
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static std::vector<uint8_t> bakedTestSave(const ModelAsset& asset, const char* name)
+{
+    std::string path = testTempPath(name);
+    CHECK(asset.saveBaked(path.c_str(), 42));
+    return testReadFile(path);
+}
+
+static bool bakedTestLoad(const std::vector<uint8_t>& file, WorkerPool* pool = nullptr)
+{
+    ModelAsset asset;
+    bool ok = asset.loadBakedFromMemory(file.data(), file.size(), "test", pool);
+    // A rejected file leaves nothing behind.
+    CHECK(ok || (asset.baseMeshes.empty() && asset.boneHierarchy.empty() && asset.actions.empty()));
+    return ok;
+}
+
+// The decompressed image of a baked file, so tests can edit what the
+// loader parses.
+struct BakedTestImage {
+    ArenaMeshHeader header;
+    std::vector<uint8_t> bytes;
+
+    ArenaMeshSection* sections()
+    {
+        return (ArenaMeshSection*)(bytes.data() + bytes.size() - header.sectionCount * sizeof(ArenaMeshSection));
+    }
+};
+
+static BakedTestImage bakedTestUnpack(const std::vector<uint8_t>& file)
+{
+    BakedTestImage image;
+    memcpy(&image.header, file.data(), sizeof(image.header));
+    std::vector<ArenaMeshChunk> chunks(image.header.chunkCount);
+    memcpy(chunks.data(), file.data() + sizeof(image.header), chunks.size() * sizeof(ArenaMeshChunk));
+    image.bytes.resize(image.header.imageSize);
+    for (const ArenaMeshChunk& c : chunks)
+    {
+        if (c.flags & ARENA_MESH_CHUNK_LZ4)
+        {
+            CHECK(lz4Decompress(file.data() + c.fileOffset, c.storedSize, image.bytes.data() + c.imageOffset, c.imageSize));
+        }
+        else
+        {
+            memcpy(image.bytes.data() + c.imageOffset, file.data() + c.fileOffset, c.imageSize);
+        }
+    }
+    return image;
+}
+
+// Writes an image back with every chunk stored raw.
+static std::vector<uint8_t> bakedTestPack(const BakedTestImage& image)
+{
+    std::vector<ArenaMeshChunk> chunks;
+    for (uint64_t offset = 0; offset < image.bytes.size(); offset += ARENA_MESH_CHUNK_SIZE)
+    {
+        uint32_t size = (uint32_t)std::min<uint64_t>(ARENA_MESH_CHUNK_SIZE, image.bytes.size() - offset);
+        chunks.push_back({offset, 0, size, size, 0, 0});
+    }
+    ArenaMeshHeader header = image.header;
+    header.imageSize = image.bytes.size();
+    header.chunkCount = (uint32_t)chunks.size();
+    header.fileSize = sizeof(header) + chunks.size() * sizeof(ArenaMeshChunk) + image.bytes.size();
+    std::vector<uint8_t> file(sizeof(header) + chunks.size() * sizeof(ArenaMeshChunk));
+    for (ArenaMeshChunk& c : chunks)
+    {
+        c.fileOffset = file.size() + c.imageOffset;
+    }
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), chunks.data(), chunks.size() * sizeof(ArenaMeshChunk));
+    file.insert(file.end(), image.bytes.begin(), image.bytes.end());
+    return file;
+}
+
+static ArenaMeshSection* bakedTestFindSection(BakedTestImage& image, uint32_t type)
+{
+    for (uint32_t i = 0; i < image.header.sectionCount; ++i)
+    {
+        if (image.sections()[i].type == type)
+        {
+            return &image.sections()[i];
+        }
+    }
+    return nullptr;
+}
+
+TEST(bakedModelRoundTrip)
+{
+    ModelAsset asset = bakedTestAsset();
+    std::vector<uint8_t> file = bakedTestSave(asset, "round_trip.arenamesh");
+    ArenaMeshHeader header;
+    CHECK(bakedReadHeader(testTempPath("round_trip.arenamesh").c_str(), header));
+    CHECK(header.chunkCount > 2);
+    CHECK(header.fileSize < header.imageSize);
+    CHECK(bakedContentHash(file.data(), file.size()) == 42);
+
+    ModelAsset serial;
+    CHECK(serial.loadBaked(testTempPath("round_trip.arenamesh").c_str()));
+    CHECK(bakedTestSame(asset, serial));
+    WorkerPool pool(3);
+    ModelAsset parallel;
+    CHECK(parallel.loadBakedFromMemory(file.data(), file.size(), "test", &pool));
+    CHECK(bakedTestSame(asset, parallel));
+
+    // Repacking with raw chunks gives the same asset.
+    CHECK(bakedTestLoad(bakedTestPack(bakedTestUnpack(file)), &pool));
+}
+
+TEST(bakedModelIsReproducible)
+{
+    ModelAsset first = bakedTestAsset(8);
+    ModelAsset second = bakedTestAsset(8);
+    // Other map insertion order, and junk in the padding of every Bone.
+    second.boneIndexMap.clear();
+    second.boneIndexMap = {{"hand", 2}, {"arm", 1}, {"root", 0}};
+    second.actions.clear();
+    second.actions["run2"] = first.actions["run2"];
+    second.actions["run1"] = first.actions["run1"];
+    for (Bone& bone : second.boneHierarchy)
+    {
+        Bone copy = bone;
+        memset((void*)&bone, 0xAB, sizeof(bone));
+        new (&bone) Bone(copy);
+    }
+    CHECK(bakedTestSave(first, "first.arenamesh") == bakedTestSave(second, "second.arenamesh"));
+}
+
+TEST(bakedModelRejectsBadHeaders)
+{
+    std::vector<uint8_t> file = bakedTestSave(bakedTestAsset(8), "headers.arenamesh");
+    CHECK(bakedTestLoad(file));
+
+    std::vector<uint8_t> bad(file.begin(), file.end() - 1);
+    CHECK(!bakedTestLoad(bad));
+    bad.assign(file.begin(), file.begin() + 20);
+    CHECK(!bakedTestLoad(bad));
+
+    bad = file;
+    bad[0] = 'X';
+    CHECK(!bakedTestLoad(bad));
+
+    ArenaMeshHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    bad = file;
+    header.version += 1;
+    memcpy(bad.data(), &header, sizeof(header));
+    CHECK(!bakedTestLoad(bad));
+
+    memcpy(&header, file.data(), sizeof(header));
+    bad = file;
+    header.sectionCount = 1000000;
+    memcpy(bad.data(), &header, sizeof(header));
+    CHECK(!bakedTestLoad(bad));
+}
+
+TEST(bakedModelRejectsBadChunks)
+{
+    std::vector<uint8_t> file = bakedTestSave(bakedTestAsset(), "chunks.arenamesh");
+    ArenaMeshChunk chunk;
+    size_t first = sizeof(ArenaMeshHeader);
+    size_t second = first + sizeof(ArenaMeshChunk);
+    memcpy(&chunk, file.data() + second, sizeof(chunk));
+    CHECK(chunk.flags & ARENA_MESH_CHUNK_LZ4);
+
+    // Gaps, oversized chunks, payloads past the end and truncated LZ4.
+    std::vector<uint8_t> bad = file;
+    ArenaMeshChunk edit = chunk;
+    edit.imageOffset += 1;
+    memcpy(bad.data() + second, &edit, sizeof(edit));
+    CHECK(!bakedTestLoad(bad));
+
+    bad = file;
+    edit = chunk;
+    edit.imageSize = ARENA_MESH_CHUNK_SIZE + 1;
+    memcpy(bad.data() + second, &edit, sizeof(edit));
+    CHECK(!bakedTestLoad(bad));
+
+    bad = file;
+    edit = chunk;
+    edit.fileOffset = file.size() - 4;
+    memcpy(bad.data() + second, &edit, sizeof(edit));
+    CHECK(!bakedTestLoad(bad));
+
+    bad = file;
+    edit = chunk;
+    edit.storedSize /= 2;
+    memcpy(bad.data() + second, &edit, sizeof(edit));
+    CHECK(!bakedTestLoad(bad));
+
+    // A raw chunk must store exactly its image size.
+    bad = file;
+    edit = chunk;
+    edit.flags = 0;
+    memcpy(bad.data() + second, &edit, sizeof(edit));
+    CHECK(!bakedTestLoad(bad));
+
+    bad = file;
+    memcpy(&edit, file.data() + first, sizeof(edit));
+    edit.imageOffset = 8;
+    memcpy(bad.data() + first, &edit, sizeof(edit));
+    CHECK(!bakedTestLoad(bad));
+}
+
+// Repeated sections used to free arrays that were still waiting to be
+// decompressed into.
+TEST(bakedModelRejectsDuplicateSections)
+{
+    std::vector<uint8_t> file = bakedTestSave(bakedTestAsset(), "sections.arenamesh");
+    WorkerPool pool(2);
+    const uint32_t types[] = {ARENA_MESH_SECTION_BONES, ARENA_MESH_SECTION_BONE_NAMES};
+    for (uint32_t type : types)
+    {
+        BakedTestImage image = bakedTestUnpack(file);
+        ArenaMeshSection section = *bakedTestFindSection(image, type);
+        image.bytes.insert(image.bytes.end(), (const uint8_t*)&section, (const uint8_t*)&section + sizeof(section));
+        image.header.sectionCount += 1;
+        std::vector<uint8_t> bad = bakedTestPack(image);
+        CHECK(!bakedTestLoad(bad));
+        CHECK(!bakedTestLoad(bad, &pool));
+    }
+
+    // Two actions under one name.
+    BakedTestImage image = bakedTestUnpack(file);
+    const char run2[] = "run2";
+    uint8_t* name = std::search(image.bytes.data(), image.bytes.data() + image.bytes.size(), run2, run2 + 4);
+    CHECK(name != image.bytes.data() + image.bytes.size());
+    name[3] = '1';
+    std::vector<uint8_t> bad = bakedTestPack(image);
+    CHECK(!bakedTestLoad(bad));
+    CHECK(!bakedTestLoad(bad, &pool));
+}
+
+TEST(bakedModelRejectsBadContent)
+{
+    // Indices past the vertices.
+    ModelAsset asset = bakedTestAsset(8);
+    std::vector<uint32_t> indices = asset.baseMeshes[0].indices.unpack();
+    indices[5] = (uint32_t)asset.baseMeshes[0].vertexCount();
+    asset.baseMeshes[0].indices.assign(indices, asset.baseMeshes[0].vertexCount() + 1);
+    CHECK(!bakedTestLoad(bakedTestSave(asset, "content.arenamesh")));
+
+    // A LOD index past its own vertex count.
+    asset = bakedTestAsset(8);
+    CHECK(!asset.baseMeshes[0].lods.empty());
+    MeshLod& lod = asset.baseMeshes[0].lods[0];
+    indices = lod.indices.unpack();
+    indices[0] = lod.vertexCount;
+    lod.indices.assign(indices, lod.vertexCount + 1);
+    CHECK(!bakedTestLoad(bakedTestSave(asset, "content.arenamesh")));
+
+    // Bone parents and skin weights naming bones that do not exist.
+    asset = bakedTestAsset(8);
+    asset.boneHierarchy[1].parent = 3;
+    CHECK(!bakedTestLoad(bakedTestSave(asset, "content.arenamesh")));
+    asset = bakedTestAsset(8);
+    asset.baseMeshes[0].weights[4].boneIndices[2] = 3;
+    CHECK(!bakedTestLoad(bakedTestSave(asset, "content.arenamesh")));
+
+    // Keyframes holding fewer keys than there are bones.
+    asset = bakedTestAsset(8);
+    asset.boneHierarchy.push_back(asset.boneHierarchy[0]);
+    CHECK(!bakedTestLoad(bakedTestSave(asset, "content.arenamesh")));
+
+    // A section reaching past the image.
+    BakedTestImage image = bakedTestUnpack(bakedTestSave(bakedTestAsset(8), "content.arenamesh"));
+    bakedTestFindSection(image, ARENA_MESH_SECTION_BONES)->size = image.bytes.size();
+    CHECK(!bakedTestLoad(bakedTestPack(image)));
+}
+
+TEST(bakedModelSurvivesCorruption)
+{
+    std::vector<uint8_t> file = bakedTestSave(bakedTestAsset(8), "fuzz.arenamesh");
+    std::vector<uint8_t> raw = bakedTestPack(bakedTestUnpack(file));
+    WorkerPool pool(2);
+    std::mt19937 rng(1);
+    for (int i = 0; i < 1000; ++i)
+    {
+        std::vector<uint8_t> bad = i % 2 ? file : raw;
+        for (int k = 0; k < 4; ++k)
+        {
+            bad[rng() % bad.size()] = (uint8_t)rng();
+        }
+        // Only has to stay in bounds, which the sanitizer builds check.
+        ModelAsset asset;
+        asset.loadBakedFromMemory(bad.data(), bad.size(), "fuzz", i % 3 ? &pool : nullptr);
+    }
+}
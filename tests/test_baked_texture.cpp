@@ -0,0 +1,98 @@
+#include "test.hpp"
+#include "baked_texture.hpp"
+#include "texture_compress.hpp"
+#include <cstring>
+
+// A BC1 texture with three levels, 12x8 down to 3x2.
+static TextureImage bakedTestTexture()
+{
+    TextureImage rgba;
+    for (uint32_t level = 0; level < 3; ++level)
+    {
+        TextureMip mip;
+        mip.width = 12 >> level;
+        mip.height = 8 >> level;
+        for (uint32_t i = 0; i < mip.width * mip.height; ++i)
+        {
+            mip.data.insert(mip.data.end(), {(uint8_t)(i * 7), (uint8_t)(level * 50), (uint8_t)(255 - i), 255});
+        }
+        rgba.mips.push_back(mip);
+    }
+    TextureImage image;
+    textureCompress(rgba, TextureFormat::BC1, TextureQuality::Fast, image);
+    return image;
+}
+
+static bool bakedTestLoadTexture(const std::vector<uint8_t>& file)
+{
+    TextureImage image;
+    bool ok = textureLoadBakedFromMemory(file.data(), file.size(), "test", image);
+    CHECK(ok || image.mips.empty());
+    return ok;
+}
+
+TEST(bakedTextureRoundTrip)
+{
+    TextureImage image = bakedTestTexture();
+    std::string path = testTempPath("round_trip.arenatex");
+    CHECK(textureSaveBaked(path.c_str(), image, 7));
+    TextureImage loaded;
+    CHECK(textureLoadBaked(path.c_str(), loaded));
+    CHECK(loaded.format == TextureFormat::BC1);
+    CHECK(loaded.mips.size() == image.mips.size());
+    for (size_t level = 0; level < image.mips.size() && level < loaded.mips.size(); ++level)
+    {
+        CHECK(loaded.mips[level].width == image.mips[level].width);
+        CHECK(loaded.mips[level].height == image.mips[level].height);
+        CHECK(loaded.mips[level].data == image.mips[level].data);
+    }
+    std::vector<uint8_t> file = testReadFile(path);
+    CHECK(textureBakedContentHash(file.data(), file.size()) == 7);
+    ArenaTexHeader header;
+    CHECK(textureReadBakedHeader(path.c_str(), header));
+}
+
+TEST(bakedTextureRejectsBadFiles)
+{
+    std::string path = testTempPath("bad.arenatex");
+    CHECK(textureSaveBaked(path.c_str(), bakedTestTexture(), 7));
+    std::vector<uint8_t> file = testReadFile(path);
+    CHECK(bakedTestLoadTexture(file));
+
+    std::vector<uint8_t> bad(file.begin(), file.end() - 1);
+    CHECK(!bakedTestLoadTexture(bad));
+    bad.assign(file.begin(), file.begin() + 16);
+    CHECK(!bakedTestLoadTexture(bad));
+
+    // Header fields.
+    auto withHeader = [&file](void (*edit)(ArenaTexHeader&)) {
+        ArenaTexHeader header;
+        memcpy(&header, file.data(), sizeof(header));
+        edit(header);
+        std::vector<uint8_t> out = file;
+        memcpy(out.data(), &header, sizeof(header));
+        return out;
+    };
+    CHECK(!bakedTestLoadTexture(withHeader([](ArenaTexHeader& h) { h.magic[0] = 'X'; })));
+    CHECK(!bakedTestLoadTexture(withHeader([](ArenaTexHeader& h) { h.version += 1; })));
+    CHECK(!bakedTestLoadTexture(withHeader([](ArenaTexHeader& h) { h.format = (uint32_t)TextureFormat::Count; })));
+    CHECK(!bakedTestLoadTexture(withHeader([](ArenaTexHeader& h) { h.mipCount = 0; })));
+    CHECK(!bakedTestLoadTexture(withHeader([](ArenaTexHeader& h) { h.mipCount = ARENA_TEX_MAX_MIPS + 1; })));
+    CHECK(!bakedTestLoadTexture(withHeader([](ArenaTexHeader& h) { h.width += 4; })));
+    CHECK(!bakedTestLoadTexture(withHeader([](ArenaTexHeader& h) { h.format = (uint32_t)TextureFormat::BC7; })));
+
+    // Mip table entries.
+    auto withMip = [&file](size_t level, void (*edit)(ArenaTexMip&)) {
+        ArenaTexMip mip;
+        size_t at = sizeof(ArenaTexHeader) + level * sizeof(ArenaTexMip);
+        memcpy(&mip, file.data() + at, sizeof(mip));
+        edit(mip);
+        std::vector<uint8_t> out = file;
+        memcpy(out.data() + at, &mip, sizeof(mip));
+        return out;
+    };
+    CHECK(!bakedTestLoadTexture(withMip(1, [](ArenaTexMip& m) { m.width += 1; })));
+    CHECK(!bakedTestLoadTexture(withMip(2, [](ArenaTexMip& m) { m.size -= 8; })));
+    CHECK(!bakedTestLoadTexture(withMip(0, [](ArenaTexMip& m) { m.offset = 1 << 20; })));
+    CHECK(!bakedTestLoadTexture(withMip(2, [](ArenaTexMip& m) { m.offset = ~0ULL - 4; })));
+}
@@ -0,0 +1,61 @@
+#include "test.hpp"
+#include "gmath.hpp"
+#include "gmath_soa.hpp"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include "gmath_kernels.hpp"
+
+namespace gmath_scalar {
+GmathKernelResults gmathRunScalarKernels();
+}
+
+// Every SIMD kernel must give the same bits as its scalar fallback, which
+// the constexpr tests cannot see since they only run the scalar path.
+TEST(gmathSimdMatchesScalar)
+{
+    GmathKernelResults simd = gmathRunKernels();
+    GmathKernelResults scalar = gmath_scalar::gmathRunScalarKernels();
+    CHECK(simd.size() == scalar.size());
+    for (size_t k = 0; k < simd.size() && k < scalar.size(); ++k)
+    {
+        const std::vector<float>& a = simd[k].second;
+        const std::vector<float>& b = scalar[k].second;
+        bool same = !a.empty() && a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(float)) == 0;
+        if (!same)
+        {
+            printf("%s differs from its scalar path\n", simd[k].first.c_str());
+        }
+        CHECK(same);
+    }
+}
+
+static float gmathTestIdentityError(const Matrix4& m)
+{
+    Matrix4 identity = mat4Identity();
+    const float* a = &m.m11;
+    const float* b = &identity.m11;
+    float error = 0.0F;
+    for (int i = 0; i < 16; ++i)
+    {
+        error = std::max(error, gmathAbs(a[i] - b[i]));
+    }
+    return error;
+}
+
+TEST(gmathInverses)
+{
+    GmathTestRandom rng;
+    for (int i = 0; i < 100; ++i)
+    {
+        Matrix4 general = rng.general();
+        Matrix4 affine = mat34ToMat4(rng.affine());
+        Vector3 position = rng.vector();
+        Matrix4 rigid = mat34ToMat4(mat34CreateTransform(position, rng.rotation(), vec3One()));
+        CHECK(gmathTestIdentityError(mat4Multiply(general, mat4Inverse(general))) < 1e-4F);
+        CHECK(gmathTestIdentityError(mat4Multiply(affine, mat4AffineInverse(affine))) < 1e-4F);
+        CHECK(gmathTestIdentityError(mat4Multiply(affine, mat34ToMat4(mat34Inverse(mat4ToMat34(affine))))) < 1e-4F);
+        CHECK(gmathTestIdentityError(mat4Multiply(rigid, mat4RigidInverse(rigid))) < 1e-4F);
+    }
+}
@@ -0,0 +1,116 @@
+#include "test.hpp"
+#include "lz4_block.hpp"
+#include <cstring>
+#include <random>
+
+static std::vector<uint8_t> lz4TestData(size_t size, int kind, std::mt19937& rng)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (kind == 0)
+        {
+            data[i] = (uint8_t)rng();
+        }
+        else if (kind == 1)
+        {
+            data[i] = (uint8_t)(i / 7 % 13);
+        }
+        else
+        {
+            // Runs with occasional noise, so matches overlap their source.
+            data[i] = i > 0 && rng() % 8 != 0 ? data[i - 1] : (uint8_t)rng();
+        }
+    }
+    return data;
+}
+
+static std::vector<uint8_t> lz4TestCompress(const std::vector<uint8_t>& src)
+{
+    std::vector<uint8_t> packed(lz4CompressBound(src.size()));
+    size_t size = lz4Compress(src.data(), src.size(), packed.data(), packed.size());
+    packed.resize(size);
+    return packed;
+}
+
+TEST(lz4RoundTrip)
+{
+    std::mt19937 rng(1);
+    const size_t sizes[] = {0, 1, 4, 12, 13, 64, 255, 256, 4096, 70000, 300000};
+    for (size_t size : sizes)
+    {
+        for (int kind = 0; kind < 3; ++kind)
+        {
+            std::vector<uint8_t> src = lz4TestData(size, kind, rng);
+            std::vector<uint8_t> packed = lz4TestCompress(src);
+            CHECK(!packed.empty());
+            CHECK(packed.size() <= lz4CompressBound(size));
+            std::vector<uint8_t> out(size);
+            CHECK(lz4Decompress(packed.data(), packed.size(), out.data(), out.size()));
+            CHECK(out == src);
+            if (kind == 1 && size >= 4096)
+            {
+                CHECK(packed.size() < size / 4);
+            }
+        }
+    }
+}
+
+TEST(lz4CompressRespectsCapacity)
+{
+    std::mt19937 rng(2);
+    std::vector<uint8_t> src = lz4TestData(1000, 0, rng);
+    std::vector<uint8_t> packed(500);
+    CHECK(lz4Compress(src.data(), src.size(), packed.data(), packed.size()) == 0);
+}
+
+// Hand-written blocks: a token, literals, then offset and match length.
+TEST(lz4DecompressRejectsBadBlocks)
+{
+    uint8_t out[64];
+    const uint8_t literalsOnly[] = {0x30, 'a', 'b', 'c'};
+    CHECK(lz4Decompress(literalsOnly, sizeof(literalsOnly), out, 3));
+    // Output size must match exactly, either way.
+    CHECK(!lz4Decompress(literalsOnly, sizeof(literalsOnly), out, 2));
+    CHECK(!lz4Decompress(literalsOnly, sizeof(literalsOnly), out, 4));
+    // Literals running past the input.
+    CHECK(!lz4Decompress(literalsOnly, 3, out, 3));
+    CHECK(!lz4Decompress(literalsOnly, 0, out, 0));
+
+    // "ab" then a 6 byte match at offset 2, then the final empty literal run.
+    const uint8_t overlap[] = {0x22, 'a', 'b', 0x02, 0x00, 0x00};
+    CHECK(lz4Decompress(overlap, sizeof(overlap), out, 8));
+    CHECK(memcmp(out, "abababab", 8) == 0);
+    const uint8_t zeroOffset[] = {0x22, 'a', 'b', 0x00, 0x00, 0x00};
+    CHECK(!lz4Decompress(zeroOffset, sizeof(zeroOffset), out, 8));
+    const uint8_t offsetBeforeStart[] = {0x22, 'a', 'b', 0x03, 0x00, 0x00};
+    CHECK(!lz4Decompress(offsetBeforeStart, sizeof(offsetBeforeStart), out, 8));
+    // The match would write past the output.
+    CHECK(!lz4Decompress(overlap, sizeof(overlap), out, 7));
+    // Truncated offset and unterminated length bytes.
+    CHECK(!lz4Decompress(overlap, 4, out, 8));
+    const uint8_t longLength[] = {0xF0, 0xFF, 0xFF};
+    CHECK(!lz4Decompress(longLength, sizeof(longLength), out, sizeof(out)));
+}
+
+TEST(lz4DecompressSurvivesCorruption)
+{
+    std::mt19937 rng(3);
+    std::vector<uint8_t> src = lz4TestData(5000, 2, rng);
+    std::vector<uint8_t> packed = lz4TestCompress(src);
+    std::vector<uint8_t> out(src.size());
+    for (int i = 0; i < 2000; ++i)
+    {
+        std::vector<uint8_t> bad = packed;
+        for (int k = 0; k < 3; ++k)
+        {
+            bad[rng() % bad.size()] = (uint8_t)rng();
+        }
+        if (rng() % 4 == 0)
+        {
+            bad.resize(rng() % bad.size());
+        }
+        // Only has to stay in bounds, which the sanitizer builds check.
+        lz4Decompress(bad.data(), bad.size(), out.data(), out.size());
+    }
+}
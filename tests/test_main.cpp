@@ -0,0 +1,53 @@
+#include "test.hpp"
+#include <cstring>
+#include <filesystem>
+
+int testFailures = 0;
+
+std::vector<TestCase>& testRegistry()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+std::string testTempPath(const char* name)
+{
+    return (std::filesystem::temp_directory_path() / (std::string("arena_tests_") + name)).string();
+}
+
+std::vector<uint8_t> testReadFile(const std::string& path)
+{
+    std::vector<uint8_t> bytes;
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+    {
+        return bytes;
+    }
+    uint8_t buffer[64 * 1024];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    }
+    fclose(f);
+    return bytes;
+}
+
+// Runs every test, or those whose name contains argv[1].
+int main(int argc, char** argv)
+{
+    int run = 0;
+    for (const TestCase& test : testRegistry())
+    {
+        if (argc > 1 && !strstr(test.name, argv[1]))
+        {
+            continue;
+        }
+        int before = testFailures;
+        test.run();
+        printf("%s %s\n", testFailures == before ? "ok  " : "FAIL", test.name);
+        ++run;
+    }
+    printf("%d tests, %d failed checks\n", run, testFailures);
+    return testFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,267 @@
+#include "test.hpp"
+#include "mesh_optimize.hpp"
+#include <algorithm>
+#include <array>
+#include <random>
+
+// An n by n grid of quads in the xz plane with a gentle bump, two triangles
+// per quad, and every vertex skinned to one of two bones.
+static Mesh meshTestGrid(uint32_t n)
+{
+    Mesh mesh;
+    for (uint32_t z = 0; z <= n; ++z)
+    {
+        for (uint32_t x = 0; x <= n; ++x)
+        {
+            float fx = (float)x / (float)n;
+            float fz = (float)z / (float)n;
+            mesh.positions.insert(mesh.positions.end(), {fx, 0.1F * fx * (1.0F - fx) * fz, fz});
+            VertexWeight weight;
+            weight.boneIndices[0] = 0;
+            weight.boneIndices[1] = 1;
+            weight.weights[0] = 1.0F - fx;
+            weight.weights[1] = fx;
+            mesh.weights.push_back(weight);
+        }
+    }
+    std::vector<uint32_t> indices;
+    for (uint32_t z = 0; z < n; ++z)
+    {
+        for (uint32_t x = 0; x < n; ++x)
+        {
+            uint32_t v = z * (n + 1) + x;
+            indices.insert(indices.end(), {v, v + n + 1, v + 1, v + 1, v + n + 1, v + n + 2});
+        }
+    }
+    mesh.indices.assign(indices, mesh.vertexCount());
+    return mesh;
+}
+
+using MeshTestTriangle = std::array<float, 9>;
+
+// The triangles by position, each rotated to start at its smallest vertex
+// so winding is kept, then sorted; equal when two meshes draw the same.
+static std::vector<MeshTestTriangle> meshTestTriangles(const std::vector<uint32_t>& indices, const std::vector<float>& positions)
+{
+    std::vector<MeshTestTriangle> triangles;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3)
+    {
+        std::array<std::array<float, 3>, 3> corners;
+        for (int k = 0; k < 3; ++k)
+        {
+            corners[k] = {positions[indices[t + k] * 3], positions[indices[t + k] * 3 + 1], positions[indices[t + k] * 3 + 2]};
+        }
+        std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+        MeshTestTriangle triangle;
+        for (int k = 0; k < 9; ++k)
+        {
+            triangle[k] = corners[k / 3][k % 3];
+        }
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+static std::vector<MeshTestTriangle> meshTestTriangles(const Mesh& mesh)
+{
+    return meshTestTriangles(mesh.indices.unpack(), mesh.positions);
+}
+
+TEST(indexBufferWidth)
+{
+    CHECK(IndexBuffer::strideFor(1) == 1);
+    CHECK(IndexBuffer::strideFor(256) == 1);
+    CHECK(IndexBuffer::strideFor(257) == 2);
+    CHECK(IndexBuffer::strideFor(65536) == 2);
+    CHECK(IndexBuffer::strideFor(65537) == 4);
+
+    const size_t vertexCounts[] = {256, 65536, 70000};
+    for (size_t vertexCount : vertexCounts)
+    {
+        std::vector<uint32_t> indices = {0, 1, (uint32_t)vertexCount - 1, 7, (uint32_t)vertexCount / 2, 0};
+        IndexBuffer buffer;
+        buffer.assign(indices, vertexCount);
+        CHECK(buffer.stride == IndexBuffer::strideFor(vertexCount));
+        CHECK(buffer.data.size() == indices.size() * buffer.stride);
+        CHECK(buffer.size() == indices.size());
+        CHECK(buffer.unpack() == indices);
+        CHECK(buffer[2] == vertexCount - 1);
+    }
+}
+
+TEST(meshWeldMergesDuplicates)
+{
+    // Unshared corners, as importers hand them out.
+    Mesh grid = meshTestGrid(8);
+    std::vector<uint32_t> indices = grid.indices.unpack();
+    Mesh split;
+    std::vector<uint32_t> splitIndices;
+    for (uint32_t idx : indices)
+    {
+        splitIndices.push_back((uint32_t)split.weights.size());
+        split.positions.insert(split.positions.end(), grid.positions.begin() + idx * 3, grid.positions.begin() + idx * 3 + 3);
+        split.weights.push_back(grid.weights[idx]);
+    }
+    split.indices.assign(splitIndices, split.vertexCount());
+    std::vector<MeshTestTriangle> before = meshTestTriangles(split);
+
+    CHECK(meshWeldVertices(split) == grid.vertexCount());
+    CHECK(split.vertexCount() == grid.vertexCount());
+    CHECK(split.weights.size() == split.vertexCount());
+    CHECK(meshTestTriangles(split) == before);
+
+    // The same position with other weights stays a separate vertex.
+    Mesh seam = meshTestGrid(1);
+    std::vector<uint32_t> seamIndices = seam.indices.unpack();
+    seam.positions.insert(seam.positions.end(), seam.positions.begin(), seam.positions.begin() + 3);
+    VertexWeight other = seam.weights[0];
+    other.weights[0] = 0.5F;
+    other.weights[1] = 0.5F;
+    seam.weights.push_back(other);
+    seamIndices[0] = 4;
+    seam.indices.assign(seamIndices, seam.vertexCount());
+    CHECK(meshWeldVertices(seam) == 5);
+
+    // -0 is the same position as +0, as importers often write it.
+    Mesh zero = meshTestGrid(1);
+    std::vector<uint32_t> zeroIndices = zero.indices.unpack();
+    CHECK(zero.positions[0] == 0.0F && zero.positions[1] == 0.0F && zero.positions[2] == 0.0F);
+    zero.positions.insert(zero.positions.end(), {-0.0F, -0.0F, -0.0F});
+    zero.weights.push_back(zero.weights[0]);
+    zeroIndices[0] = 4;
+    zero.indices.assign(zeroIndices, zero.vertexCount());
+    CHECK(meshWeldVertices(zero) == 4);
+}
+
+TEST(meshVertexCacheAndOverdraw)
+{
+    Mesh grid = meshTestGrid(32);
+    std::vector<uint32_t> indices = grid.indices.unpack();
+    // Shuffled triangles are about the worst case for the cache.
+    std::mt19937 rng(1);
+    std::vector<uint32_t> order(indices.size() / 3);
+    for (uint32_t t = 0; t < order.size(); ++t)
+    {
+        order[t] = t;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<uint32_t> shuffled;
+    for (uint32_t t : order)
+    {
+        shuffled.insert(shuffled.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+    }
+    std::vector<MeshTestTriangle> triangles = meshTestTriangles(shuffled, grid.positions);
+
+    VertexCacheStats before = meshAnalyzeVertexCache(shuffled, grid.vertexCount());
+    meshOptimizeVertexCache(shuffled, grid.vertexCount());
+    VertexCacheStats after = meshAnalyzeVertexCache(shuffled, grid.vertexCount());
+    CHECK(meshTestTriangles(shuffled, grid.positions) == triangles);
+    CHECK(before.acmr > 2.0F);
+    CHECK(after.acmr < 0.8F);
+    CHECK(after.atvr < 1.5F);
+
+    meshOptimizeOverdraw(shuffled, grid.positions, 1.05F);
+    VertexCacheStats overdraw = meshAnalyzeVertexCache(shuffled, grid.vertexCount());
+    CHECK(meshTestTriangles(shuffled, grid.positions) == triangles);
+    CHECK(overdraw.acmr <= after.acmr * 1.05F + 1e-4F);
+}
+
+TEST(meshVertexFetchOrder)
+{
+    Mesh mesh = meshTestGrid(8);
+    std::vector<uint32_t> indices = mesh.indices.unpack();
+    std::reverse(indices.begin(), indices.end());
+    // Drop the last quad so two vertices end up unused.
+    indices.resize(indices.size() - 6);
+    mesh.indices.assign(indices, mesh.vertexCount());
+    std::vector<MeshTestTriangle> triangles = meshTestTriangles(mesh);
+
+    meshOptimizeVertexFetch(mesh);
+    CHECK(meshTestTriangles(mesh) == triangles);
+    CHECK(mesh.weights.size() == mesh.vertexCount());
+    uint32_t next = 0;
+    bool firstUse = true;
+    mesh.indices.forEach([&](uint32_t idx) {
+        firstUse = firstUse && idx <= next;
+        next += idx == next ? 1 : 0;
+    });
+    CHECK(firstUse);
+    CHECK(next == mesh.vertexCount());
+    CHECK(mesh.vertexCount() < 81);
+}
+
+TEST(meshLodChain)
+{
+    Mesh mesh = meshTestGrid(32);
+    size_t triangles = mesh.indices.size() / 3;
+    meshBuildLods(mesh, 4, 0.5F, 0.05F);
+    CHECK(!mesh.lods.empty());
+    CHECK(mesh.lods.size() <= 4);
+    size_t previousTriangles = triangles;
+    uint32_t previousVertices = (uint32_t)mesh.vertexCount();
+    float previousError = 0.0F;
+    for (const MeshLod& lod : mesh.lods)
+    {
+        size_t lodTriangles = lod.indices.size() / 3;
+        CHECK(lodTriangles < previousTriangles);
+        CHECK(lodTriangles > 0);
+        CHECK(lod.vertexCount <= previousVertices);
+        CHECK(lod.error >= previousError);
+        CHECK(lod.error <= 0.05F);
+        uint32_t largest = 0;
+        lod.indices.forEach([&largest](uint32_t idx) { largest = std::max(largest, idx); });
+        CHECK(largest < lod.vertexCount);
+        previousTriangles = lodTriangles;
+        previousVertices = lod.vertexCount;
+        previousError = lod.error;
+    }
+    // The base mesh keeps every triangle.
+    CHECK(mesh.indices.size() / 3 == triangles);
+}
+
+TEST(meshQuantizeWeightsAndPositions)
+{
+    Mesh mesh = meshTestGrid(16);
+    std::mt19937 rng(2);
+    for (VertexWeight& weight : mesh.weights)
+    {
+        // Uneven splits over all four influences that do not sum to 1.
+        for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+        {
+            weight.boneIndices[k] = (uint8_t)k;
+            weight.weights[k] = (float)(rng() % 1000) / 700.0F;
+        }
+    }
+    std::vector<float> positions = mesh.positions;
+    std::vector<VertexWeight> weights = mesh.weights;
+
+    meshQuantize(mesh);
+    CHECK(mesh.quantized());
+    CHECK(mesh.positions.empty() && mesh.weights.empty());
+    CHECK(mesh.packedWeights.size() == mesh.vertexCount());
+    CHECK(mesh.vertexCount() == positions.size() / 3);
+    for (size_t v = 0; v < mesh.vertexCount(); ++v)
+    {
+        const PackedVertexWeight& packed = mesh.packedWeights[v];
+        int sum = 0;
+        float total = 0.0F;
+        for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX; ++k)
+        {
+            sum += packed.weights[k];
+            total += weights[v].weights[k];
+        }
+        CHECK(sum == 255);
+        for (int k = 0; k < MODEL_BONE_INFLUENCE_MAX && total > 0.0F; ++k)
+        {
+            float expected = weights[v].weights[k] / total * 255.0F;
+            CHECK(packed.weights[k] >= expected - 2.0F && packed.weights[k] <= expected + 2.0F);
+            CHECK(packed.weights[k] == 0 || packed.boneIndices[k] == weights[v].boneIndices[k]);
+        }
+
+        Vector3 p = mesh.position(v);
+        CHECK(gmathAbs(p.x - positions[v * 3 + 0]) <= mesh.quantizeScale.x * 0.5F + 1e-6F);
+        CHECK(gmathAbs(p.y - positions[v * 3 + 1]) <= mesh.quantizeScale.y * 0.5F + 1e-6F);
+        CHECK(gmathAbs(p.z - positions[v * 3 + 2]) <= mesh.quantizeScale.z * 0.5F + 1e-6F);
+    }
+}
@@ -0,0 +1,352 @@
+#include "test.hpp"
+#include "texture_compress.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// textureEncodeBlock built without SSE, from texture_compress_scalar.cpp.
+void scalarTextureEncodeBlock(const uint8_t rgba[64], TextureFormat format, TextureQuality quality, uint8_t* out);
+
+// Reference decoders for the formats the encoder writes.
+
+static void bcTestUnpack565(uint16_t v, int out[3])
+{
+    int r = v >> 11;
+    int g = (v >> 5) & 63;
+    int b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+static void bcTestDecodeColor(const uint8_t* in, bool fourColor, uint8_t out[64])
+{
+    uint16_t c0 = (uint16_t)(in[0] | in[1] << 8);
+    uint16_t c1 = (uint16_t)(in[2] | in[3] << 8);
+    int palette[4][4];
+    bcTestUnpack565(c0, palette[0]);
+    bcTestUnpack565(c1, palette[1]);
+    palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+    for (int c = 0; c < 3; ++c)
+    {
+        if (c0 > c1 || fourColor)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        else
+        {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    if (!(c0 > c1 || fourColor))
+    {
+        palette[3][3] = 0;
+    }
+    uint32_t bits;
+    memcpy(&bits, in + 4, sizeof(bits));
+    for (int p = 0; p < 16; ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            out[p * 4 + c] = (uint8_t)palette[(bits >> (2 * p)) & 3][c];
+        }
+    }
+}
+
+static void bcTestDecodeAlpha(const uint8_t* in, uint8_t out[64])
+{
+    int palette[8] = {in[0], in[1]};
+    for (int i = 1; i < 7; ++i)
+    {
+        palette[i + 1] = in[0] > in[1] ? ((7 - i) * in[0] + i * in[1]) / 7 : i < 5 ? ((5 - i) * in[0] + i * in[1]) / 5 : i == 5 ? 0 : 255;
+    }
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; ++i)
+    {
+        bits |= (uint64_t)in[2 + i] << (8 * i);
+    }
+    for (int p = 0; p < 16; ++p)
+    {
+        out[p * 4 + 3] = (uint8_t)palette[(bits >> (3 * p)) & 7];
+    }
+}
+
+static uint32_t bcTestBits(const uint8_t* in, int& pos, int count)
+{
+    uint32_t v = 0;
+    for (int i = 0; i < count; ++i, ++pos)
+    {
+        v |= (uint32_t)((in[pos >> 3] >> (pos & 7)) & 1) << i;
+    }
+    return v;
+}
+
+// Mode 6 only, the one mode the encoder writes.
+static bool bcTestDecodeBc7(const uint8_t* in, uint8_t out[64])
+{
+    int pos = 0;
+    if (bcTestBits(in, pos, 7) != 64)
+    {
+        return false;
+    }
+    int e[2][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        e[0][c] = (int)bcTestBits(in, pos, 7);
+        e[1][c] = (int)bcTestBits(in, pos, 7);
+    }
+    int p0 = (int)bcTestBits(in, pos, 1);
+    int p1 = (int)bcTestBits(in, pos, 1);
+    static const int weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    for (int p = 0; p < 16; ++p)
+    {
+        int w = weights[bcTestBits(in, pos, p == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c)
+        {
+            out[p * 4 + c] = (uint8_t)(((64 - w) * (e[0][c] << 1 | p0) + w * (e[1][c] << 1 | p1) + 32) >> 6);
+        }
+    }
+    return pos == 128;
+}
+
+static bool bcTestDecode(TextureFormat format, const uint8_t* block, uint8_t out[64])
+{
+    if (format == TextureFormat::BC1)
+    {
+        bcTestDecodeColor(block, false, out);
+        return true;
+    }
+    if (format == TextureFormat::BC3)
+    {
+        bcTestDecodeColor(block + 8, true, out);
+        bcTestDecodeAlpha(block, out);
+        return true;
+    }
+    return bcTestDecodeBc7(block, out);
+}
+
+// A smooth gradient with some noise, plus varying alpha.
+static TextureImage bcTestImage(uint32_t width, uint32_t height, std::mt19937& rng)
+{
+    TextureImage image;
+    TextureMip mip;
+    mip.width = width;
+    mip.height = height;
+    mip.data.resize((size_t)width * height * 4);
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint8_t* p = &mip.data[((size_t)y * width + x) * 4];
+            double s = sin(x * 0.1) * cos(y * 0.07);
+            p[0] = (uint8_t)(128 + 100 * s + rng() % 6);
+            p[1] = (uint8_t)(x * 255 / width);
+            p[2] = (uint8_t)(y * 255 / height);
+            p[3] = (uint8_t)(255 - x * 2);
+        }
+    }
+    image.mips.push_back(mip);
+    return image;
+}
+
+static double bcTestPsnr(const TextureImage& src, const TextureImage& encoded, int channels)
+{
+    const TextureMip& mip = src.mips[0];
+    uint32_t blocksX = (mip.width + 3) / 4;
+    uint32_t blocksY = (mip.height + 3) / 4;
+    size_t blockBytes = textureBlockBytes(encoded.format);
+    double sum = 0.0;
+    size_t count = 0;
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            uint8_t pixels[64];
+            if (!bcTestDecode(encoded.format, &encoded.mips[0].data[((size_t)by * blocksX + bx) * blockBytes], pixels))
+            {
+                return 0.0;
+            }
+            for (int p = 0; p < 16; ++p)
+            {
+                uint32_t x = bx * 4 + (p & 3);
+                uint32_t y = by * 4 + (p >> 2);
+                for (int c = 0; c < channels && x < mip.width && y < mip.height; ++c)
+                {
+                    double d = (double)pixels[p * 4 + c] - mip.data[((size_t)y * mip.width + x) * 4 + c];
+                    sum += d * d;
+                    ++count;
+                }
+            }
+        }
+    }
+    return sum == 0.0 ? 99.0 : 10.0 * log10(255.0 * 255.0 * (double)count / sum);
+}
+
+TEST(textureCompressQuality)
+{
+    std::mt19937 rng(1);
+    TextureImage image = bcTestImage(64, 48, rng);
+    CHECK(textureHasAlpha(image));
+    CHECK(textureChooseFormat(image) == TextureFormat::BC3);
+    const TextureFormat formats[] = {TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC7};
+    for (TextureFormat format : formats)
+    {
+        double previous = 0.0;
+        for (int quality = 0; quality < 3; ++quality)
+        {
+            TextureImage encoded;
+            textureCompress(image, format, (TextureQuality)quality, encoded);
+            CHECK(encoded.format == format);
+            CHECK(encoded.mips[0].data.size() == textureLevelBytes(format, 64, 48));
+            double psnr = bcTestPsnr(image, encoded, format == TextureFormat::BC1 ? 3 : 4);
+            CHECK(psnr > 30.0);
+            CHECK(psnr >= previous - 0.05);
+            previous = psnr;
+        }
+    }
+}
+
+TEST(textureCompressEdgesAndThreads)
+{
+    std::mt19937 rng(2);
+    TextureImage image = bcTestImage(37, 21, rng);
+    TextureImage one;
+    TextureImage four;
+    textureCompress(image, TextureFormat::BC7, TextureQuality::Normal, one, 1);
+    textureCompress(image, TextureFormat::BC7, TextureQuality::Normal, four, 4);
+    CHECK(one.mips[0].data.size() == textureLevelBytes(TextureFormat::BC7, 37, 21));
+    CHECK(one.mips[0].data == four.mips[0].data);
+    CHECK(bcTestPsnr(image, one, 4) > 30.0);
+}
+
+// Flat blocks come back within the precision of each format: BC7 shares a
+// p-bit across an endpoint's channels, so mixed parities are off by 1.
+TEST(textureCompressFlatBlocks)
+{
+    const uint8_t colors[][4] = {{0, 0, 0, 255}, {255, 255, 255, 255}, {255, 0, 0, 255}, {12, 200, 99, 255}};
+    for (const uint8_t* color : colors)
+    {
+        uint8_t rgba[64];
+        for (int p = 0; p < 16; ++p)
+        {
+            memcpy(rgba + p * 4, color, 4);
+        }
+        uint8_t block[16];
+        uint8_t pixels[64];
+        textureEncodeBlock(rgba, TextureFormat::BC7, TextureQuality::Normal, block);
+        CHECK(bcTestDecode(TextureFormat::BC7, block, pixels));
+        for (int p = 0; p < 64; ++p)
+        {
+            CHECK(abs(pixels[p] - rgba[p]) <= 1);
+        }
+        textureEncodeBlock(rgba, TextureFormat::BC3, TextureQuality::Normal, block);
+        bcTestDecode(TextureFormat::BC3, block, pixels);
+        for (int p = 0; p < 16; ++p)
+        {
+            CHECK(pixels[p * 4 + 3] == 255);
+            for (int c = 0; c < 3; ++c)
+            {
+                CHECK(abs(pixels[p * 4 + c] - color[c]) <= 4);
+            }
+        }
+    }
+}
+
+TEST(textureCompressSimdMatchesScalar)
+{
+    std::mt19937 rng(3);
+    const TextureFormat formats[] = {TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC7};
+    for (int i = 0; i < 300; ++i)
+    {
+        uint8_t rgba[64];
+        for (int p = 0; p < 64; ++p)
+        {
+            // Mostly smooth blocks, some pure noise.
+            rgba[p] = i % 3 == 0 ? (uint8_t)rng() : (uint8_t)((p & 3) * (i % 64) + (p >> 4) * 20 + rng() % 4);
+        }
+        for (TextureFormat format : formats)
+        {
+            for (int quality = 0; quality < 3; ++quality)
+            {
+                uint8_t simd[16] = {};
+                uint8_t plain[16] = {};
+                textureEncodeBlock(rgba, format, (TextureQuality)quality, simd);
+                scalarTextureEncodeBlock(rgba, format, (TextureQuality)quality, plain);
+                CHECK(memcmp(simd, plain, sizeof(simd)) == 0);
+            }
+        }
+    }
+}
+
+// The runtime decoder, used when GL lacks a format, must agree with the
+// reference decoders on everything the encoder writes.
+TEST(textureDecodeMatchesReference)
+{
+    std::mt19937 rng(4);
+    const TextureFormat formats[] = {TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC7};
+    for (int i = 0; i < 200; ++i)
+    {
+        uint8_t rgba[64];
+        for (int p = 0; p < 64; ++p)
+        {
+            rgba[p] = i % 2 == 0 ? (uint8_t)rng() : (uint8_t)((p & 3) * (i % 64) + (p >> 4) * 20 + rng() % 4);
+        }
+        for (TextureFormat format : formats)
+        {
+            uint8_t block[16];
+            uint8_t expected[64];
+            uint8_t decoded[64];
+            textureEncodeBlock(rgba, format, TextureQuality::Fast, block);
+            CHECK(bcTestDecode(format, block, expected));
+            CHECK(textureDecodeBlock(block, format, decoded));
+            CHECK(memcmp(expected, decoded, sizeof(decoded)) == 0);
+        }
+    }
+
+    // Mode 0 has bit 0 set; the decoder only reads mode 6.
+    uint8_t block[16] = {1};
+    uint8_t decoded[64];
+    CHECK(!textureDecodeBlock(block, TextureFormat::BC7, decoded));
+}
+
+TEST(textureDecompressLevels)
+{
+    std::mt19937 rng(5);
+    TextureImage image = bcTestImage(37, 21, rng);
+    TextureMip small;
+    small.width = 2;
+    small.height = 1;
+    small.data.assign(8, 200);
+    image.mips.push_back(small);
+
+    TextureImage encoded;
+    textureCompress(image, TextureFormat::BC3, TextureQuality::Normal, encoded);
+    TextureImage decoded;
+    CHECK(textureDecompress(encoded, "test", decoded));
+    CHECK(decoded.format == TextureFormat::RGBA8);
+    CHECK(decoded.mips.size() == 2);
+    CHECK(decoded.mips[0].width == 37 && decoded.mips[0].height == 21);
+    CHECK(decoded.mips[0].data.size() == (size_t)37 * 21 * 4);
+    CHECK(decoded.mips[1].data.size() == 8);
+    for (uint8_t c : decoded.mips[1].data)
+    {
+        CHECK(abs(c - 200) <= 4);
+    }
+    CHECK(bcTestPsnr(image, encoded, 4) > 30.0);
+    double sum = 0.0;
+    for (size_t i = 0; i < image.mips[0].data.size(); ++i)
+    {
+        double d = (double)decoded.mips[0].data[i] - image.mips[0].data[i];
+        sum += d * d;
+    }
+    CHECK(10.0 * log10(255.0 * 255.0 * (double)image.mips[0].data.size() / sum) > 30.0);
+
+    TextureImage bad = encoded;
+    bad.format = TextureFormat::BC7;
+    bad.mips[0].data.assign(textureLevelBytes(TextureFormat::BC7, 37, 21), 1);
+    CHECK(!textureDecompress(bad, "bad", decoded));
+    CHECK(decoded.mips.empty());
+}
@@ -0,0 +1,16 @@
+// texture_compress.cpp again with its SSE paths compiled out and its entry
+// points renamed, so the tests can check both paths give the same bytes.
+// gmath.hpp is included first so only the encoder's own paths change.
+#include "gmath.hpp"
+
+#undef GMATH_SSE4
+
+#define textureHasAlpha scalarTextureHasAlpha
+#define textureChooseFormat scalarTextureChooseFormat
+#define textureEncodeBlock scalarTextureEncodeBlock
+#define textureCompress scalarTextureCompress
+#define textureDecodeBlock scalarTextureDecodeBlock
+#define textureDecompress scalarTextureDecompress
+#define EncodeBlock ScalarEncodeBlock
+
+#include "texture_compress.cpp"
@@ -0,0 +1,780 @@
+// arena-bake: cooks source models (glTF/FBX/...) into .arenamesh files and
+// images (PNG/JPG/TGA/BMP) into block-compressed .arenatex files.
+//
+// usage: arena-bake [-j THREADS] [--force] [--no-optimize] [--weld EPSILON] [--lods LEVELS] [--quantize]
+//                   [--texture-format auto|bc1|bc3|bc7] [--texture-quality fast|normal|high]
+//                   [--cache DIR] [--cache-size MB] -o OUTDIR INPUT...
+//
+// Each INPUT is a model or image file or a directory searched recursively.
+// Outputs mirror the input layout under OUTDIR. An output whose stored
+// source hash matches the current input bytes and options is left alone
+// unless --force is given. The auto texture format is BC1 for opaque images
+// and BC3 for the rest.
+//
+// With --cache, every baked file is also kept in DIR under its source hash
+// and later bakes of the same bytes and options, into any OUTDIR, link it
+// from there. Unchanged inputs are recognised by size and modification
+// time without being read. The cache is pruned back to --cache-size MB
+// (default 2048), least recently used first, after each run.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "baked_model.hpp"
+#include "baked_texture.hpp"
+#include "texture_compress.hpp"
+
+namespace fs = std::filesystem;
+
+// Part of every source hash; bump when the baked output changes without a
+// file format version change, so caches and outputs are not reused.
+#define ARENA_BAKE_VERSION 2
+
+struct BakeJob {
+    fs::path input;
+    fs::path output;
+    bool texture;
+};
+
+struct TextureBakeOptions {
+    bool autoFormat = true;
+    TextureFormat format = TextureFormat::BC1;
+    TextureQuality quality = TextureQuality::Normal;
+    // Block rows of one image are encoded on this many threads.
+    unsigned encodeThreads = 1;
+};
+
+enum class BakeStatus {
+    Baked,
+    Cached,
+    UpToDate,
+    Failed,
+};
+
+struct BakeStats {
+    BakeStatus status = BakeStatus::Failed;
+    double hashMs = 0.0;
+    double importMs = 0.0;
+    double writeMs = 0.0;
+    uintmax_t inputBytes = 0;
+    uintmax_t outputBytes = 0;
+    size_t meshes = 0;
+    size_t vertices = 0;
+    size_t bones = 0;
+    size_t actions = 0;
+    ModelImportStats import;
+    TextureFormat textureFormat = TextureFormat::RGBA8;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t mips = 0;
+    double encodeMs = 0.0;
+};
+
+static std::mutex printMutex;
+
+static bool isModelExtension(const fs::path& p)
+{
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return ext == ".gltf" || ext == ".glb" || ext == ".fbx" || ext == ".obj" || ext == ".dae";
+}
+
+static bool isImageExtension(const fs::path& p)
+{
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+    return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp";
+}
+
+static bool readFile(const fs::path& path, std::vector<uint8_t>& out)
+{
+    FILE* f = fopen(path.string().c_str(), "rb");
+    if (!f)
+    {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    out.resize(size > 0 ? (size_t)size : 0);
+    bool ok = size >= 0 && fread(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    return ok;
+}
+
+// Settings that change what a source bakes to. Each is folded into the
+// source hash together with ARENA_BAKE_VERSION, which is bumped whenever the
+// baker's output changes without a file format change.
+static uint64_t modelSettingsHash(const ModelImportOptions& options)
+{
+    uint32_t versions[] = {ARENA_BAKE_VERSION, ARENA_MESH_VERSION};
+    uint64_t hash = bakedHash(versions, sizeof(versions));
+    bool flags[] = {options.weldVertices, options.optimizeVertexCache, options.optimizeOverdraw, options.optimizeVertexFetch, options.quantizeVertices};
+    hash = bakedHash(flags, sizeof(flags), hash);
+    float values[] = {options.weldEpsilon, (float)options.lodLevels, options.lodReduction, options.lodMaxError};
+    return bakedHash(values, sizeof(values), hash);
+}
+
+static uint64_t textureSettingsHash(const TextureBakeOptions& options)
+{
+    uint32_t settings[] = {ARENA_BAKE_VERSION, ARENA_TEX_VERSION, options.autoFormat, (uint32_t)options.format, (uint32_t)options.quality};
+    return bakedHash(settings, sizeof(settings), bakedHash("texture", 7));
+}
+
+// Hash of the settings, the input and, for .gltf, the external buffers and
+// images its "uri" entries point at, so editing a .bin also triggers a
+// rebake.
+static bool hashSource(const fs::path& input, uint64_t settings, uint64_t& hash, uintmax_t& bytes)
+{
+    std::vector<uint8_t> data;
+    if (!readFile(input, data))
+    {
+        return false;
+    }
+    hash = bakedHash(data.data(), data.size(), settings);
+    bytes = data.size();
+
+    if (input.extension() != ".gltf")
+    {
+        return true;
+    }
+    std::string text(data.begin(), data.end());
+    size_t pos = 0;
+    while ((pos = text.find("\"uri\"", pos)) != std::string::npos)
+    {
+        pos = text.find('"', text.find(':', pos) + 1);
+        size_t end = pos == std::string::npos ? pos : text.find('"', pos + 1);
+        if (end == std::string::npos)
+        {
+            break;
+        }
+        std::string uri = text.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+        if (uri.compare(0, 5, "data:") == 0)
+        {
+            continue;
+        }
+        std::vector<uint8_t> dep;
+        if (readFile(input.parent_path() / uri, dep))
+        {
+            hash = bakedHash(dep.data(), dep.size(), hash);
+            bytes += dep.size();
+        }
+    }
+    return true;
+}
+
+// Source hashes from earlier runs, keyed by input path and remembered with
+// the input's size and modification time, so inputs that have not changed
+// are not read again. .gltf files are always rehashed since their external
+// buffers are not stamped.
+struct SourceHashMemo {
+    struct Entry {
+        uintmax_t size;
+        int64_t mtime;
+        uint64_t settings;
+        uint64_t hash;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+
+    static bool stamp(const fs::path& input, uintmax_t& size, int64_t& mtime)
+    {
+        std::error_code ec;
+        size = fs::file_size(input, ec);
+        if (ec)
+        {
+            return false;
+        }
+        mtime = (int64_t)fs::last_write_time(input, ec).time_since_epoch().count();
+        return !ec;
+    }
+
+    bool hash(const fs::path& input, uint64_t settings, uint64_t& hash, uintmax_t& bytes)
+    {
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+        bool stamped = input.extension() != ".gltf" && stamp(input, size, mtime);
+        std::error_code ec;
+        std::string key = fs::absolute(input, ec).lexically_normal().string();
+        if (stamped)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.size == size && it->second.mtime == mtime && it->second.settings == settings)
+            {
+                hash = it->second.hash;
+                bytes = size;
+                return true;
+            }
+        }
+        if (!hashSource(input, settings, hash, bytes))
+        {
+            return false;
+        }
+        if (stamped)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries[key] = {size, mtime, settings, hash};
+        }
+        return true;
+    }
+
+    // One "size mtime settings hash path" line per input.
+    void load(const fs::path& path)
+    {
+        FILE* f = fopen(path.string().c_str(), "r");
+        if (!f)
+        {
+            return;
+        }
+        char line[4096];
+        while (fgets(line, sizeof(line), f))
+        {
+            unsigned long long size = 0;
+            long long mtime = 0;
+            unsigned long long settings = 0;
+            unsigned long long hash = 0;
+            int consumed = 0;
+            if (sscanf(line, "%llu %lld %llx %llx %n", &size, &mtime, &settings, &hash, &consumed) == 4 && consumed > 0)
+            {
+                std::string key = line + consumed;
+                while (!key.empty() && (key.back() == '\n' || key.back() == '\r'))
+                {
+                    key.pop_back();
+                }
+                entries[key] = {(uintmax_t)size, (int64_t)mtime, (uint64_t)settings, (uint64_t)hash};
+            }
+        }
+        fclose(f);
+    }
+
+    void save(const fs::path& path)
+    {
+        fs::path tmp = path;
+        tmp += ".tmp";
+        FILE* f = fopen(tmp.string().c_str(), "w");
+        if (!f)
+        {
+            return;
+        }
+        for (const auto& it : entries)
+        {
+            fprintf(f, "%llu %lld %016llx %016llx %s\n", (unsigned long long)it.second.size, (long long)it.second.mtime, (unsigned long long)it.second.settings,
+                    (unsigned long long)it.second.hash, it.first.c_str());
+        }
+        bool ok = fclose(f) == 0;
+        std::error_code ec;
+        if (ok)
+        {
+            fs::rename(tmp, path, ec);
+        }
+        if (!ok || ec)
+        {
+            fs::remove(tmp, ec);
+        }
+    }
+};
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Saves beside the target and renames over it, so a crash never leaves a
+// half-written file with a valid header.
+template<typename Save>
+static bool replaceOutput(const fs::path& output, Save save)
+{
+    std::error_code ec;
+    fs::create_directories(output.parent_path(), ec);
+    fs::path tmp = output;
+    tmp += ".tmp";
+    if (!save(tmp))
+    {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    fs::rename(tmp, output, ec);
+    if (ec)
+    {
+        printf("ERROR::BAKE => cannot replace %s\n", output.string().c_str());
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+// Makes to a copy of from, as a hard link when both are on one volume.
+// Outputs are only ever replaced by rename, never rewritten in place, so a
+// link never sees its other name change under it.
+static bool linkOrCopy(const fs::path& from, const fs::path& to)
+{
+    std::error_code ec;
+    fs::remove(to, ec);
+    fs::create_hard_link(from, to, ec);
+    if (ec)
+    {
+        ec.clear();
+        fs::copy_file(from, to, fs::copy_options::overwrite_existing, ec);
+    }
+    return !ec;
+}
+
+// The source hash stored in a baked file's header, if it is one of the
+// current version.
+static bool storedSourceHash(const fs::path& path, bool texture, uint64_t& hash, uintmax_t& bytes)
+{
+    if (texture)
+    {
+        ArenaTexHeader header;
+        if (!textureReadBakedHeader(path.string().c_str(), header))
+        {
+            return false;
+        }
+        hash = header.sourceHash;
+        bytes = header.fileSize;
+        return true;
+    }
+    ArenaMeshHeader header;
+    if (!bakedReadHeader(path.string().c_str(), header))
+    {
+        return false;
+    }
+    hash = header.sourceHash;
+    bytes = header.fileSize;
+    return true;
+}
+
+// Content-addressed store of baked files, shared by every output tree baked
+// with the same cache directory: entries are named by source hash, so a
+// checkout that brings back content baked before is served by linking the
+// entry into place instead of importing it again. Hits refresh the entry's
+// modification time, and prune() drops the least recently used entries.
+struct BakeCache {
+    fs::path dir;
+
+    fs::path entryPath(uint64_t hash, bool texture) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+        fs::path path = dir / std::string(name, 2) / name;
+        path += texture ? ".arenatex" : ".arenamesh";
+        return path;
+    }
+
+    bool fetch(uint64_t hash, bool texture, const fs::path& output) const
+    {
+        fs::path entry = entryPath(hash, texture);
+        uint64_t stored = 0;
+        uintmax_t bytes = 0;
+        if (!storedSourceHash(entry, texture, stored, bytes) || stored != hash)
+        {
+            return false;
+        }
+        std::error_code ec;
+        fs::last_write_time(entry, fs::file_time_type::clock::now(), ec);
+        return replaceOutput(output, [&](const fs::path& tmp) { return linkOrCopy(entry, tmp); });
+    }
+
+    void store(uint64_t hash, bool texture, const fs::path& output) const
+    {
+        fs::path entry = entryPath(hash, texture);
+        std::error_code ec;
+        fs::create_directories(entry.parent_path(), ec);
+        // Unique per thread, in case two jobs bake identical sources.
+        fs::path tmp = entry;
+        tmp += ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        if (linkOrCopy(output, tmp))
+        {
+            fs::rename(tmp, entry, ec);
+        }
+        fs::remove(tmp, ec);
+    }
+
+    // Removes entries, oldest use first, until the cache holds at most
+    // maxBytes. Returns how many were removed.
+    size_t prune(uintmax_t maxBytes, uintmax_t& keptBytes) const
+    {
+        struct CacheFile {
+            fs::path path;
+            fs::file_time_type time;
+            uintmax_t size;
+        };
+        std::vector<CacheFile> files;
+        keptBytes = 0;
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(dir, ec), end; it != end; it.increment(ec))
+        {
+            std::string ext = it->path().extension().string();
+            if (it->is_regular_file(ec) && (ext == ".arenamesh" || ext == ".arenatex"))
+            {
+                files.push_back({it->path(), it->last_write_time(ec), it->file_size(ec)});
+                keptBytes += files.back().size;
+            }
+        }
+        std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.time < b.time; });
+        size_t removed = 0;
+        for (size_t i = 0; i < files.size() && keptBytes > maxBytes; ++i)
+        {
+            if (fs::remove(files[i].path, ec))
+            {
+                keptBytes -= files[i].size;
+                ++removed;
+            }
+        }
+        return removed;
+    }
+};
+
+struct BakeSettings {
+    ModelImportOptions model;
+    TextureBakeOptions texture;
+    bool force = false;
+    BakeCache* cache = nullptr;
+    SourceHashMemo* memo = nullptr;
+};
+
+static bool cookModel(const BakeJob& job, const ModelImportOptions& options, uint64_t sourceHash, BakeStats& stats)
+{
+    using Clock = std::chrono::steady_clock;
+
+    ModelAsset asset;
+    Clock::time_point start = Clock::now();
+    if (!asset.loadSource(job.input.string().c_str(), options, &stats.import))
+    {
+        return false;
+    }
+    stats.importMs = millisecondsSince(start);
+
+    start = Clock::now();
+    if (!replaceOutput(job.output, [&](const fs::path& tmp) { return asset.saveBaked(tmp.string().c_str(), sourceHash); }))
+    {
+        return false;
+    }
+    stats.writeMs = millisecondsSince(start);
+
+    stats.meshes = asset.baseMeshes.size();
+    for (const Mesh& mesh : asset.baseMeshes)
+    {
+        stats.vertices += mesh.vertexCount();
+    }
+    stats.bones = asset.boneHierarchy.size();
+    stats.actions = asset.actions.size();
+    return true;
+}
+
+static bool cookTexture(const BakeJob& job, const TextureBakeOptions& options, uint64_t sourceHash, BakeStats& stats)
+{
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start = Clock::now();
+    std::vector<uint8_t> data;
+    TextureImage image;
+    if (!readFile(job.input, data) || !textureDecode(data.data(), data.size(), job.input.string().c_str(), image))
+    {
+        return false;
+    }
+    stats.importMs = millisecondsSince(start);
+
+    start = Clock::now();
+    TextureImage compressed;
+    textureCompress(image, options.autoFormat ? textureChooseFormat(image) : options.format, options.quality, compressed, options.encodeThreads);
+    stats.encodeMs = millisecondsSince(start);
+
+    start = Clock::now();
+    if (!replaceOutput(job.output, [&](const fs::path& tmp) { return textureSaveBaked(tmp.string().c_str(), compressed, sourceHash); }))
+    {
+        return false;
+    }
+    stats.writeMs = millisecondsSince(start);
+
+    stats.textureFormat = compressed.format;
+    stats.width = compressed.mips[0].width;
+    stats.height = compressed.mips[0].height;
+    stats.mips = compressed.mips.size();
+    return true;
+}
+
+static BakeStats bakeOne(const BakeJob& job, const BakeSettings& settings)
+{
+    BakeStats stats;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint64_t sourceHash = 0;
+    uint64_t settingsHash = job.texture ? textureSettingsHash(settings.texture) : modelSettingsHash(settings.model);
+    bool hashed = settings.memo ? settings.memo->hash(job.input, settingsHash, sourceHash, stats.inputBytes)
+                                : hashSource(job.input, settingsHash, sourceHash, stats.inputBytes);
+    if (!hashed)
+    {
+        printf("ERROR::BAKE => cannot read %s\n", job.input.string().c_str());
+        return stats;
+    }
+    stats.hashMs = millisecondsSince(start);
+
+    uint64_t stored = 0;
+    if (!settings.force && storedSourceHash(job.output, job.texture, stored, stats.outputBytes) && stored == sourceHash)
+    {
+        stats.status = BakeStatus::UpToDate;
+        return stats;
+    }
+    std::error_code ec;
+    if (!settings.force && settings.cache && settings.cache->fetch(sourceHash, job.texture, job.output))
+    {
+        stats.status = BakeStatus::Cached;
+        stats.outputBytes = fs::file_size(job.output, ec);
+        return stats;
+    }
+
+    if (!(job.texture ? cookTexture(job, settings.texture, sourceHash, stats) : cookModel(job, settings.model, sourceHash, stats)))
+    {
+        return stats;
+    }
+    if (settings.cache)
+    {
+        settings.cache->store(sourceHash, job.texture, job.output);
+    }
+    stats.status = BakeStatus::Baked;
+    stats.outputBytes = fs::file_size(job.output, ec);
+    return stats;
+}
+
+static void collectJobs(const fs::path& input, const fs::path& outDir, std::vector<BakeJob>& jobs)
+{
+    std::error_code ec;
+    if (fs::is_directory(input, ec))
+    {
+        for (fs::recursive_directory_iterator it(input, ec), end; it != end; it.increment(ec))
+        {
+            bool texture = isImageExtension(it->path());
+            if (it->is_regular_file(ec) && (texture || isModelExtension(it->path())))
+            {
+                fs::path out = outDir / fs::relative(it->path(), input, ec);
+                out.replace_extension(texture ? ".arenatex" : ".arenamesh");
+                jobs.push_back({it->path(), out, texture});
+            }
+        }
+    }
+    else
+    {
+        bool texture = isImageExtension(input);
+        fs::path out = outDir / input.filename();
+        out.replace_extension(texture ? ".arenatex" : ".arenamesh");
+        jobs.push_back({input, out, texture});
+    }
+}
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-j THREADS] [--force] [--no-optimize] [--weld EPSILON] [--lods LEVELS] [--quantize]\n"
+            "       [--texture-format auto|bc1|bc3|bc7] [--texture-quality fast|normal|high]\n"
+            "       [--cache DIR] [--cache-size MB] -o OUTDIR INPUT...\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned threadCount = std::max(1U, std::thread::hardware_concurrency());
+    BakeSettings settings;
+    ModelImportOptions& options = settings.model;
+    TextureBakeOptions& textureOptions = settings.texture;
+    BakeCache cache;
+    uintmax_t cacheMegabytes = 2048;
+    fs::path outDir;
+    std::vector<fs::path> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            threadCount = (unsigned)std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--force") == 0)
+        {
+            settings.force = true;
+        }
+        else if (strcmp(argv[i], "--weld") == 0 && i + 1 < argc)
+        {
+            options.weldEpsilon = (float)atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+        {
+            options.lodLevels = (uint32_t)std::max(0, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--quantize") == 0)
+        {
+            options.quantizeVertices = true;
+        }
+        else if (strcmp(argv[i], "--no-optimize") == 0)
+        {
+            options.weldVertices = false;
+            options.optimizeVertexCache = false;
+            options.optimizeOverdraw = false;
+            options.optimizeVertexFetch = false;
+            options.lodLevels = 0;
+        }
+        else if (strcmp(argv[i], "--texture-format") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            textureOptions.autoFormat = strcmp(name, "auto") == 0;
+            if (strcmp(name, "bc1") == 0 || strcmp(name, "bc3") == 0 || strcmp(name, "bc7") == 0)
+            {
+                textureOptions.format = name[2] == '1' ? TextureFormat::BC1 : name[2] == '3' ? TextureFormat::BC3 : TextureFormat::BC7;
+            }
+            else if (!textureOptions.autoFormat)
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--texture-quality") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            if (strcmp(name, "fast") == 0 || strcmp(name, "normal") == 0 || strcmp(name, "high") == 0)
+            {
+                textureOptions.quality = name[0] == 'f' ? TextureQuality::Fast : name[0] == 'n' ? TextureQuality::Normal : TextureQuality::High;
+            }
+            else
+            {
+                usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            cache.dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+        {
+            cacheMegabytes = (uintmax_t)std::max(0LL, atoll(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            outDir = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        else
+        {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (outDir.empty() || inputs.empty())
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<BakeJob> jobs;
+    for (const fs::path& input : inputs)
+    {
+        collectJobs(input, outDir, jobs);
+    }
+
+    // Threads left over when there are fewer jobs than threads go to the
+    // block encoder of each image.
+    textureOptions.encodeThreads = std::max<unsigned>(1, threadCount / (unsigned)std::max<size_t>(1, std::min<size_t>(threadCount, jobs.size())));
+
+    SourceHashMemo memo;
+    fs::path memoPath = cache.dir / "sources.txt";
+    if (!cache.dir.empty())
+    {
+        std::error_code ec;
+        fs::create_directories(cache.dir, ec);
+        memo.load(memoPath);
+        settings.cache = &cache;
+        settings.memo = &memo;
+    }
+
+    std::vector<BakeStats> results(jobs.size());
+    std::atomic<size_t> nextJob(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    auto worker = [&]() {
+        for (size_t i = nextJob++; i < jobs.size(); i = nextJob++)
+        {
+            results[i] = bakeOne(jobs[i], settings);
+            const BakeStats& s = results[i];
+            std::lock_guard<std::mutex> lock(printMutex);
+            if (s.status == BakeStatus::Baked && jobs[i].texture)
+            {
+                printf("baked    %s: %ux%u %s, %zu mips, %ju -> %ju bytes, hash %.1f ms, decode %.1f ms, encode %.1f ms, write %.1f ms\n",
+                       jobs[i].input.string().c_str(), s.width, s.height, textureFormatName(s.textureFormat), s.mips, s.inputBytes, s.outputBytes,
+                       s.hashMs, s.importMs, s.encodeMs, s.writeMs);
+            }
+            else if (s.status == BakeStatus::Baked)
+            {
+                printf("baked    %s: %zu meshes, %zu -> %zu verts, %zu LODs, %zu index bytes, %zu bones, %zu actions, ACMR %.3f -> %.3f, %ju -> %ju bytes, hash %.1f ms, import %.1f ms, write %.1f ms\n",
+                       jobs[i].input.string().c_str(), s.meshes, s.import.verticesBefore, s.vertices, s.import.lods, s.import.indexBytes, s.bones, s.actions, s.import.acmrBefore, s.import.acmrAfter,
+                       s.inputBytes, s.outputBytes, s.hashMs, s.importMs, s.writeMs);
+            }
+            else if (s.status == BakeStatus::Cached)
+            {
+                printf("cached   %s: %ju bytes from cache, hash %.1f ms\n", jobs[i].input.string().c_str(), s.outputBytes, s.hashMs);
+            }
+            else if (s.status == BakeStatus::UpToDate)
+            {
+                printf("skipped  %s: up to date, hash %.1f ms\n", jobs[i].input.string().c_str(), s.hashMs);
+            }
+            else
+            {
+                printf("FAILED   %s\n", jobs[i].input.string().c_str());
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 1; t < std::min<size_t>(threadCount, jobs.size()); ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+
+    size_t baked = 0;
+    size_t cached = 0;
+    size_t skipped = 0;
+    size_t failed = 0;
+    uintmax_t inputBytes = 0;
+    uintmax_t outputBytes = 0;
+    for (const BakeStats& s : results)
+    {
+        baked += s.status == BakeStatus::Baked;
+        cached += s.status == BakeStatus::Cached;
+        skipped += s.status == BakeStatus::UpToDate;
+        failed += s.status == BakeStatus::Failed;
+        inputBytes += s.inputBytes;
+        outputBytes += s.outputBytes;
+    }
+    printf("%zu baked, %zu from cache, %zu up to date, %zu failed; %ju -> %ju bytes in %.1f ms on %u threads\n",
+           baked, cached, skipped, failed, inputBytes, outputBytes, millisecondsSince(start), threadCount);
+
+    if (settings.cache)
+    {
+        memo.save(memoPath);
+        uintmax_t cacheBytes = 0;
+        size_t pruned = cache.prune(cacheMegabytes * 1024 * 1024, cacheBytes);
+        printf("cache %s: %ju bytes, %zu entries pruned\n", cache.dir.string().c_str(), cacheBytes, pruned);
+    }
+
+    return failed ? 1 : 0;
+}